@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef __ACTORIGNORELIST_H__
+#define __ACTORIGNORELIST_H__
+
+// Library Includes
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+// Forward Declaration
+class Actor;
+
+/** A small set of actors to be skipped by a scene query.
+@remarks
+	The actors are kept sorted and unique in a flat vector, so each candidate of a query is checked with a
+	binary search rather than a linear search of the list.
+@par
+	Implicitly constructible from a vector of actors, so existing callers passing a std::vector<Actor*> or
+	{ pActor } keep working.
+*/
+class ActorIgnoreList {
+	// Member Functions
+public:
+	/** Default constructor, ignoring no actors. */
+	ActorIgnoreList() = default;
+
+	/** Construct from a list of actors, which may contain duplicates. */
+	ActorIgnoreList(std::initializer_list<Actor*> actors)
+		:m_Actors(actors)
+	{
+		SortAndUnique();
+	}
+
+	/** Construct from a vector of actors, which may contain duplicates. */
+	ActorIgnoreList(const std::vector<Actor*>& actors)
+		:m_Actors(actors)
+	{
+		SortAndUnique();
+	}
+
+	/** Get whether an actor is ignored. */
+	bool Contains(const Actor* pActor) const
+	{
+		return std::binary_search(m_Actors.begin(), m_Actors.end(), pActor, std::less<const Actor*>());
+	}
+
+	/** Get whether no actors are ignored. */
+	bool IsEmpty() const { return m_Actors.empty(); }
+
+	/** Get the ignored actors, sorted by address. */
+	const std::vector<Actor*>& GetActors() const { return m_Actors; }
+private:
+	void SortAndUnique()
+	{
+		std::sort(m_Actors.begin(), m_Actors.end(), std::less<const Actor*>());
+		m_Actors.erase(std::unique(m_Actors.begin(), m_Actors.end()), m_Actors.end());
+	}
+
+	// Member Variables
+private:
+	std::vector<Actor*> m_Actors;
+};
+
+#endif	// __ACTORIGNORELIST_H__
@@ -0,0 +1,100 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+
+// This Include
+#include "ActorStore.h"
+
+// Local Includes
+#include "Actor/Actor.h"
+
+void ActorStoreDeleter::operator()(Actor* pActor) const
+{
+	if (pStore) {
+		pStore->Destroy(pActor);
+	}
+}
+
+void ActorStore::Destroy(Actor* pActor)
+{
+	auto iter = m_Handles.find(pActor);
+	if (iter == m_Handles.end()) {
+		// Not owned by this store.
+		return;
+	}
+
+	const auto handle = iter->second;
+	m_Handles.erase(iter);
+
+	m_Pools[handle.pool]->Destroy(handle.slot);
+}
+
+void ActorStore::Clear()
+{
+	for (const auto& pPool : m_Pools) {
+		for (uint32_t slot = 0; slot < pPool->GetNumSlots(); ++slot) {
+			if (pPool->GetActor(slot)) {
+				pPool->Destroy(slot);
+			}
+		}
+	}
+
+	m_Handles.clear();
+}
+
+void ActorStore::SetLive(Actor* pActor, bool isLive)
+{
+	auto iter = m_Handles.find(pActor);
+	if (iter != m_Handles.end()) {
+		m_Pools[iter->second.pool]->SetLive(iter->second.slot, isLive);
+	}
+}
+
+void ActorStore::SetAsleep(Actor* pActor, bool isAsleep)
+{
+	auto iter = m_Handles.find(pActor);
+	if (iter != m_Handles.end()) {
+		m_Pools[iter->second.pool]->SetAsleep(iter->second.slot, isAsleep);
+	}
+}
+
+bool ActorStore::IsAsleep(const ActorHandle& handle) const
+{
+	if (handle.IsNull() || handle.pool >= m_Pools.size()) {
+		return false;
+	}
+
+	const auto& pPool = m_Pools[handle.pool];
+	if (handle.slot >= pPool->GetNumSlots() || pPool->GetGeneration(handle.slot) != handle.generation) {
+		return false;
+	}
+
+	return pPool->IsAsleep(handle.slot);
+}
+
+ActorHandle ActorStore::GetHandle(const Actor* pActor) const
+{
+	auto iter = m_Handles.find(pActor);
+	if (iter == m_Handles.end()) {
+		return ActorHandle();
+	}
+
+	return iter->second;
+}
+
+Actor* ActorStore::GetActor(const ActorHandle& handle) const
+{
+	if (handle.IsNull() || handle.pool >= m_Pools.size()) {
+		return nullptr;
+	}
+
+	const auto& pPool = m_Pools[handle.pool];
+	if (handle.slot >= pPool->GetNumSlots() || pPool->GetGeneration(handle.slot) != handle.generation) {
+		// The actor has since been destroyed.
+		return nullptr;
+	}
+
+	return pPool->GetActor(handle.slot);
+}
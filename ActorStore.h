@@ -0,0 +1,365 @@
+
+#pragma once
+
+#ifndef __ACTORSTORE_H__
+#define __ACTORSTORE_H__
+
+// Library Includes
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Local Includes
+
+// Forward Declaration
+class Actor;
+class ActorStore;
+
+/** Stable reference to an actor owned by an ActorStore.
+@remarks
+	Unlike a raw pointer, a handle can be safely kept after its actor is destroyed. The slot's generation
+	is incremented on destruction, so resolving a stale handle returns null rather than a dangling pointer.
+*/
+struct ActorHandle {
+	// Member Functions
+public:
+	/** Get whether the handle was ever assigned to an actor. */
+	bool IsNull() const { return pool == s_NullPool; }
+
+	bool operator==(const ActorHandle& other) const { return pool == other.pool && slot == other.slot && generation == other.generation; }
+	bool operator!=(const ActorHandle& other) const { return !(*this == other); }
+
+	// Member Variables
+public:
+	static constexpr uint32_t s_NullPool = UINT32_MAX;
+
+	// Index of the pool of the actor's type.
+	uint32_t pool = { s_NullPool };
+	// Index of the actor within its pool.
+	uint32_t slot = { 0 };
+	// Generation of the slot when the handle was created.
+	uint32_t generation = { 0 };
+};
+
+/** Deleter returning an actor to the ActorStore it was created by. */
+struct ActorStoreDeleter {
+	void operator()(Actor* pActor) const;
+
+	ActorStore* pStore = { nullptr };
+};
+
+/** Owning pointer to an actor created by an ActorStore. */
+template<typename ActorType>
+using PooledActorPtr = std::unique_ptr<ActorType, ActorStoreDeleter>;
+
+/** Type independent part of a pool of actors of one type.
+@remarks
+	Slots are stored in the same order as the actors in memory, so iterating slots in order walks the
+	slabs of the pool front to back.
+*/
+class ActorPoolBase {
+	// Member Types
+protected:
+	struct Slot {
+		Actor* pActor = { nullptr };
+		uint32_t generation = { 0 };
+		bool isLive = { false };
+		bool isAsleep = { false };
+	};
+
+	// Member Functions
+public:
+	virtual ~ActorPoolBase() = default;
+
+	/** Destroy the actor in a slot and return the slot to the pool. */
+	virtual void Destroy(uint32_t slot) = 0;
+
+	/** Get the actor in a slot, or null if the slot is empty. */
+	Actor* GetActor(uint32_t slot) const { return m_Slots[slot].pActor; }
+
+	/** Get the generation of a slot. */
+	uint32_t GetGeneration(uint32_t slot) const { return m_Slots[slot].generation; }
+
+	/** Get the number of slots, used or not, in the pool. */
+	size_t GetNumSlots() const { return m_Slots.size(); }
+
+	/** Get whether the actor in a slot is live, i.e. visited by iteration. */
+	bool IsLive(uint32_t slot) const { return m_Slots[slot].isLive; }
+
+	/** Set whether the actor in a slot is live. */
+	void SetLive(uint32_t slot, bool isLive) { m_Slots[slot].isLive = isLive; }
+
+	/** Get whether the actor in a slot is asleep. */
+	bool IsAsleep(uint32_t slot) const { return m_Slots[slot].isAsleep; }
+
+	/** Set whether the actor in a slot is asleep. */
+	void SetAsleep(uint32_t slot, bool isAsleep) { m_Slots[slot].isAsleep = isAsleep; }
+
+	// Member Variables
+protected:
+	std::vector<Slot> m_Slots;
+	std::vector<uint32_t> m_FreeSlots;
+};
+
+/** Slab backed pool of actors of a single type.
+@remarks
+	Actors are constructed in place in fixed size slabs, so they never move and are laid out contiguously.
+	Destroyed slots are reused by later actors of the same type.
+*/
+template<typename ActorType>
+class ActorPool : public ActorPoolBase {
+	// Member Functions
+public:
+	~ActorPool() override;
+
+	/** Construct an actor in a free slot.
+		@param args Arguments to be forwarded to the constructor of the actor.
+		@return The slot of the new actor.
+	*/
+	template<typename... Ts>
+	uint32_t Create(Ts&&... args);
+
+	void Destroy(uint32_t slot) override;
+private:
+	using Storage = typename std::aligned_storage<sizeof(ActorType), alignof(ActorType)>::type;
+
+	// Member Variables
+public:
+	// The number of actors in a single slab.
+	static constexpr size_t s_SlabSize = 256;
+private:
+	std::vector<std::unique_ptr<Storage[]>> m_Slabs;
+};
+
+/** Owns every actor of a scene in per type pools.
+@remarks
+	Actors become live, and therefore visited by ForEachLiveActor(), once SetLive() is called. Iteration
+	is in memory order, pool by pool, and it is safe to create new actors while iterating.
+@par
+	An actor can also be put to sleep with SetAsleep(). The store only keeps the flag, a sleeping actor is 
+	still live and still visited, it is up to the scene to leave it be.
+*/
+class ActorStore {
+	// Member Functions
+public:
+	/** Default constructor. */
+	ActorStore() = default;
+
+	ActorStore(const ActorStore&) = delete;
+	ActorStore& operator=(const ActorStore&) = delete;
+
+	/** Create an actor in the pool of its type.
+		@remarks The actor is not live until SetLive() is called.
+		@param args Arguments to be forwarded to the constructor of the actor.
+		@return Owning pointer to the new actor, which returns the actor to the store when destroyed.
+	*/
+	template<typename ActorType, typename... Ts>
+	PooledActorPtr<ActorType> Create(Ts&&... args);
+
+	/** Destroy an actor created by this store. */
+	void Destroy(Actor* pActor);
+
+	/** Destroy every actor in the store. */
+	void Clear();
+
+	/** Set whether an actor is live. */
+	void SetLive(Actor* pActor, bool isLive);
+
+	/** Set whether an actor is asleep. */
+	void SetAsleep(Actor* pActor, bool isAsleep);
+
+	/** Get whether the actor a handle refers to is asleep, false if that actor has been destroyed. */
+	bool IsAsleep(const ActorHandle& handle) const;
+
+	/** Get the handle of an actor, or a null handle if the actor isn't owned by this store. */
+	ActorHandle GetHandle(const Actor* pActor) const;
+
+	/** Get the actor a handle refers to, or null if that actor has been destroyed. */
+	Actor* GetActor(const ActorHandle& handle) const;
+
+	/** Get the number of actors in the store, live or not. */
+	size_t GetNumActors() const { return m_Handles.size(); }
+
+	/** Make room for a number of actors in total, so creating them doesn't rehash the handle lookup. */
+	void Reserve(size_t numActors) { m_Handles.reserve(numActors); }
+
+	/** Call a function on every live actor in memory order.
+		@remarks Actors created during iteration are not live, so they won't be visited.
+	*/
+	template<typename Function>
+	void ForEachLiveActor(Function&& function) const;
+
+	/** Call a function on every live actor and its handle in memory order, as function(pActor, handle).
+		@remarks Saves looking the handle of each actor up when iterating.
+	*/
+	template<typename Function>
+	void ForEachLiveActorHandle(Function&& function) const;
+
+	/** Call a function on every actor in the store, live or not, in memory order.
+		@remarks
+			Pools and slots are read by index each time, so the function may create actors, though actors
+			of a type without a pool before the call won't be visited.
+	*/
+	template<typename Function>
+	void ForEachActor(Function&& function) const;
+private:
+	/** Get the index of the pool of an actor type, creating the pool if this is the first actor of the type. */
+	template<typename ActorType>
+	uint32_t GetPoolIndex();
+
+	// Member Variables
+private:
+	std::vector<std::unique_ptr<ActorPoolBase>> m_Pools;
+	std::unordered_map<std::type_index, uint32_t> m_PoolIndices;
+
+	// Handles of all actors in the store, for looking actors up by pointer.
+	std::unordered_map<const Actor*, ActorHandle> m_Handles;
+};
+
+template<typename ActorType>
+ActorPool<ActorType>::~ActorPool()
+{
+	for (uint32_t slot = 0; slot < m_Slots.size(); ++slot) {
+		if (m_Slots[slot].pActor) {
+			Destroy(slot);
+		}
+	}
+}
+
+template<typename ActorType>
+template<typename... Ts>
+uint32_t ActorPool<ActorType>::Create(Ts&&... args)
+{
+	uint32_t slot;
+	if (!m_FreeSlots.empty()) {
+		// Reuse the most recently freed slot, as it is most likely still in cache.
+		slot = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+	}
+	else {
+		slot = static_cast<uint32_t>(m_Slots.size());
+		m_Slots.emplace_back();
+
+		if (slot % s_SlabSize == 0) {
+			m_Slabs.emplace_back(new Storage[s_SlabSize]);
+		}
+	}
+
+	auto pStorage = &m_Slabs[slot / s_SlabSize][slot % s_SlabSize];
+	auto pActor = new (pStorage) ActorType(std::forward<Ts>(args)...);
+
+	m_Slots[slot].pActor = pActor;
+	m_Slots[slot].isLive = false;
+	m_Slots[slot].isAsleep = false;
+
+	return slot;
+}
+
+template<typename ActorType>
+void ActorPool<ActorType>::Destroy(uint32_t slot)
+{
+	auto& poolSlot = m_Slots[slot];
+	static_cast<ActorType*>(poolSlot.pActor)->~ActorType();
+
+	// Invalidate any handles to the destroyed actor.
+	poolSlot.pActor = nullptr;
+	poolSlot.isLive = false;
+	poolSlot.isAsleep = false;
+	++poolSlot.generation;
+
+	m_FreeSlots.push_back(slot);
+}
+
+template<typename ActorType, typename... Ts>
+PooledActorPtr<ActorType> ActorStore::Create(Ts&&... args)
+{
+	static_assert(std::is_base_of<Actor, ActorType>::value,
+		"ActorType must be derived from Actor");
+
+	const auto poolIndex = GetPoolIndex<ActorType>();
+	auto& pool = static_cast<ActorPool<ActorType>&>(*m_Pools[poolIndex]);
+
+	const auto slot = pool.Create(std::forward<Ts>(args)...);
+	auto pActor = static_cast<ActorType*>(pool.GetActor(slot));
+
+	auto& handle = m_Handles[pActor];
+	handle.pool = poolIndex;
+	handle.slot = slot;
+	handle.generation = pool.GetGeneration(slot);
+
+	return PooledActorPtr<ActorType>(pActor, ActorStoreDeleter{ this });
+}
+
+template<typename Function>
+void ActorStore::ForEachLiveActor(Function&& function) const
+{
+	// Index based loops, as creating actors during iteration may grow the pools. The pools themselves never
+	// move, but the pointers to them may, so hold the pool rather than a reference to its pointer. Pools
+	// created during iteration only hold actors that aren't live yet, so they are left out.
+	const auto numPools = m_Pools.size();
+	for (size_t poolIndex = 0; poolIndex < numPools; ++poolIndex) {
+		const auto pPool = m_Pools[poolIndex].get();
+
+		for (uint32_t slot = 0; slot < pPool->GetNumSlots(); ++slot) {
+			if (pPool->IsLive(slot)) {
+				function(pPool->GetActor(slot));
+			}
+		}
+	}
+}
+
+template<typename Function>
+void ActorStore::ForEachLiveActorHandle(Function&& function) const
+{
+	const auto numPools = m_Pools.size();
+	for (size_t poolIndex = 0; poolIndex < numPools; ++poolIndex) {
+		const auto pPool = m_Pools[poolIndex].get();
+
+		for (uint32_t slot = 0; slot < pPool->GetNumSlots(); ++slot) {
+			if (pPool->IsLive(slot)) {
+				ActorHandle handle;
+				handle.pool = static_cast<uint32_t>(poolIndex);
+				handle.slot = slot;
+				handle.generation = pPool->GetGeneration(slot);
+
+				function(pPool->GetActor(slot), handle);
+			}
+		}
+	}
+}
+
+template<typename Function>
+void ActorStore::ForEachActor(Function&& function) const
+{
+	const auto numPools = m_Pools.size();
+	for (size_t poolIndex = 0; poolIndex < numPools; ++poolIndex) {
+		const auto pPool = m_Pools[poolIndex].get();
+
+		for (uint32_t slot = 0; slot < pPool->GetNumSlots(); ++slot) {
+			if (auto pActor = pPool->GetActor(slot)) {
+				function(pActor);
+			}
+		}
+	}
+}
+
+template<typename ActorType>
+uint32_t ActorStore::GetPoolIndex()
+{
+	const auto typeIndex = std::type_index(typeid(ActorType));
+
+	auto iter = m_PoolIndices.find(typeIndex);
+	if (iter == m_PoolIndices.end()) {
+		iter = m_PoolIndices.emplace(typeIndex, static_cast<uint32_t>(m_Pools.size())).first;
+		m_Pools.push_back(std::make_unique<ActorPool<ActorType>>());
+	}
+
+	return iter->second;
+}
+
+#endif	// __ACTORSTORE_H__
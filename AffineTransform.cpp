@@ -0,0 +1,95 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#if defined(__AVX__) || defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <immintrin.h>
+#define AFFINE_TRANSFORM_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AFFINE_TRANSFORM_NEON
+#endif
+
+// This Include
+#include "AffineTransform.h"
+
+// Local Includes
+
+void AffineTransform::Apply(const float* pX, const float* pY, float* pOutX, float* pOutY, size_t count) const
+{
+	size_t i = 0;
+
+#if defined(__AVX__)
+	{
+		const auto m00x8 = _mm256_set1_ps(m00);
+		const auto m01x8 = _mm256_set1_ps(m01);
+		const auto m02x8 = _mm256_set1_ps(m02);
+		const auto m10x8 = _mm256_set1_ps(m10);
+		const auto m11x8 = _mm256_set1_ps(m11);
+		const auto m12x8 = _mm256_set1_ps(m12);
+
+		for (; i + 8 <= count; i += 8) {
+			const auto x = _mm256_loadu_ps(pX + i);
+			const auto y = _mm256_loadu_ps(pY + i);
+
+			const auto outX = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m00x8, x), _mm256_mul_ps(m01x8, y)), m02x8);
+			const auto outY = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m10x8, x), _mm256_mul_ps(m11x8, y)), m12x8);
+
+			_mm256_storeu_ps(pOutX + i, outX);
+			_mm256_storeu_ps(pOutY + i, outY);
+		}
+	}
+#endif
+
+#if defined(AFFINE_TRANSFORM_SSE)
+	{
+		const auto m00x4 = _mm_set1_ps(m00);
+		const auto m01x4 = _mm_set1_ps(m01);
+		const auto m02x4 = _mm_set1_ps(m02);
+		const auto m10x4 = _mm_set1_ps(m10);
+		const auto m11x4 = _mm_set1_ps(m11);
+		const auto m12x4 = _mm_set1_ps(m12);
+
+		for (; i + 4 <= count; i += 4) {
+			const auto x = _mm_loadu_ps(pX + i);
+			const auto y = _mm_loadu_ps(pY + i);
+
+			const auto outX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00x4, x), _mm_mul_ps(m01x4, y)), m02x4);
+			const auto outY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m10x4, x), _mm_mul_ps(m11x4, y)), m12x4);
+
+			_mm_storeu_ps(pOutX + i, outX);
+			_mm_storeu_ps(pOutY + i, outY);
+		}
+	}
+#elif defined(AFFINE_TRANSFORM_NEON)
+	{
+		const auto m00x4 = vdupq_n_f32(m00);
+		const auto m01x4 = vdupq_n_f32(m01);
+		const auto m02x4 = vdupq_n_f32(m02);
+		const auto m10x4 = vdupq_n_f32(m10);
+		const auto m11x4 = vdupq_n_f32(m11);
+		const auto m12x4 = vdupq_n_f32(m12);
+
+		for (; i + 4 <= count; i += 4) {
+			const auto x = vld1q_f32(pX + i);
+			const auto y = vld1q_f32(pY + i);
+
+			const auto outX = vmlaq_f32(vmlaq_f32(m02x4, m00x4, x), m01x4, y);
+			const auto outY = vmlaq_f32(vmlaq_f32(m12x4, m10x4, x), m11x4, y);
+
+			vst1q_f32(pOutX + i, outX);
+			vst1q_f32(pOutY + i, outY);
+		}
+	}
+#endif
+
+	// Remaining points that don't fill a whole vector.
+	for (; i < count; ++i) {
+		const auto x = pX[i];
+		const auto y = pY[i];
+
+		pOutX[i] = m00 * x + m01 * y + m02;
+		pOutY[i] = m10 * x + m11 * y + m12;
+	}
+}
@@ -0,0 +1,52 @@
+
+#pragma once
+
+#ifndef __AFFINETRANSFORM_H__
+#define __AFFINETRANSFORM_H__
+
+// Library Includes
+#include <cstddef>
+
+// Local Includes
+
+/** A 2x3 affine transform between two 2D spaces.
+@remarks
+	Maps a point (x, y) to (m00 * x + m01 * y + m02, m10 * x + m11 * y + m12). The scene graph uses these
+	to convert between world and screen space, where both perspectives are purely affine.
+*/
+struct AffineTransform {
+	// Member Functions
+public:
+	/** Transform a single point. */
+	Point<float> Apply(const Point<float>& point) const
+	{
+		return {
+			m00 * point.X() + m01 * point.Y() + m02,
+			m10 * point.X() + m11 * point.Y() + m12
+		};
+	}
+
+	/** Transform a batch of points stored as separate x and y arrays.
+		@remarks
+			Uses SSE, AVX or NEON where the target supports it, otherwise falls back to scalar code.
+			The output arrays may be the same as the input arrays for an in-place transform, but must
+			not otherwise overlap them.
+		@param pX Array of x coordinates to transform.
+		@param pY Array of y coordinates to transform.
+		@param[out] pOutX Array receiving the transformed x coordinates.
+		@param[out] pOutY Array receiving the transformed y coordinates.
+		@param count The number of points in each array.
+	*/
+	void Apply(const float* pX, const float* pY, float* pOutX, float* pOutY, size_t count) const;
+
+	// Member Variables
+public:
+	float m00 = { 1.0f };
+	float m01 = { 0.0f };
+	float m02 = { 0.0f };
+	float m10 = { 0.0f };
+	float m11 = { 1.0f };
+	float m12 = { 0.0f };
+};
+
+#endif	// __AFFINETRANSFORM_H__
@@ -0,0 +1,24 @@
+#pragma once
+
+#ifndef __BENCHMARKTILEMAP_H__
+#define __BENCHMARKTILEMAP_H__
+
+// Library Includes
+#include <cstddef>
+#include <vector>
+
+// Local Includes
+#include "Isometric/TileMap.h"
+
+/** Parse the tile maps of a tile map file, for the benchmark to spread its actors over.
+@remarks
+	Defined by the game rather than here, as tile maps are built by its own loader. It's the same parser the game
+	passes to SceneGraph::LoadSnapshot() as a TileMapParser, so the benchmark runs on the maps the game ships.
+@param pJson The JSON of the tile map file.
+@param size The size of the JSON in bytes.
+@param tileMaps Receives the tile maps, the first of which is the base tile map.
+@return False if the file isn't a valid tile map.
+*/
+bool ParseBenchmarkTileMaps(const char* pJson, size_t size, std::vector<TileMap>& tileMaps);
+
+#endif	// __BENCHMARKTILEMAP_H__
@@ -0,0 +1,244 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Local Includes
+#include "SceneBenchmark.h"
+#include "MappedFile.h"
+#include "Actor/ActorFactory.h"
+#include "BenchmarkTileMap.h"
+
+/*
+	Times the scene graph on seeded scenes and prints a CSV row per run, for comparing builds.
+
+	Built from the scene graph's sources, this file and the game's definition of ParseBenchmarkTileMaps(), with
+	Benchmarks/Stubs ahead of the engine and the scene graph on the include path so the renderer draws nothing and the actor factory
+	adds no components. What's timed is then the scene graph alone.
+
+	SceneBenchmark --tile-map <file> [--tile-size <width> <height>] [--index quad_tree|uniform_grid]
+		[--broadphase spatial_index|sort_and_sweep] [--distribution uniform|clustered] [--max-actors-per-cell <n>]
+		[--actors <n,...>] [--zooms <zoom,...>] [--seed <n>] [--frames <n>] [--raycasts <n>] [--picks <n>]
+		[--all-hits] [--no-render]
+*/
+
+namespace {
+	/** The command line of a benchmark run. */
+	struct BenchmarkOptions {
+		std::string tileMapFilename;
+		int tileWidth = { 64 };
+		int tileHeight = { 32 };
+		SpatialIndexType spatialIndex = { SpatialIndexType::QUAD_TREE };
+		CollisionBroadphase broadphase = { CollisionBroadphase::SPATIAL_INDEX };
+		size_t maxActorsPerCell = { 16 };
+		std::vector<size_t> numActors = { 1000, 10000, 100000 };
+		std::vector<float> zooms = { 0.5f, 1.0f, 2.0f };
+		SceneBenchmarkConfig config;
+	};
+
+	/** Split a comma separated list of numbers.
+		@return False if a value isn't a number.
+	*/
+	template<typename T>
+	bool ParseList(const char* pText, std::vector<T>& values)
+	{
+		values.clear();
+
+		std::istringstream stream(pText);
+		std::string value;
+		while (std::getline(stream, value, ',')) {
+			char* pEnd = nullptr;
+			const auto number = std::strtod(value.c_str(), &pEnd);
+			if (value.empty() || *pEnd != '\0' || number < 0.0) {
+				return false;
+			}
+
+			values.push_back(static_cast<T>(number));
+		}
+
+		return !values.empty();
+	}
+
+	/** Read the command line.
+		@return False if an option is unknown, is missing its value or has a value that isn't valid.
+	*/
+	bool ParseOptions(int argc, char* argv[], BenchmarkOptions& options)
+	{
+		options.config.actorXmlFilename = "benchmark_actor";
+		options.config.numRaycastsPerFrame = 100;
+		options.config.numPicksPerFrame = 100;
+
+		for (int i = 1; i < argc; ++i) {
+			const auto option = std::string(argv[i]);
+			const auto hasValue = i + 1 < argc;
+			const char* pValue = hasValue ? argv[i + 1] : "";
+
+			if (option == "--all-hits") {
+				options.config.isRaycastingAllHits = true;
+				continue;
+			}
+			else if (option == "--no-render") {
+				options.config.isRendering = false;
+				continue;
+			}
+			else if (!hasValue) {
+				return false;
+			}
+
+			if (option == "--tile-map") {
+				options.tileMapFilename = pValue;
+			}
+			else if (option == "--tile-size") {
+				if (i + 2 >= argc) {
+					return false;
+				}
+
+				options.tileWidth = std::atoi(argv[++i]);
+				options.tileHeight = std::atoi(argv[i + 1]);
+				if (options.tileWidth <= 0 || options.tileHeight <= 0) {
+					return false;
+				}
+			}
+			else if (option == "--index") {
+				if (std::strcmp(pValue, "quad_tree") == 0) {
+					options.spatialIndex = SpatialIndexType::QUAD_TREE;
+				}
+				else if (std::strcmp(pValue, "uniform_grid") == 0) {
+					options.spatialIndex = SpatialIndexType::UNIFORM_GRID;
+				}
+				else {
+					return false;
+				}
+			}
+			else if (option == "--broadphase") {
+				if (std::strcmp(pValue, "spatial_index") == 0) {
+					options.broadphase = CollisionBroadphase::SPATIAL_INDEX;
+				}
+				else if (std::strcmp(pValue, "sort_and_sweep") == 0) {
+					options.broadphase = CollisionBroadphase::SORT_AND_SWEEP;
+				}
+				else {
+					return false;
+				}
+			}
+			else if (option == "--distribution") {
+				if (std::strcmp(pValue, "uniform") == 0) {
+					options.config.distribution = ActorDistribution::UNIFORM;
+				}
+				else if (std::strcmp(pValue, "clustered") == 0) {
+					options.config.distribution = ActorDistribution::CLUSTERED;
+				}
+				else {
+					return false;
+				}
+			}
+			else if (option == "--max-actors-per-cell") {
+				options.maxActorsPerCell = std::strtoul(pValue, nullptr, 10);
+				if (options.maxActorsPerCell == 0) {
+					return false;
+				}
+			}
+			else if (option == "--actors") {
+				if (!ParseList(pValue, options.numActors)) {
+					return false;
+				}
+			}
+			else if (option == "--zooms") {
+				if (!ParseList(pValue, options.zooms)) {
+					return false;
+				}
+			}
+			else if (option == "--seed") {
+				options.config.seed = static_cast<uint32_t>(std::strtoul(pValue, nullptr, 10));
+			}
+			else if (option == "--frames") {
+				options.config.numFrames = std::strtoul(pValue, nullptr, 10);
+			}
+			else if (option == "--raycasts") {
+				options.config.numRaycastsPerFrame = std::strtoul(pValue, nullptr, 10);
+			}
+			else if (option == "--picks") {
+				options.config.numPicksPerFrame = std::strtoul(pValue, nullptr, 10);
+			}
+			else {
+				return false;
+			}
+
+			++i;
+		}
+
+		return !options.tileMapFilename.empty();
+	}
+
+	/** Write the mean, min and max of a timing as CSV columns. */
+	void WriteTiming(std::ostream& stream, const SceneBenchmarkTiming& timing)
+	{
+		stream << ',' << timing.mean << ',' << timing.min << ',' << timing.max;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		std::cerr << "Usage: " << argv[0] << " --tile-map <file> [--tile-size <width> <height>] "
+			"[--index quad_tree|uniform_grid] [--broadphase spatial_index|sort_and_sweep] "
+			"[--distribution uniform|clustered] [--max-actors-per-cell <n>] [--actors <n,...>] [--zooms <zoom,...>] "
+			"[--seed <n>] [--frames <n>] [--raycasts <n>] [--picks <n>] [--all-hits] [--no-render]\n";
+		return EXIT_FAILURE;
+	}
+
+	MappedFile tileMapFile;
+	std::vector<TileMap> tileMaps;
+	if (!tileMapFile.Open(options.tileMapFilename) || 
+		!ParseBenchmarkTileMaps(reinterpret_cast<const char*>(tileMapFile.GetData()), tileMapFile.GetSize(), tileMaps) ||
+		tileMaps.empty()) {
+		std::cerr << "Failed to load the tile map " << options.tileMapFilename << "\n";
+		return EXIT_FAILURE;
+	}
+
+	ActorFactory actorFactory;
+	Renderer renderer(1920, 1080);
+
+	// The tile maps must outlive the scene, which keeps a reference to the base tile map.
+	SceneGraph sceneGraph(
+		actorFactory, renderer, 
+		tileMaps.front(), 
+		options.maxActorsPerCell, 
+		options.tileWidth, options.tileHeight, 
+		options.broadphase, 
+		options.spatialIndex);
+
+	const auto runs = SceneBenchmark::Sweep(sceneGraph, options.config, options.zooms, options.numActors);
+
+	std::cout << "perspective,zoom,actors,spawn_ms"
+		",update_mean_ms,update_min_ms,update_max_ms"
+		",collisions_mean_ms,collisions_min_ms,collisions_max_ms"
+		",raycasts_mean_ms,raycasts_min_ms,raycasts_max_ms"
+		",picks_mean_ms,picks_min_ms,picks_max_ms"
+		",render_mean_ms,render_min_ms,render_max_ms\n";
+
+	for (const auto& run : runs) {
+		std::cout << (run.renderPerspective == RenderPerspective::ISOMETRIC ? "isometric" : "oblique") 
+			<< ',' << run.zoom << ',' << run.result.numActors << ',' << run.result.spawn.mean;
+
+		WriteTiming(std::cout, run.result.update);
+		WriteTiming(std::cout, run.result.resolveCollisions);
+		WriteTiming(std::cout, run.result.raycasts);
+		WriteTiming(std::cout, run.result.picks);
+		WriteTiming(std::cout, run.result.render);
+		std::cout << '\n';
+	}
+
+	// A sanity check that the scenes were drawn, kept off the CSV.
+	std::cerr << renderer.GetNumSpritesRendered() << " sprites rendered by " << actorFactory.GetNumActorsInitialised() << " actors initialised\n";
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#ifndef __ACTORFACTORY_H__
+#define __ACTORFACTORY_H__
+
+// Library Includes
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/** An actor factory that adds no components, for timing the scene graph without parsing actor resources.
+@remarks
+	Takes the place of the engine's Actor/ActorFactory.h in the benchmark build, which puts Benchmarks/Stubs ahead
+	of the engine on the include path. Every actor is left bare, so its resource filename is never opened and
+	spawning measures only the scene graph's own pools, index and bookkeeping. Without colliders or sprites,
+	collisions, raycasts and picks time the spatial index traversal alone.
+*/
+class ActorFactory {
+	// Member Functions
+public:
+	/** Initialise an actor without adding any components to it.
+		@param pActor The actor to initialise.
+		@param actorXmlFilename The resource the actor would have been built from, which is ignored.
+		@return True, as a bare actor never fails to initialise.
+	*/
+	template<typename T, typename D>
+	bool AddComponentsAndInitaliseActor(std::unique_ptr<T, D>& pActor, const std::string& actorXmlFilename)
+	{
+		++m_NumActorsInitialised;
+		return true;
+	}
+
+	/** Get the number of actors initialised, including the scene graph's prototypes. */
+	size_t GetNumActorsInitialised() const { return m_NumActorsInitialised; }
+
+	// Member Variables
+private:
+	size_t m_NumActorsInitialised = { 0 };
+};
+
+#endif	// __ACTORFACTORY_H__
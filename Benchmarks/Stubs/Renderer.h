@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef __RENDERER_H__
+#define __RENDERER_H__
+
+// Library Includes
+#include <cstddef>
+
+// Forward Declaration
+class Sprite;
+
+/** A renderer that draws nothing, for timing the scene graph without the cost of drawing.
+@remarks
+	Takes the place of the engine's Renderer.h in the benchmark build, which puts Benchmarks/Stubs ahead of the
+	engine on the include path. Only what the scene graph calls is declared. Sprites are counted rather than
+	drawn, so the draw calls can't be optimised away and a run can check how many were made.
+*/
+class Renderer {
+	// Member Functions
+public:
+	/** Default constructor.
+		@param screenWidth The width of the screen pretended to, in pixels.
+		@param screenHeight The height of the screen pretended to, in pixels.
+	*/
+	Renderer(int screenWidth, int screenHeight) : m_sScreenCentrePosition(screenWidth / 2, screenHeight / 2) {}
+
+	/** Count a sprite instead of drawing it. */
+	void RenderSprite(const Sprite& sprite, const Rect<>& destRect, const Rect<>& mask) { ++m_NumSpritesRendered; }
+
+	/** Get the centre of the screen, in screen space. */
+	const Point<>& GetScreenCentrePosition() const { return m_sScreenCentrePosition; }
+
+	/** Get the number of sprites passed to RenderSprite() since the last ResetNumSpritesRendered(). */
+	size_t GetNumSpritesRendered() const { return m_NumSpritesRendered; }
+
+	/** Start counting sprites from zero again. */
+	void ResetNumSpritesRendered() { m_NumSpritesRendered = 0; }
+
+	// Member Variables
+private:
+	Point<> m_sScreenCentrePosition;
+	size_t m_NumSpritesRendered = { 0 };
+};
+
+#endif	// __RENDERER_H__
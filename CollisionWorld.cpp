@@ -0,0 +1,272 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <algorithm>
+#include <numeric>
+
+// This Include
+#include "CollisionWorld.h"
+
+// Local Includes
+#include "Actor/Actor.h"
+#include "Actor/CollisionComponent.h"
+
+void CollisionWorld::ResolveCollisions(
+	const ActorStore& actors,
+	const std::vector<const Actor*>& sortedMovedActors,
+	const std::function<void(Actor*)>& onActorMoved)
+{
+	++m_Frame;
+
+	GatherColliders(actors);
+	FindCandidatePairs();
+
+	ProcessCandidatePairs(actors, sortedMovedActors, onActorMoved);
+}
+
+void CollisionWorld::ResolveCollisions(
+	const ActorStore& actors,
+	const std::vector<std::pair<Actor*, Actor*>>& candidateActorPairs,
+	const std::vector<const Actor*>& sortedMovedActors,
+	const std::function<void(Actor*)>& onActorMoved)
+{
+	++m_Frame;
+
+	GatherColliders(actors);
+	FindCandidatePairs(candidateActorPairs);
+
+	ProcessCandidatePairs(actors, sortedMovedActors, onActorMoved);
+}
+
+void CollisionWorld::ProcessCandidatePairs(
+	const ActorStore& actors,
+	const std::vector<const Actor*>& sortedMovedActors,
+	const std::function<void(Actor*)>& onActorMoved)
+{
+	for (const auto& candidatePair : m_CandidatePairs) {
+		ProcessPair(candidatePair.first, candidatePair.second, actors, sortedMovedActors, onActorMoved);
+	}
+
+	// End the contacts that weren't found this frame, including those of destroyed actors.
+	for (auto iter = m_Contacts.begin(); iter != m_Contacts.end();) {
+		if (iter->second.lastFrame == m_Frame) {
+			++iter;
+			continue;
+		}
+
+		if (actors.IsAsleep(iter->first.first) && actors.IsAsleep(iter->first.second)) {
+			// Neither actor was considered, so the contact is as it was.
+			iter->second.lastFrame = m_Frame;
+			++iter;
+			continue;
+		}
+
+		if (m_ContactEndCallback) {
+			// A destroyed actor is reported as null.
+			m_ContactEndCallback(actors.GetActor(iter->first.first), actors.GetActor(iter->first.second));
+		}
+
+		iter = m_Contacts.erase(iter);
+	}
+}
+
+size_t CollisionWorld::ContactKeyHash::operator()(const ContactKey& key) const
+{
+	auto hashHandle = [](const ActorHandle& handle) {
+		return (static_cast<uint64_t>(handle.pool) << 48) ^ (static_cast<uint64_t>(handle.generation) << 32) ^ handle.slot;
+	};
+
+	return std::hash<uint64_t>()(hashHandle(key.first) * 31 + hashHandle(key.second));
+}
+
+void CollisionWorld::GatherColliders(const ActorStore& actors)
+{
+	m_Lefts.clear();
+	m_Tops.clear();
+	m_Rights.clear();
+	m_Bottoms.clear();
+	m_Owners.clear();
+	m_IsAsleep.clear();
+	m_FirstColliders.clear();
+	m_ActorFirstColliders.clear();
+
+	actors.ForEachLiveActorHandle([this, &actors](Actor* pActor, const ActorHandle& handle) {
+		auto pCollisionComponent = pActor->GetComponent<CollisionComponent>();
+		if (!pCollisionComponent) {
+			return;
+		}
+
+		const auto firstCollider = static_cast<uint32_t>(m_Owners.size());
+		const auto& actorPosition = pActor->GetPosition();
+		const auto isAsleep = static_cast<uint8_t>(actors.IsAsleep(handle));
+
+		m_ActorFirstColliders.emplace_back(pActor, firstCollider);
+
+		for (const auto& lBoundingBox : pCollisionComponent->GetBoundingBoxes()) {
+			// Get the world space bounding box.
+			auto wBoundingBox = lBoundingBox;
+			wBoundingBox.SetCentrePosition(actorPosition + lBoundingBox.GetPosition());
+
+			m_Lefts.push_back(wBoundingBox.GetLeft());
+			m_Tops.push_back(wBoundingBox.GetTop());
+			m_Rights.push_back(wBoundingBox.GetRight());
+			m_Bottoms.push_back(wBoundingBox.GetBottom());
+			m_Owners.push_back(pActor);
+			m_IsAsleep.push_back(isAsleep);
+			m_FirstColliders.push_back(firstCollider);
+		}
+	});
+}
+
+void CollisionWorld::FindCandidatePairs()
+{
+	const auto numColliders = static_cast<uint32_t>(m_Owners.size());
+
+	m_SortedColliders.resize(numColliders);
+	std::iota(m_SortedColliders.begin(), m_SortedColliders.end(), 0);
+	std::sort(m_SortedColliders.begin(), m_SortedColliders.end(), [this](uint32_t lhs, uint32_t rhs) {
+		return m_Lefts[lhs] < m_Lefts[rhs];
+	});
+
+	m_CandidatePairs.clear();
+
+	// Sweep along the x axis. Each collider is only compared against the colliders starting before it ends,
+	// so every overlapping pair is found exactly once.
+	for (uint32_t i = 0; i < numColliders; ++i) {
+		const auto first = m_SortedColliders[i];
+
+		for (auto j = i + 1; j < numColliders && m_Lefts[m_SortedColliders[j]] <= m_Rights[first]; ++j) {
+			const auto second = m_SortedColliders[j];
+
+			if (m_Owners[first] != m_Owners[second] && !(m_IsAsleep[first] && m_IsAsleep[second])) {
+				m_CandidatePairs.emplace_back(std::min(first, second), std::max(first, second));
+			}
+		}
+	}
+}
+
+void CollisionWorld::FindCandidatePairs(const std::vector<std::pair<Actor*, Actor*>>& candidateActorPairs)
+{
+	m_CandidatePairs.clear();
+
+	const auto numColliders = static_cast<uint32_t>(m_Owners.size());
+
+	auto lessActor = [](const std::pair<const Actor*, uint32_t>& lhs, const std::pair<const Actor*, uint32_t>& rhs) {
+		return std::less<const Actor*>()(lhs.first, rhs.first);
+	};
+
+	std::sort(m_ActorFirstColliders.begin(), m_ActorFirstColliders.end(), lessActor);
+
+	auto findActor = [this, &lessActor](const Actor* pActor) {
+		auto iter = std::lower_bound(m_ActorFirstColliders.begin(), m_ActorFirstColliders.end(), std::make_pair(pActor, 0u), lessActor);
+		return (iter != m_ActorFirstColliders.end() && iter->first == pActor) ? iter : m_ActorFirstColliders.end();
+	};
+
+	for (const auto& candidateActorPair : candidateActorPairs) {
+		auto firstIter = findActor(candidateActorPair.first);
+		auto secondIter = findActor(candidateActorPair.second);
+		if (firstIter == m_ActorFirstColliders.end() || secondIter == m_ActorFirstColliders.end()) {
+			// One of the actors has no colliders.
+			continue;
+		}
+
+		const auto pFirstOwner = candidateActorPair.first;
+		const auto pSecondOwner = candidateActorPair.second;
+		if (pFirstOwner == pSecondOwner) {
+			continue;
+		}
+
+		if (m_IsAsleep[firstIter->second] && m_IsAsleep[secondIter->second]) {
+			// Both asleep, so neither will be moving.
+			continue;
+		}
+
+		for (auto first = firstIter->second; first < numColliders && m_Owners[first] == pFirstOwner; ++first) {
+			for (auto second = secondIter->second; second < numColliders && m_Owners[second] == pSecondOwner; ++second) {
+				m_CandidatePairs.emplace_back(std::min(first, second), std::max(first, second));
+			}
+		}
+	}
+}
+
+void CollisionWorld::ProcessPair(
+	uint32_t first, uint32_t second,
+	const ActorStore& actors,
+	const std::vector<const Actor*>& sortedMovedActors,
+	const std::function<void(Actor*)>& onActorMoved)
+{
+	// Colliders may have been moved by an earlier pair this frame, so test both axes.
+	const auto overlapX = std::min(m_Rights[first], m_Rights[second]) - std::max(m_Lefts[first], m_Lefts[second]);
+	const auto overlapY = std::min(m_Bottoms[first], m_Bottoms[second]) - std::max(m_Tops[first], m_Tops[second]);
+
+	if (overlapX < 0.0f || overlapY < 0.0f) {
+		// Not touching.
+		return;
+	}
+
+	auto pFirst = m_Owners[first];
+	auto pSecond = m_Owners[second];
+	if (std::less<const Actor*>()(pSecond, pFirst)) {
+		std::swap(pFirst, pSecond);
+		std::swap(first, second);
+	}
+
+	// Update the contact between the two actors.
+	const auto key = ContactKey{ actors.GetHandle(pFirst), actors.GetHandle(pSecond) };
+	auto result = m_Contacts.emplace(key, Contact{ m_Frame, m_Frame });
+	auto& contact = result.first->second;
+	contact.lastFrame = m_Frame;
+
+	if (result.second && m_ContactBeginCallback) {
+		m_ContactBeginCallback(pFirst, pSecond);
+	}
+
+	if (overlapX == 0.0f || overlapY == 0.0f) {
+		// Touching without penetrating, nothing to resolve.
+		return;
+	}
+
+	auto hasMoved = [&sortedMovedActors](const Actor* pActor) {
+		return std::binary_search(sortedMovedActors.begin(), sortedMovedActors.end(), pActor, std::less<const Actor*>());
+	};
+
+	if (contact.firstFrame != m_Frame && !hasMoved(pFirst) && !hasMoved(pSecond)) {
+		// The contact is at rest, so it was already resolved as far as it will be.
+		return;
+	}
+
+	// Push both actors apart by half the penetration along the axis of least penetration.
+	auto x = 0.0f;
+	auto y = 0.0f;
+	if (overlapX < overlapY) {
+		const auto isFirstLeft = (m_Lefts[first] + m_Rights[first]) < (m_Lefts[second] + m_Rights[second]);
+		x = isFirstLeft ? -overlapX * 0.5f : overlapX * 0.5f;
+	}
+	else {
+		const auto isFirstAbove = (m_Tops[first] + m_Bottoms[first]) < (m_Tops[second] + m_Bottoms[second]);
+		y = isFirstAbove ? -overlapY * 0.5f : overlapY * 0.5f;
+	}
+
+	pFirst->SetPosition(pFirst->GetPosition() + Point<float>(x, y));
+	pSecond->SetPosition(pSecond->GetPosition() - Point<float>(x, y));
+
+	TranslateColliders(first, x, y);
+	TranslateColliders(second, -x, -y);
+
+	onActorMoved(pFirst);
+	onActorMoved(pSecond);
+}
+
+void CollisionWorld::TranslateColliders(uint32_t collider, float x, float y)
+{
+	const auto pOwner = m_Owners[collider];
+
+	for (auto i = m_FirstColliders[collider]; i < m_Owners.size() && m_Owners[i] == pOwner; ++i) {
+		m_Lefts[i] += x;
+		m_Rights[i] += x;
+		m_Tops[i] += y;
+		m_Bottoms[i] += y;
+	}
+}
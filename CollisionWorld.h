@@ -0,0 +1,167 @@
+
+#pragma once
+
+#ifndef __COLLISIONWORLD_H__
+#define __COLLISIONWORLD_H__
+
+// Library Includes
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Local Includes
+#include "ActorStore.h"
+
+// Forward Declaration
+class Actor;
+
+/** List of broadphases the scene graph can find potentially colliding actors with.
+@remarks
+	SPATIAL_INDEX leaves finding candidate pairs to the scene graph's spatial index, where it can, and 
+	SORT_AND_SWEEP always sorts and sweeps for them. Either way the pairs are resolved through a CollisionWorld, 
+	which also caches contacts between frames and reports when contacts begin and end. The QUAD_TREE spatial 
+	index can't list pairs itself, so with it both broadphases sort and sweep.
+*/
+enum class CollisionBroadphase {
+	SPATIAL_INDEX,
+	SORT_AND_SWEEP,
+
+	// The name SPATIAL_INDEX had when the quad tree was the only spatial index, kept so existing code compiles.
+	QUAD_TREE = SPATIAL_INDEX
+};
+
+/** Resolves collisions between actors in separate broadphase and narrowphase stages.
+@remarks
+	The world space bounding boxes of every collider are gathered into contiguous arrays each frame. The
+	broadphase sorts them along the x axis and sweeps over them to find a deduplicated list of candidate
+	pairs, and the narrowphase tests and resolves those pairs on the arrays alone.
+@par
+	Contacts between actors are remembered between frames. A contact between two actors that have both
+	not moved since the previous frame is at rest, so it is kept without being resolved again.
+@par
+	Pairs of actors that are both asleep, see ActorStore::SetAsleep(), aren't considered at all, and their
+	contacts are kept as they were until one of them wakes. A sleeping actor still collides with awake ones.
+*/
+class CollisionWorld {
+	// Member Types
+public:
+	/** Callback receiving the two actors of a contact. */
+	using ContactCallback = std::function<void(Actor*, Actor*)>;
+
+	// Member Functions
+public:
+	/** Find and resolve the collisions between the actors of a store.
+		@param actors The actors to collide.
+		@param sortedMovedActors The actors that have moved since the previous call, sorted by address.
+		@param onActorMoved Called for every actor moved when resolving a collision.
+	*/
+	void ResolveCollisions(
+		const ActorStore& actors,
+		const std::vector<const Actor*>& sortedMovedActors,
+		const std::function<void(Actor*)>& onActorMoved);
+
+	/** Resolve the collisions between pairs of actors found by an external broadphase.
+		@param actors The actors to collide.
+		@param candidateActorPairs Pairs of actors that may be colliding, each pair listed at most once.
+		@param sortedMovedActors The actors that have moved since the previous call, sorted by address.
+		@param onActorMoved Called for every actor moved when resolving a collision.
+	*/
+	void ResolveCollisions(
+		const ActorStore& actors,
+		const std::vector<std::pair<Actor*, Actor*>>& candidateActorPairs,
+		const std::vector<const Actor*>& sortedMovedActors,
+		const std::function<void(Actor*)>& onActorMoved);
+
+	/** Remove every cached contact without reporting their end, e.g. when all actors are cleared. */
+	void ClearContacts() { m_Contacts.clear(); }
+
+	/** Set the callback for when two actors start touching. */
+	void SetContactBeginCallback(ContactCallback callback) { m_ContactBeginCallback = std::move(callback); }
+
+	/** Set the callback for when two actors stop touching, or one of them is destroyed. */
+	void SetContactEndCallback(ContactCallback callback) { m_ContactEndCallback = std::move(callback); }
+
+	/** Get the number of candidate pairs found by the last broadphase. */
+	size_t GetNumCandidatePairs() const { return m_CandidatePairs.size(); }
+
+	/** Get the number of contacts between actors found by the last call. */
+	size_t GetNumContacts() const { return m_Contacts.size(); }
+private:
+	/** Key of a contact between two actors, ordered so that each pair of actors has a single key. */
+	struct ContactKey {
+		ActorHandle first;
+		ActorHandle second;
+
+		bool operator==(const ContactKey& other) const { return first == other.first && second == other.second; }
+	};
+
+	struct ContactKeyHash {
+		size_t operator()(const ContactKey& key) const;
+	};
+
+	/** A contact between two actors that persists between frames. */
+	struct Contact {
+		// The frame the contact began in.
+		uint32_t firstFrame;
+		// The frame the contact was last found in.
+		uint32_t lastFrame;
+	};
+
+	/** Gather the world space bounding boxes of all colliders. */
+	void GatherColliders(const ActorStore& actors);
+
+	/** Find every pair of colliders of different actors whose bounding boxes overlap on the x axis. */
+	void FindCandidatePairs();
+
+	/** Find every pair of colliders between the actors of each candidate pair. */
+	void FindCandidatePairs(const std::vector<std::pair<Actor*, Actor*>>& candidateActorPairs);
+
+	/** Process the candidate pairs, then end the contacts that weren't found this frame. */
+	void ProcessCandidatePairs(
+		const ActorStore& actors,
+		const std::vector<const Actor*>& sortedMovedActors,
+		const std::function<void(Actor*)>& onActorMoved);
+
+	/** Test, and if needed resolve, a single candidate pair. */
+	void ProcessPair(
+		uint32_t first, uint32_t second,
+		const ActorStore& actors,
+		const std::vector<const Actor*>& sortedMovedActors,
+		const std::function<void(Actor*)>& onActorMoved);
+
+	/** Translate every collider of the actor owning a collider. */
+	void TranslateColliders(uint32_t collider, float x, float y);
+
+	// Member Variables
+private:
+	// World space bounds of each collider.
+	std::vector<float> m_Lefts;
+	std::vector<float> m_Tops;
+	std::vector<float> m_Rights;
+	std::vector<float> m_Bottoms;
+
+	// The actor owning each collider. The colliders of an actor are contiguous.
+	std::vector<Actor*> m_Owners;
+	// Whether the actor owning each collider is asleep.
+	std::vector<uint8_t> m_IsAsleep;
+	// Index of the first collider of the actor owning each collider.
+	std::vector<uint32_t> m_FirstColliders;
+	// Index of the first collider of each actor with any colliders, sorted by actor when pairs of actors are
+	// looked up. A flat vector rather than a map, so gathering the colliders each frame doesn't allocate.
+	std::vector<std::pair<const Actor*, uint32_t>> m_ActorFirstColliders;
+
+	// Colliders sorted by their left edge.
+	std::vector<uint32_t> m_SortedColliders;
+
+	std::vector<std::pair<uint32_t, uint32_t>> m_CandidatePairs;
+
+	std::unordered_map<ContactKey, Contact, ContactKeyHash> m_Contacts;
+	uint32_t m_Frame = { 0 };
+
+	ContactCallback m_ContactBeginCallback;
+	ContactCallback m_ContactEndCallback;
+};
+
+#endif	// __COLLISIONWORLD_H__
@@ -0,0 +1,68 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <algorithm>
+#include <cstdint>
+
+// This Include
+#include "FrameArena.h"
+
+FrameArena::FrameArena(size_t capacity)
+{
+	AddBlock(capacity);
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	while (true) {
+		auto& block = m_Blocks[m_CurrentBlock];
+
+		// Align the address rather than the offset, as the block itself is only aligned for fundamental types.
+		const auto address = reinterpret_cast<uintptr_t>(block.pData.get()) + m_Offset;
+		const auto padding = (alignment - address % alignment) % alignment;
+
+		if (m_Offset + padding + size <= block.size) {
+			auto pAllocation = block.pData.get() + m_Offset + padding;
+
+			m_Offset += padding + size;
+			m_NumBytesAllocated += padding + size;
+
+			return pAllocation;
+		}
+
+		// Move on to the next block, adding one if this was the last.
+		if (m_CurrentBlock + 1 == m_Blocks.size()) {
+			AddBlock(size + alignment);
+		}
+
+		++m_CurrentBlock;
+		m_Offset = 0;
+	}
+}
+
+void FrameArena::Reset()
+{
+	if (m_Blocks.size() > 1) {
+		// Last frame didn't fit in one block, so make a single block that would have held all of it.
+		const auto capacity = m_Capacity;
+
+		m_Blocks.clear();
+		m_Capacity = 0;
+		AddBlock(capacity);
+	}
+
+	m_CurrentBlock = 0;
+	m_Offset = 0;
+	m_NumBytesAllocated = 0;
+}
+
+void FrameArena::AddBlock(size_t minSize)
+{
+	// Grow geometrically, so a frame spilling over needs few blocks.
+	const auto size = std::max(std::max(minSize, m_Capacity), static_cast<size_t>(1));
+
+	m_Blocks.push_back({ std::unique_ptr<unsigned char[]>(new unsigned char[size]), size });
+	m_Capacity += size;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#ifndef __FRAMEARENA_H__
+#define __FRAMEARENA_H__
+
+// Library Includes
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/** A linear allocator for memory that only lives until the end of a frame.
+@remarks
+	Allocating bumps an offset into a block, and nothing is freed until Reset(), which releases everything at
+	once. If a frame needs more than one block, Reset() replaces the blocks with a single block big enough for
+	the whole frame, so after the first few frames the arena stops touching the heap entirely.
+@par
+	Not thread safe. Each thread updating the scene has its own arena, see SceneGraph::GetFrameArena().
+*/
+class FrameArena {
+	// Member Functions
+public:
+	/** Constructor.
+		@param capacity The size in bytes of the first block.
+	*/
+	explicit FrameArena(size_t capacity = s_DefaultCapacity);
+
+	/** Allocate memory that stays valid until the next Reset().
+		@param size The size of the allocation in bytes.
+		@param alignment The alignment of the allocation, which must be a power of two.
+	*/
+	void* Allocate(size_t size, size_t alignment);
+
+	/** Release every allocation at once. */
+	void Reset();
+
+	/** Get the number of bytes allocated since the last Reset(), including alignment padding. */
+	size_t GetNumBytesAllocated() const { return m_NumBytesAllocated; }
+
+	/** Get the total size in bytes of the blocks owned by the arena. */
+	size_t GetCapacity() const { return m_Capacity; }
+private:
+	/** Add a block with room for at least an allocation of the given size. */
+	void AddBlock(size_t minSize);
+
+	/** A block of memory allocations are bumped from. */
+	struct Block {
+		std::unique_ptr<unsigned char[]> pData;
+		size_t size;
+	};
+
+	// Member Variables
+public:
+	// The size in bytes of the first block of a default constructed arena.
+	static constexpr size_t s_DefaultCapacity = 64 * 1024;
+private:
+	std::vector<Block> m_Blocks;
+	// The block currently allocated from, and the offset of its first free byte.
+	size_t m_CurrentBlock = { 0 };
+	size_t m_Offset = { 0 };
+
+	size_t m_NumBytesAllocated = { 0 };
+	size_t m_Capacity = { 0 };
+};
+
+/** A standard library allocator allocating from a FrameArena.
+@remarks Deallocation does nothing, so containers using it must not outlive the next FrameArena::Reset().
+*/
+template<typename T>
+class FrameArenaAllocator {
+	// Member Functions
+public:
+	using value_type = T;
+
+	/** Constructor. */
+	FrameArenaAllocator(FrameArena& arena) : m_pArena(&arena) {}
+
+	/** Converting constructor, for containers rebinding the allocator to their node type. */
+	template<typename U>
+	FrameArenaAllocator(const FrameArenaAllocator<U>& other) : m_pArena(other.GetArena()) {}
+
+	T* allocate(size_t count) { return static_cast<T*>(m_pArena->Allocate(count * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) {}
+
+	/** Get the arena allocated from. */
+	FrameArena* GetArena() const { return m_pArena; }
+
+	template<typename U>
+	bool operator==(const FrameArenaAllocator<U>& other) const { return m_pArena == other.GetArena(); }
+	template<typename U>
+	bool operator!=(const FrameArenaAllocator<U>& other) const { return m_pArena != other.GetArena(); }
+
+	// Member Variables
+private:
+	FrameArena* m_pArena;
+};
+
+/** A vector allocating from a FrameArena, for results that only need to last the frame. */
+template<typename T>
+using FrameVector = std::vector<T, FrameArenaAllocator<T>>;
+
+#endif	// __FRAMEARENA_H__
@@ -0,0 +1,92 @@
+#pragma once
+
+#ifndef __GRIDTRAVERSAL_H__
+#define __GRIDTRAVERSAL_H__
+
+// Library Includes
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+/** Walk the cells of a uniform grid crossed by a line segment, front to back.
+@remarks
+	Steps from cell to cell across whichever boundary the segment crosses next (Amanatides & Woo), so every
+	cell the segment passes through is visited exactly once and in order.
+@param origin The start of the segment.
+@param delta The end of the segment minus its start.
+@param start The fraction along the segment to start walking at, which must be inside the grid.
+@param finish The fraction along the segment to stop walking at.
+@param gridOrigin The top left corner of cell (0, 0).
+@param cellSize The width and length of a cell.
+@param numCellsX The number of columns of the grid.
+@param numCellsY The number of rows of the grid.
+@param visitor Called as visitor(x, y, entry, exit) with the column and row of each cell along with the fractions
+	the segment enters and leaves it at. Returns false to stop walking.
+*/
+template<typename Visitor>
+void TraverseGrid(
+	const Point<float>& origin, const Point<float>& delta,
+	float start, float finish,
+	const Point<float>& gridOrigin, float cellSize,
+	ptrdiff_t numCellsX, ptrdiff_t numCellsY,
+	Visitor&& visitor)
+{
+	const auto startPosition = origin + delta * start;
+
+	auto toCell = [cellSize](float position, float gridStart, ptrdiff_t numCells) {
+		const auto cell = static_cast<ptrdiff_t>(std::floor((position - gridStart) / cellSize));
+		return std::min(std::max<ptrdiff_t>(cell, 0), numCells - 1);
+	};
+
+	auto cellX = toCell(startPosition.X(), gridOrigin.X(), numCellsX);
+	auto cellY = toCell(startPosition.Y(), gridOrigin.Y(), numCellsY);
+
+	const ptrdiff_t stepX = delta.X() > 0.0f ? 1 : (delta.X() < 0.0f ? -1 : 0);
+	const ptrdiff_t stepY = delta.Y() > 0.0f ? 1 : (delta.Y() < 0.0f ? -1 : 0);
+
+	// The fraction along the segment of the next cell boundary on each axis, and the fraction between boundaries.
+	const auto infinity = std::numeric_limits<float>::infinity();
+	auto nextX = infinity;
+	auto nextY = infinity;
+	auto deltaX = infinity;
+	auto deltaY = infinity;
+
+	if (stepX != 0) {
+		const auto boundaryX = gridOrigin.X() + (cellX + (stepX > 0 ? 1 : 0)) * cellSize;
+		nextX = (boundaryX - origin.X()) / delta.X();
+		deltaX = cellSize / std::abs(delta.X());
+	}
+	if (stepY != 0) {
+		const auto boundaryY = gridOrigin.Y() + (cellY + (stepY > 0 ? 1 : 0)) * cellSize;
+		nextY = (boundaryY - origin.Y()) / delta.Y();
+		deltaY = cellSize / std::abs(delta.Y());
+	}
+
+	auto entry = start;
+
+	while (true) {
+		const auto exit = std::min(std::min(nextX, nextY), finish);
+
+		if (!visitor(cellX, cellY, entry, exit) || exit >= finish) {
+			return;
+		}
+
+		entry = std::max(entry, exit);
+
+		if (nextX < nextY) {
+			cellX += stepX;
+			nextX += deltaX;
+		}
+		else {
+			cellY += stepY;
+			nextY += deltaY;
+		}
+
+		if (cellX < 0 || cellX >= numCellsX || cellY < 0 || cellY >= numCellsY) {
+			return;
+		}
+	}
+}
+
+#endif	// __GRIDTRAVERSAL_H__
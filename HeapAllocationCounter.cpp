@@ -0,0 +1,182 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// This Include
+#include "HeapAllocationCounter.h"
+
+#if defined(BANANAFIGHTER_COUNT_HEAP_ALLOCATIONS)
+
+namespace {
+	// Constant initialised, so it's usable by allocations made before main().
+	std::atomic<size_t> s_NumAllocations = { 0 };
+
+	void* CountedAllocate(size_t size)
+	{
+		s_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+
+		// Zero sized allocations must still return a unique pointer.
+		return std::malloc(size == 0 ? 1 : size);
+	}
+
+	void* CountedAllocateAligned(size_t size, std::align_val_t alignment)
+	{
+		s_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+
+		const auto alignmentSize = std::max(static_cast<size_t>(alignment), sizeof(void*));
+#if defined(_WIN32)
+		return _aligned_malloc(size == 0 ? 1 : size, alignmentSize);
+#else
+		// aligned_alloc() needs the size to be a multiple of the alignment.
+		const auto alignedSize = (std::max(size, static_cast<size_t>(1)) + alignmentSize - 1) / alignmentSize * alignmentSize;
+		return std::aligned_alloc(alignmentSize, alignedSize);
+#endif
+	}
+
+	void FreeAligned(void* pMemory)
+	{
+#if defined(_WIN32)
+		_aligned_free(pMemory);
+#else
+		std::free(pMemory);
+#endif
+	}
+}
+
+void* operator new(size_t size)
+{
+	auto pMemory = CountedAllocate(size);
+	if (!pMemory) {
+		throw std::bad_alloc();
+	}
+	return pMemory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	auto pMemory = CountedAllocateAligned(size, alignment);
+	if (!pMemory) {
+		throw std::bad_alloc();
+	}
+	return pMemory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, std::align_val_t) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+void operator delete[](void* pMemory, std::align_val_t) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+void operator delete(void* pMemory, size_t, std::align_val_t) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t, std::align_val_t) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+void operator delete(void* pMemory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+void operator delete[](void* pMemory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+bool HeapAllocationCounter::IsEnabled()
+{
+	return true;
+}
+
+size_t HeapAllocationCounter::GetNumAllocations()
+{
+	return s_NumAllocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool HeapAllocationCounter::IsEnabled()
+{
+	return false;
+}
+
+size_t HeapAllocationCounter::GetNumAllocations()
+{
+	return 0;
+}
+
+#endif
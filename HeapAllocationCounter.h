@@ -0,0 +1,23 @@
+#pragma once
+
+#ifndef __HEAPALLOCATIONCOUNTER_H__
+#define __HEAPALLOCATIONCOUNTER_H__
+
+// Library Includes
+#include <cstddef>
+
+/** Counts allocations made through the global operator new, for checking that a frame doesn't touch the heap.
+@remarks
+	Only counts when built with BANANAFIGHTER_COUNT_HEAP_ALLOCATIONS defined, which replaces the global operator
+	new and delete, aligned versions included, with versions that count each allocation before calling malloc. 
+	Otherwise the count is always zero.
+*/
+namespace HeapAllocationCounter {
+	/** Get whether allocations are being counted in this build. */
+	bool IsEnabled();
+
+	/** Get the number of allocations made on any thread since the program started. */
+	size_t GetNumAllocations();
+}
+
+#endif	// __HEAPALLOCATIONCOUNTER_H__
@@ -0,0 +1,174 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <algorithm>
+
+// This Include
+#include "JobPool.h"
+
+// Local Includes
+
+namespace {
+	// Index of the current thread within its job pool.
+	thread_local size_t s_ThreadIndex = JobPool::s_InvalidThreadIndex;
+}
+
+JobPool::JobPool(size_t numThreads)
+{
+	numThreads = std::max<size_t>(numThreads, 1);
+
+	for (size_t i = 0; i < numThreads; ++i) {
+		m_Queues.push_back(std::make_unique<JobQueue>());
+	}
+
+	// Thread 0 is whichever thread calls ParallelFor().
+	for (size_t i = 1; i < numThreads; ++i) {
+		m_Workers.emplace_back(&JobPool::WorkerMain, this, i);
+	}
+}
+
+JobPool::~JobPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_IsShuttingDown = true;
+	}
+	m_JobsAvailable.notify_all();
+
+	for (auto& worker : m_Workers) {
+		worker.join();
+	}
+}
+
+void JobPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& function)
+{
+	if (count == 0) {
+		return;
+	}
+
+	grainSize = std::max<size_t>(grainSize, 1);
+
+	if (m_Workers.empty() || count <= grainSize || m_IsRunning) {
+		// Not worth splitting, or this is a nested loop.
+		function(0, count);
+		return;
+	}
+
+	m_IsRunning = true;
+	m_pFunction = &function;
+
+	const auto numJobs = (count + grainSize - 1) / grainSize;
+	const auto numThreads = m_Queues.size();
+	m_NumRemainingJobs = numJobs;
+
+	// Give each thread a contiguous block of jobs so neighbouring indices stay on the same thread.
+	for (size_t threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+		const auto firstJob = numJobs * threadIndex / numThreads;
+		const auto endJob = numJobs * (threadIndex + 1) / numThreads;
+
+		auto& queue = *m_Queues[threadIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		for (auto job = firstJob; job < endJob; ++job) {
+			queue.jobs.emplace_back(job * grainSize, std::min((job + 1) * grainSize, count));
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		++m_BatchId;
+	}
+	m_JobsAvailable.notify_all();
+
+	// The calling thread runs its jobs as thread 0, whatever it was marked as before.
+	const auto previousThreadIndex = s_ThreadIndex;
+	s_ThreadIndex = 0;
+
+	RunJobs(0);
+
+	s_ThreadIndex = previousThreadIndex;
+
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_JobsFinished.wait(lock, [this]() { return m_NumRemainingJobs == 0; });
+	}
+
+	m_pFunction = nullptr;
+	m_IsRunning = false;
+}
+
+size_t JobPool::GetCurrentThreadIndex()
+{
+	return s_ThreadIndex;
+}
+
+void JobPool::SetCurrentThreadIndex(size_t threadIndex)
+{
+	s_ThreadIndex = threadIndex;
+}
+
+void JobPool::WorkerMain(size_t threadIndex)
+{
+	s_ThreadIndex = threadIndex;
+
+	uint64_t lastBatchId = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_JobsAvailable.wait(lock, [this, lastBatchId]() { return m_IsShuttingDown || m_BatchId != lastBatchId; });
+
+			if (m_IsShuttingDown) {
+				return;
+			}
+
+			lastBatchId = m_BatchId;
+		}
+
+		RunJobs(threadIndex);
+	}
+}
+
+void JobPool::RunJobs(size_t threadIndex)
+{
+	JobRange job;
+	while (PopJob(threadIndex, job)) {
+		(*m_pFunction)(job.first, job.second);
+
+		if (m_NumRemainingJobs.fetch_sub(1) == 1) {
+			// That was the last job, wake the thread waiting in ParallelFor().
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_JobsFinished.notify_all();
+		}
+	}
+}
+
+bool JobPool::PopJob(size_t threadIndex, JobRange& job)
+{
+	const auto numThreads = m_Queues.size();
+
+	for (size_t i = 0; i < numThreads; ++i) {
+		const auto isOwnQueue = (i == 0);
+		auto& queue = *m_Queues[(threadIndex + i) % numThreads];
+
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty()) {
+			continue;
+		}
+
+		// Work through our own block front to back, and steal from the back of others' blocks.
+		if (isOwnQueue) {
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+		}
+		else {
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+		}
+
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,102 @@
+
+#pragma once
+
+#ifndef __JOBPOOL_H__
+#define __JOBPOOL_H__
+
+// Library Includes
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Local Includes
+
+/** A fixed set of worker threads for running data parallel loops.
+@remarks
+	ParallelFor() splits an index range into jobs and hands each thread a contiguous block of them.
+	A thread that runs out of jobs steals from the back of another thread's block, so uneven job costs
+	are balanced without a shared queue. The calling thread takes part in the loop as thread 0.
+*/
+class JobPool {
+	// Member Functions
+public:
+	/** Constructor.
+		@param numThreads The total number of threads running jobs, including the calling thread.
+	*/
+	explicit JobPool(size_t numThreads);
+
+	/** Destructor. Joins all worker threads. */
+	~JobPool();
+
+	JobPool(const JobPool&) = delete;
+	JobPool& operator=(const JobPool&) = delete;
+
+	/** Call a function over the range [0, count) split across all threads, and wait for it to finish.
+		@remarks Calling ParallelFor() from inside a job runs the nested loop on the current thread.
+		@param count The size of the index range.
+		@param grainSize The number of indices in a single job.
+		@param function Function called with the [begin, end) range of each job.
+	*/
+	void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& function);
+
+	/** Get the total number of threads running jobs, including the calling thread. */
+	size_t GetNumThreads() const { return m_Queues.size(); }
+
+	/** Get the index of the current thread within its job pool.
+		@return The worker index, 0 for a thread running a ParallelFor() or marked by SetCurrentThreadIndex(), 
+			or s_InvalidThreadIndex for any other thread.
+	*/
+	static size_t GetCurrentThreadIndex();
+
+	/** Mark the current thread as a thread of a job pool, e.g. 0 for the thread that calls ParallelFor().
+		@param threadIndex The index of the thread, or s_InvalidThreadIndex to unmark it.
+	*/
+	static void SetCurrentThreadIndex(size_t threadIndex);
+private:
+	/** Range of indices making up a single job. */
+	using JobRange = std::pair<size_t, size_t>;
+
+	/** The block of jobs belonging to a single thread. */
+	struct JobQueue {
+		std::mutex mutex;
+		std::deque<JobRange> jobs;
+	};
+
+	/** Entry point of a worker thread. */
+	void WorkerMain(size_t threadIndex);
+
+	/** Run jobs on a thread until there are none left to run or steal. */
+	void RunJobs(size_t threadIndex);
+
+	/** Take the next job of a thread, stealing one from another thread if its own block is empty. */
+	bool PopJob(size_t threadIndex, JobRange& job);
+
+	// Member Variables
+public:
+	// The index of any thread that isn't part of a job pool.
+	static constexpr size_t s_InvalidThreadIndex = SIZE_MAX;
+private:
+	std::vector<std::thread> m_Workers;
+	std::vector<std::unique_ptr<JobQueue>> m_Queues;
+
+	// The function of the current ParallelFor().
+	const std::function<void(size_t, size_t)>* m_pFunction = { nullptr };
+	// The number of jobs of the current ParallelFor() yet to finish.
+	std::atomic<size_t> m_NumRemainingJobs = { 0 };
+	std::atomic<bool> m_IsRunning = { false };
+
+	std::mutex m_Mutex;
+	std::condition_variable m_JobsAvailable;
+	std::condition_variable m_JobsFinished;
+	uint64_t m_BatchId = { 0 };
+	bool m_IsShuttingDown = { false };
+};
+
+#endif	// __JOBPOOL_H__
@@ -0,0 +1,124 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <utility>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+// This Include
+#include "MappedFile.h"
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+	if (this != &other) {
+		Close();
+
+		std::swap(m_pData, other.m_pData);
+		std::swap(m_Size, other.m_Size);
+#if defined(_WIN32)
+		std::swap(m_hMapping, other.m_hMapping);
+#endif
+	}
+
+	return *this;
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+#if defined(_WIN32)
+	auto hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0) {
+		// Empty files can't be mapped.
+		CloseHandle(hFile);
+		return false;
+	}
+
+	// The mapping keeps the file open, so the file handle isn't needed past here.
+	auto hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(hFile);
+	if (!hMapping) {
+		return false;
+	}
+
+	auto pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!pView) {
+		CloseHandle(hMapping);
+		return false;
+	}
+
+	m_hMapping = hMapping;
+	m_pData = static_cast<const unsigned char*>(pView);
+	m_Size = static_cast<size_t>(size.QuadPart);
+#else
+	const auto fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+		// Empty files can't be mapped.
+		close(fd);
+		return false;
+	}
+
+	// The mapping keeps the file open, so the descriptor isn't needed past here.
+	const auto size = static_cast<size_t>(status.st_size);
+	auto pView = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (pView == MAP_FAILED) {
+		return false;
+	}
+
+	m_pData = static_cast<const unsigned char*>(pView);
+	m_Size = size;
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (!m_pData) {
+		return;
+	}
+
+#if defined(_WIN32)
+	UnmapViewOfFile(m_pData);
+	CloseHandle(m_hMapping);
+	m_hMapping = nullptr;
+#else
+	munmap(const_cast<unsigned char*>(m_pData), m_Size);
+#endif
+
+	m_pData = nullptr;
+	m_Size = 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef __MAPPEDFILE_H__
+#define __MAPPEDFILE_H__
+
+// Library Includes
+#include <cstddef>
+#include <string>
+
+/** A read only view of a whole file mapped into memory.
+@remarks
+	Pages are only read from disk as they're first touched, so opening a large file is cheap and parts of it
+	that are never read never cost any memory.
+*/
+class MappedFile {
+	// Member Functions
+public:
+	/** Default constructor, for a view of no file. */
+	MappedFile() = default;
+
+	/** Destructor. Unmaps the file. */
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other);
+	MappedFile& operator=(MappedFile&& other);
+
+	/** Map a file, unmapping any file already mapped.
+		@param filename Name and path to the file to be mapped.
+		@return False if the file couldn't be opened or mapped.
+	*/
+	bool Open(const std::string& filename);
+
+	/** Unmap the file, if any. */
+	void Close();
+
+	/** Get whether a file is mapped. */
+	bool IsOpen() const { return m_pData != nullptr; }
+
+	/** Get the first byte of the file, or null if no file is mapped. */
+	const unsigned char* GetData() const { return m_pData; }
+
+	/** Get the size of the file in bytes. */
+	size_t GetSize() const { return m_Size; }
+
+	// Member Variables
+private:
+	const unsigned char* m_pData = { nullptr };
+	size_t m_Size = { 0 };
+
+#if defined(_WIN32)
+	// The file mapping object, which must outlive the view.
+	void* m_hMapping = { nullptr };
+#endif
+};
+
+#endif	// __MAPPEDFILE_H__
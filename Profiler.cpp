@@ -0,0 +1,248 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <rapidjson/ostreamwrapper.h>
+#include <rapidjson/writer.h>
+
+// This Include
+#include "Profiler.h"
+
+// Local Includes
+#include "JobPool.h"
+
+Profiler::Profiler()
+	:m_ThreadTraceEvents(1)
+{
+	for (auto& phaseNanoseconds : m_PhaseNanoseconds) {
+		phaseNanoseconds.store(0, std::memory_order_relaxed);
+	}
+	for (auto& phaseCalls : m_PhaseCalls) {
+		phaseCalls.store(0, std::memory_order_relaxed);
+	}
+	for (auto& counter : m_Counters) {
+		counter.store(0, std::memory_order_relaxed);
+	}
+}
+
+void Profiler::SetNumThreads(size_t numThreads)
+{
+	m_ThreadTraceEvents.resize(std::max(numThreads, static_cast<size_t>(1)));
+}
+
+void Profiler::BeginFrame()
+{
+	for (size_t i = 0; i < m_PhaseNanoseconds.size(); ++i) {
+		m_LastFrame.phaseNanoseconds[i] = m_PhaseNanoseconds[i].exchange(0, std::memory_order_relaxed);
+		m_LastFrame.phaseCalls[i] = m_PhaseCalls[i].exchange(0, std::memory_order_relaxed);
+	}
+
+	for (size_t i = 0; i < m_Counters.size(); ++i) {
+		m_LastFrame.counters[i] = m_Counters[i].exchange(0, std::memory_order_relaxed);
+	}
+
+	if (IsTracing() && m_TraceFrames.size() < m_MaxTraceFrames) {
+		m_TraceFrames.push_back({ GetTimestamp(), m_LastFrame.counters });
+	}
+}
+
+void Profiler::AddTime(ProfilePhase phase, uint64_t startTimestamp, uint64_t endTimestamp)
+{
+	const auto index = static_cast<size_t>(phase);
+	m_PhaseNanoseconds[index].fetch_add(endTimestamp - startTimestamp, std::memory_order_relaxed);
+	m_PhaseCalls[index].fetch_add(1, std::memory_order_relaxed);
+
+	if (IsTracing()) {
+		const auto threadIndex = JobPool::GetCurrentThreadIndex();
+		if (threadIndex >= m_ThreadTraceEvents.size()) {
+			// Not an update thread.
+			return;
+		}
+
+		auto& traceEvents = m_ThreadTraceEvents[threadIndex];
+		if (traceEvents.size() < m_MaxTraceEventsPerThread) {
+			traceEvents.push_back({ phase, startTimestamp, endTimestamp });
+		}
+	}
+}
+
+void Profiler::StartTrace(size_t maxEventsPerThread, size_t maxFrames)
+{
+	for (auto& traceEvents : m_ThreadTraceEvents) {
+		traceEvents.clear();
+	}
+	m_TraceFrames.clear();
+
+	m_MaxTraceEventsPerThread = maxEventsPerThread;
+	m_MaxTraceFrames = maxFrames;
+	m_TraceStartTimestamp = GetTimestamp();
+	m_IsTracing.store(true, std::memory_order_relaxed);
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filename)
+{
+	m_IsTracing.store(false, std::memory_order_relaxed);
+
+	std::ofstream ofs(filename);
+	if (!ofs.is_open() || ofs.bad()) {
+		DEBUG_ERROR() << "Failed to write profiler trace. Couldn't open file \'" << filename << "\' for writing.";
+		return false;
+	}
+
+	rapidjson::OStreamWrapper stream(ofs);
+	rapidjson::Writer<rapidjson::OStreamWrapper> writer(stream);
+
+	// Trace timestamps are in microseconds, relative to the start of the trace.
+	auto toMicroseconds = [this](uint64_t timestamp) {
+		return (timestamp - std::min(timestamp, m_TraceStartTimestamp)) * 1.0e-3;
+	};
+
+	writer.StartObject();
+	writer.Key("displayTimeUnit");
+	writer.String("ms");
+	writer.Key("traceEvents");
+	writer.StartArray();
+
+	for (size_t threadIndex = 0; threadIndex < m_ThreadTraceEvents.size(); ++threadIndex) {
+		// Name the thread, so the update threads are labelled in the viewer.
+		const auto threadName = threadIndex == 0 ? std::string("Main") : "Update Thread " + std::to_string(threadIndex);
+
+		writer.StartObject();
+		writer.Key("name");
+		writer.String("thread_name");
+		writer.Key("ph");
+		writer.String("M");
+		writer.Key("pid");
+		writer.Uint(0);
+		writer.Key("tid");
+		writer.Uint64(threadIndex);
+		writer.Key("args");
+		writer.StartObject();
+		writer.Key("name");
+		writer.String(threadName.c_str());
+		writer.EndObject();
+		writer.EndObject();
+
+		for (const auto& traceEvent : m_ThreadTraceEvents[threadIndex]) {
+			writer.StartObject();
+			writer.Key("name");
+			writer.String(GetName(traceEvent.phase));
+			writer.Key("cat");
+			writer.String("SceneGraph");
+			writer.Key("ph");
+			writer.String("X");
+			writer.Key("ts");
+			writer.Double(toMicroseconds(traceEvent.startTimestamp));
+			writer.Key("dur");
+			writer.Double((traceEvent.endTimestamp - traceEvent.startTimestamp) * 1.0e-3);
+			writer.Key("pid");
+			writer.Uint(0);
+			writer.Key("tid");
+			writer.Uint64(threadIndex);
+			writer.EndObject();
+		}
+	}
+
+	// A counter event per counter, so each is graphed on its own track.
+	for (const auto& traceFrame : m_TraceFrames) {
+		for (size_t i = 0; i < traceFrame.counters.size(); ++i) {
+			writer.StartObject();
+			writer.Key("name");
+			writer.String(GetName(static_cast<ProfileCounter>(i)));
+			writer.Key("ph");
+			writer.String("C");
+			writer.Key("ts");
+			writer.Double(toMicroseconds(traceFrame.endTimestamp));
+			writer.Key("pid");
+			writer.Uint(0);
+			writer.Key("args");
+			writer.StartObject();
+			writer.Key("value");
+			writer.Uint64(traceFrame.counters[i]);
+			writer.EndObject();
+			writer.EndObject();
+		}
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+
+	ofs.flush();
+	if (ofs.bad()) {
+		DEBUG_ERROR() << "Failed to write profiler trace. Couldn't write file \'" << filename << "\'.";
+		return false;
+	}
+
+	return true;
+}
+
+const char* Profiler::GetName(ProfilePhase phase)
+{
+	switch (phase) {
+		case ProfilePhase::UPDATE: {
+			return "Update";
+		}
+		case ProfilePhase::DESTROY_PENDING_ACTORS: {
+			return "DestroyPendingActors";
+		}
+		case ProfilePhase::RESOLVE_COLLISIONS: {
+			return "ResolveCollisions";
+		}
+		case ProfilePhase::RENDER_TILE_MAPS: {
+			return "RenderTileMaps";
+		}
+		case ProfilePhase::RENDER_ACTORS: {
+			return "RenderActors";
+		}
+		case ProfilePhase::RAYCAST: {
+			return "Raycast";
+		}
+		default: {
+			break;
+		}
+	}
+
+	return "Unknown";
+}
+
+const char* Profiler::GetName(ProfileCounter counter)
+{
+	switch (counter) {
+		case ProfileCounter::TILES_VISITED: {
+			return "Tiles Visited";
+		}
+		case ProfileCounter::TILES_DRAWN: {
+			return "Tiles Drawn";
+		}
+		case ProfileCounter::SPRITES_SUBMITTED: {
+			return "Sprites Submitted";
+		}
+		case ProfileCounter::SPATIAL_INDEX_DEPTH: {
+			return "Spatial Index Depth";
+		}
+		case ProfileCounter::SPATIAL_INDEX_CELLS: {
+			return "Spatial Index Cells";
+		}
+		case ProfileCounter::COLLISION_PAIRS_TESTED: {
+			return "Collision Pairs Tested";
+		}
+		case ProfileCounter::RAYCASTS: {
+			return "Raycasts";
+		}
+		default: {
+			break;
+		}
+	}
+
+	return "Unknown";
+}
+
+uint64_t Profiler::GetTimestamp()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+// Library Includes
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** The phases of a frame timed by a Profiler. */
+enum class ProfilePhase {
+	UPDATE,
+	DESTROY_PENDING_ACTORS,
+	RESOLVE_COLLISIONS,
+	RENDER_TILE_MAPS,
+	RENDER_ACTORS,
+	RAYCAST,
+
+	COUNT
+};
+
+/** The counters of a frame kept by a Profiler. */
+enum class ProfileCounter {
+	// Tiles on screen, and tile sprites drawn for them.
+	TILES_VISITED,
+	TILES_DRAWN,
+	// Sprites handed to the renderer, tiles and actors.
+	SPRITES_SUBMITTED,
+	// Depth of the deepest cell of the spatial index holding an actor, and the number of cells holding actors.
+	SPATIAL_INDEX_DEPTH,
+	SPATIAL_INDEX_CELLS,
+	// Candidate pairs tested by the collision world.
+	COLLISION_PAIRS_TESTED,
+	// Rays cast through the scene graph's raycast queries.
+	RAYCASTS,
+
+	COUNT
+};
+
+/** The times and counters of a single frame. */
+struct ProfileFrame {
+	// The total time spent in each phase, in nanoseconds, summed over every thread.
+	std::array<uint64_t, static_cast<size_t>(ProfilePhase::COUNT)> phaseNanoseconds = {};
+	// The number of times each phase was entered.
+	std::array<uint64_t, static_cast<size_t>(ProfilePhase::COUNT)> phaseCalls = {};
+	std::array<uint64_t, static_cast<size_t>(ProfileCounter::COUNT)> counters = {};
+};
+
+/** Times the phases of a frame and keeps per frame counters, for seeing where frame time goes.
+@remarks
+	Phases are timed by PROFILE_SCOPE() and counters kept by PROFILE_COUNT() and PROFILE_SET_COUNTER(), which
+	only do anything when built with BANANAFIGHTER_ENABLE_PROFILER defined. Otherwise they compile to nothing,
+	and every frame reads as zero.
+@par
+	BeginFrame() closes the frame so far, which is then returned by GetLastFrame(). Between StartTrace() and
+	WriteChromeTrace(), every timed scope is also recorded as an event, along with the counters of each frame,
+	and written in the Chrome trace event format, which can be opened in chrome://tracing or Perfetto.
+@par
+	Timing and counting is safe from any thread of the update job pool, see SetNumThreads(). Everything else
+	must be called from the thread calling SceneGraph::Update().
+*/
+class Profiler {
+	// Member Functions
+public:
+	/** Default constructor. */
+	Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	/** Set the number of threads scopes are timed on, indexed by JobPool::GetCurrentThreadIndex(). */
+	void SetNumThreads(size_t numThreads);
+
+	/** Close the current frame and start the next. */
+	void BeginFrame();
+
+	/** Get the times and counters of the frame closed by the last BeginFrame(). */
+	const ProfileFrame& GetLastFrame() const { return m_LastFrame; }
+
+	/** Get the total time spent in a phase during the last frame, in milliseconds. */
+	double GetPhaseMilliseconds(ProfilePhase phase) const { return m_LastFrame.phaseNanoseconds[static_cast<size_t>(phase)] * 1.0e-6; }
+
+	/** Get the number of times a phase was entered during the last frame. */
+	uint64_t GetPhaseCalls(ProfilePhase phase) const { return m_LastFrame.phaseCalls[static_cast<size_t>(phase)]; }
+
+	/** Get the value of a counter at the end of the last frame. */
+	uint64_t GetCounter(ProfileCounter counter) const { return m_LastFrame.counters[static_cast<size_t>(counter)]; }
+
+	/** Add the time spent in a single call of a phase. */
+	void AddTime(ProfilePhase phase, uint64_t startTimestamp, uint64_t endTimestamp);
+
+	/** Add to a counter of the current frame. */
+	void AddToCounter(ProfileCounter counter, uint64_t amount)
+	{
+		m_Counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	/** Set a counter of the current frame. */
+	void SetCounter(ProfileCounter counter, uint64_t value)
+	{
+		m_Counters[static_cast<size_t>(counter)].store(value, std::memory_order_relaxed);
+	}
+
+	/** Start recording the timed scopes and frame counters for WriteChromeTrace(), discarding any earlier trace.
+		@param maxEventsPerThread The most scopes recorded per thread, after which the rest are dropped, so a
+			forgotten trace can't use up all memory.
+		@param maxFrames The most frames whose counters are recorded, after which the rest are dropped.
+	*/
+	void StartTrace(size_t maxEventsPerThread = s_DefaultMaxTraceEventsPerThread, size_t maxFrames = s_DefaultMaxTraceFrames);
+
+	/** Get whether a trace is being recorded. */
+	bool IsTracing() const { return m_IsTracing.load(std::memory_order_relaxed); }
+
+	/** Stop recording and write the trace as Chrome trace event JSON.
+		@return False if the file couldn't be written.
+	*/
+	bool WriteChromeTrace(const std::string& filename);
+
+	/** Get the name of a phase, as used in traces. */
+	static const char* GetName(ProfilePhase phase);
+
+	/** Get the name of a counter, as used in traces. */
+	static const char* GetName(ProfileCounter counter);
+
+	/** Get the current time in nanoseconds on a steady clock. */
+	static uint64_t GetTimestamp();
+private:
+	/** A single call of a timed phase recorded in a trace. */
+	struct TraceEvent {
+		ProfilePhase phase;
+		uint64_t startTimestamp;
+		uint64_t endTimestamp;
+	};
+
+	/** The counters of a single frame recorded in a trace. */
+	struct TraceFrame {
+		uint64_t endTimestamp;
+		std::array<uint64_t, static_cast<size_t>(ProfileCounter::COUNT)> counters;
+	};
+
+	// Member Variables
+public:
+	// Whether this build was made with the profiler.
+#if defined(BANANAFIGHTER_ENABLE_PROFILER)
+	static constexpr bool s_IsEnabled = true;
+#else
+	static constexpr bool s_IsEnabled = false;
+#endif
+
+	// The most scopes recorded per thread by a trace, unless set otherwise.
+	static constexpr size_t s_DefaultMaxTraceEventsPerThread = 1 << 20;
+	// The most frames whose counters are recorded by a trace, unless set otherwise. An hour at 60 frames a second.
+	static constexpr size_t s_DefaultMaxTraceFrames = 60 * 60 * 60;
+private:
+	// The current frame, added to from any update thread.
+	std::array<std::atomic<uint64_t>, static_cast<size_t>(ProfilePhase::COUNT)> m_PhaseNanoseconds;
+	std::array<std::atomic<uint64_t>, static_cast<size_t>(ProfilePhase::COUNT)> m_PhaseCalls;
+	std::array<std::atomic<uint64_t>, static_cast<size_t>(ProfileCounter::COUNT)> m_Counters;
+
+	ProfileFrame m_LastFrame;
+
+	// The trace being recorded, with the scopes of each thread kept apart so recording needs no lock.
+	std::atomic<bool> m_IsTracing = { false };
+	size_t m_MaxTraceEventsPerThread = { s_DefaultMaxTraceEventsPerThread };
+	size_t m_MaxTraceFrames = { s_DefaultMaxTraceFrames };
+	uint64_t m_TraceStartTimestamp = { 0 };
+	std::vector<std::vector<TraceEvent>> m_ThreadTraceEvents;
+	std::vector<TraceFrame> m_TraceFrames;
+};
+
+/** Times the scope it is declared in as a call of a phase. See PROFILE_SCOPE(). */
+class ScopedProfileTimer {
+	// Member Functions
+public:
+	/** Constructor. Starts timing. */
+	ScopedProfileTimer(Profiler& profiler, ProfilePhase phase)
+		:m_ProfilerRef(profiler),
+		m_Phase(phase),
+		m_StartTimestamp(Profiler::GetTimestamp())
+	{
+	}
+
+	/** Destructor. Adds the time since construction to the phase. */
+	~ScopedProfileTimer() { m_ProfilerRef.AddTime(m_Phase, m_StartTimestamp, Profiler::GetTimestamp()); }
+
+	ScopedProfileTimer(const ScopedProfileTimer&) = delete;
+	ScopedProfileTimer& operator=(const ScopedProfileTimer&) = delete;
+
+	// Member Variables
+private:
+	Profiler& m_ProfilerRef;
+	ProfilePhase m_Phase;
+	uint64_t m_StartTimestamp;
+};
+
+#define PROFILE_CONCAT_INNER(lhs, rhs) lhs##rhs
+#define PROFILE_CONCAT(lhs, rhs) PROFILE_CONCAT_INNER(lhs, rhs)
+
+#if defined(BANANAFIGHTER_ENABLE_PROFILER)
+	/** Time the rest of the enclosing scope as a call of a phase. */
+	#define PROFILE_SCOPE(profiler, phase) ScopedProfileTimer PROFILE_CONCAT(profileTimer, __LINE__)((profiler), (phase))
+	/** Add to a counter. The amount isn't evaluated in builds without the profiler. */
+	#define PROFILE_COUNT(profiler, counter, amount) (profiler).AddToCounter((counter), static_cast<uint64_t>(amount))
+	/** Set a counter. The value isn't evaluated in builds without the profiler. */
+	#define PROFILE_SET_COUNTER(profiler, counter, value) (profiler).SetCounter((counter), static_cast<uint64_t>(value))
+#else
+	#define PROFILE_SCOPE(profiler, phase) ((void)0)
+	#define PROFILE_COUNT(profiler, counter, amount) ((void)0)
+	#define PROFILE_SET_COUNTER(profiler, counter, value) ((void)0)
+#endif
+
+#endif	// __PROFILER_H__
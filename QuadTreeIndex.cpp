@@ -0,0 +1,195 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <functional>
+
+// This Include
+#include "QuadTreeIndex.h"
+
+// Local Includes
+#include "CollisionWorld.h"
+#include "Actor/Actor.h"
+
+QuadTreeIndex::QuadTreeIndex(const Rect<float>& boundingBox, size_t maxActorsPerCell)
+	:m_Root(nullptr, boundingBox, maxActorsPerCell)
+{
+}
+
+bool QuadTreeIndex::RemoveActor(Actor* pActor)
+{
+	auto pCell = pActor->GetQuadTreeCell();
+	if (pCell) {
+		return pCell->RemoveActor(pActor);
+	}
+	else {
+		return false;
+	}
+}
+
+void QuadTreeIndex::RelocateActor(Actor* pActor)
+{
+	auto pCell = pActor->GetQuadTreeCell();
+	if (!pCell) {
+		return;
+	}
+
+	const auto& position = pActor->GetPosition();
+	auto containsActor = [&position](const QuadTreeCell* pCandidate, float margin) {
+		const auto& boundingBox = pCandidate->GetBoundingBox();
+		const auto marginX = boundingBox.GetWidth() * margin;
+		const auto marginY = boundingBox.GetHeight() * margin;
+
+		return position.X() >= boundingBox.GetLeft() - marginX && position.X() < boundingBox.GetRight() + marginX &&
+			position.Y() >= boundingBox.GetTop() - marginY && position.Y() < boundingBox.GetBottom() + marginY;
+	};
+
+	// Actors may stray a little past the edge of a cell before leaving it, so an actor hovering on the boundary
+	// doesn't merge and split the cells each time it crosses. The root has nowhere to move actors to instead.
+	const auto margin = pCell != &m_Root ? s_RelocationMargin : 0.0f;
+	if (containsActor(pCell, margin)) {
+		// Still within its cell.
+		return;
+	}
+
+	// Walk up to the smallest ancestor that contains the actor's new position.
+	auto pAncestor = pCell->GetParent();
+	while (pAncestor && !containsActor(pAncestor, 0.0f)) {
+		pAncestor = pAncestor->GetParent();
+	}
+
+	if (!pAncestor) {
+		pAncestor = &m_Root;
+	}
+
+	// Then insert back down from the ancestor.
+	pCell->RemoveActor(pActor);
+	if (pAncestor->InsertActor(pActor)) {
+		return;
+	}
+
+	// Only an actor outside the root can't be inserted, and the scene graph only clamps the actors with colliders
+	// into the root, so clamp any other actor here rather than dropping it from the index.
+	const auto& rootBoundingBox = m_Root.GetBoundingBox();
+	const Point<float> clampedPosition = {
+		std::min(std::max(position.X(), rootBoundingBox.GetLeft()), std::nextafter(rootBoundingBox.GetRight(), rootBoundingBox.GetLeft())),
+		std::min(std::max(position.Y(), rootBoundingBox.GetTop()), std::nextafter(rootBoundingBox.GetBottom(), rootBoundingBox.GetTop()))
+	};
+	pActor->SetPosition(clampedPosition);
+
+	const auto isInserted = m_Root.InsertActor(pActor);
+	assert(isInserted);
+	(void)isInserted;
+}
+
+Actor* QuadTreeIndex::RaycastFirstHit(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore)
+{
+	return m_Root.RaycastFirstHit(origin, end, actorsToIgnore.GetActors());
+}
+
+void QuadTreeIndex::Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, std::vector<Actor*>& actorsHit)
+{
+	// Copy the hits across rather than assigning, so the caller's buffer keeps its capacity.
+	const auto hits = m_Root.Raycast(origin, end, actorsToIgnore.GetActors());
+
+	actorsHit.clear();
+	actorsHit.insert(actorsHit.end(), hits.begin(), hits.end());
+}
+
+void QuadTreeIndex::Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, const ActorVisitor& visitor)
+{
+	for (auto pActor : m_Root.Raycast(origin, end, actorsToIgnore.GetActors())) {
+		if (!visitor(pActor)) {
+			break;
+		}
+	}
+}
+
+Actor* QuadTreeIndex::RaycastFirstHitSkipping(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, const Actor* pCaster)
+{
+	if (!pCaster || actorsToIgnore.Contains(pCaster)) {
+		return m_Root.RaycastFirstHit(origin, end, actorsToIgnore.GetActors());
+	}
+
+	thread_local std::vector<Actor*> s_ActorsToIgnore;
+
+	s_ActorsToIgnore.assign(actorsToIgnore.GetActors().begin(), actorsToIgnore.GetActors().end());
+	s_ActorsToIgnore.push_back(const_cast<Actor*>(pCaster));
+
+	return m_Root.RaycastFirstHit(origin, end, s_ActorsToIgnore);
+}
+
+void QuadTreeIndex::QueryAABB(const Rect<float>& wBox, const ActorVisitor& visitor)
+{
+	// A list per nesting depth, so visitors may run queries of their own. A deque, as growing it doesn't move the
+	// lists of the outer queries.
+	thread_local std::deque<std::vector<Actor*>> s_ActorLists;
+	thread_local size_t s_Depth = 0;
+
+	if (s_ActorLists.size() <= s_Depth) {
+		s_ActorLists.emplace_back();
+	}
+
+	auto& actors = s_ActorLists[s_Depth];
+	actors.clear();
+	m_Root.AppendActorList(actors, false);
+
+	++s_Depth;
+
+	for (auto pActor : actors) {
+		const auto& position = pActor->GetPosition();
+		if (position.X() < wBox.GetLeft() || position.X() > wBox.GetRight() ||
+			position.Y() < wBox.GetTop() || position.Y() > wBox.GetBottom()) {
+			continue;
+		}
+
+		if (!visitor(pActor)) {
+			break;
+		}
+	}
+
+	--s_Depth;
+}
+
+void QuadTreeIndex::ResolveCollisions(
+	CollisionWorld& collisionWorld,
+	const ActorStore& actors,
+	const std::vector<const Actor*>& sortedMovedActors,
+	const std::function<void(Actor*)>& onActorMoved)
+{
+	// The cells can't list the pairs of actors in neighbouring cells, so let the collision world sweep for them.
+	collisionWorld.ResolveCollisions(actors, sortedMovedActors, onActorMoved);
+}
+
+void QuadTreeIndex::GetCellStats(size_t& depth, size_t& numOccupiedCells)
+{
+	thread_local std::vector<Actor*> s_Actors;
+	thread_local std::vector<const QuadTreeCell*> s_Cells;
+
+	s_Actors.clear();
+	m_Root.AppendActorList(s_Actors, false);
+
+	s_Cells.clear();
+	for (auto pActor : s_Actors) {
+		s_Cells.push_back(pActor->GetQuadTreeCell());
+	}
+
+	std::sort(s_Cells.begin(), s_Cells.end(), std::less<const QuadTreeCell*>());
+	s_Cells.erase(std::unique(s_Cells.begin(), s_Cells.end()), s_Cells.end());
+
+	depth = 1;
+	for (auto pCell : s_Cells) {
+		size_t cellDepth = 1;
+		for (auto pParent = pCell->GetParent(); pParent; pParent = pParent->GetParent()) {
+			++cellDepth;
+		}
+
+		depth = std::max(depth, cellDepth);
+	}
+
+	numOccupiedCells = s_Cells.size();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#ifndef __QUADTREEINDEX_H__
+#define __QUADTREEINDEX_H__
+
+// Local Includes
+#include "SpatialIndex.h"
+#include "QuadTreeCell.h"
+
+/** Spatial index backed by a QuadTreeCell hierarchy. */
+class QuadTreeIndex : public SpatialIndex {
+	// Member Functions
+public:
+	/** Default constructor.
+		@param boundingBox The world space bounds of the root cell.
+		@param maxActorsPerCell The maximum amount of actors allowed in a single cell before the cell subdivides.
+	*/
+	QuadTreeIndex(const Rect<float>& boundingBox, size_t maxActorsPerCell);
+
+	bool InsertActor(Actor* pActor) override { return m_Root.InsertActor(pActor); }
+	bool RemoveActor(Actor* pActor) override;
+
+	/** @copydoc SpatialIndex::RelocateActor()
+		@remarks
+			Walks up from the actor's current cell to the smallest ancestor containing the actor, then inserts the
+			actor down from there, so actors that moved a short distance don't touch the rest of the tree.
+		@par
+			An actor only leaves its cell once it is further than a fraction of the cell's size past its edge, so
+			actors hovering on a boundary don't make the cells split and merge every frame. Actors moved outside 
+			the root are clamped back inside it.
+	*/
+	void RelocateActor(Actor* pActor) override;
+
+	Actor* RaycastFirstHit(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore) override;
+	void Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, std::vector<Actor*>& actorsHit) override;
+
+	/** @copydoc SpatialIndex::Raycast(const Point<float>&, const Point<float>&, const ActorIgnoreList&, const ActorVisitor&)
+		@remarks QuadTreeCell returns its hits as a new vector, which is allocated whatever the visitor does with them.
+	*/
+	void Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, const ActorVisitor& visitor) override;
+
+	/** @copydoc SpatialIndex::QueryAABB()
+		@remarks 
+			QuadTreeCell has no region query of its own and its children can't be descended from outside it, 
+			so the query gathers every actor in the tree and tests each one, which is O(N) however small the 
+			box. Use a UNIFORM_GRID for scenes that query often.
+	*/
+	void QueryAABB(const Rect<float>& wBox, const ActorVisitor& visitor) override;
+
+	bool IsQueryAABBLocal() const override { return false; }
+
+	void Render(SceneGraph& sceneGraph) override { m_Root.Render(sceneGraph); }
+
+	/** @copydoc SpatialIndex::ResolveCollisions()
+		@remarks
+			QuadTreeCell only exposes the actors of a cell, not its neighbours, so the tree can't list the pairs 
+			of actors straddling a cell boundary. The collisions are left to the collision world's own sort and 
+			sweep broadphase instead, so contacts are still cached, resting contacts skipped, pairs of sleeping 
+			actors dropped, and contact events reported.
+	*/
+	void ResolveCollisions(
+		CollisionWorld& collisionWorld,
+		const ActorStore& actors,
+		const std::vector<const Actor*>& sortedMovedActors,
+		const std::function<void(Actor*)>& onActorMoved) override;
+
+	const Rect<float>& GetBoundingBox() const override { return m_Root.GetBoundingBox(); }
+
+	void SetMaxNumActorsPerCell(size_t maxNumActors) override { m_Root.SetMaxNumActors(maxNumActors, true); }
+	size_t GetMaxNumActorsPerCell() const override { return m_Root.GetMaxNumActors(); }
+
+	/** @copydoc SpatialIndex::GetCellStats()
+		@remarks Found by walking up from the cell of every actor, as QuadTreeCell doesn't expose its children.
+	*/
+	void GetCellStats(size_t& depth, size_t& numOccupiedCells) override;
+
+protected:
+	/** @copydoc SpatialIndex::RaycastFirstHitSkipping()
+		@remarks
+			QuadTreeCell takes its ignored actors as a vector, so the caster is appended to a copy of the list 
+			kept by the calling thread, which only allocates when the list outgrows it.
+	*/
+	Actor* RaycastFirstHitSkipping(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, const Actor* pCaster) override;
+
+	// Member Variables
+private:
+	QuadTreeCell m_Root;
+
+	// How far past the edge of its cell an actor may move before it is relocated, as a fraction of the cell's size.
+	static constexpr float s_RelocationMargin = 0.125f;
+};
+
+#endif	// __QUADTREEINDEX_H__
@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef __RADIXSORT_H__
+#define __RADIXSORT_H__
+
+// Library Includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/** Sort values by a 64 bit unsigned key, least significant byte first.
+@remarks
+	Stable, and linear in the number of values. Bytes that are the same for every key are skipped, so keys that
+	only differ in a few bytes only take a few passes.
+@param values The values to sort.
+@param scratch A buffer the same values are moved through between passes. Kept by the caller so its capacity is
+	reused between sorts.
+@param getKey Called as getKey(value) to get the key of a value. Called once per value per pass, so it should
+	be cheap, e.g. reading a member.
+*/
+template<typename T, typename GetKey>
+void RadixSort(std::vector<T>& values, std::vector<T>& scratch, GetKey&& getKey)
+{
+	static constexpr size_t s_NumBuckets = 256;
+
+	const auto count = values.size();
+	if (count < 2) {
+		return;
+	}
+
+	// Count every byte of every key up front, so passes that wouldn't move anything are known before starting.
+	std::array<std::array<size_t, s_NumBuckets>, sizeof(uint64_t)> counts = {};
+	for (const auto& value : values) {
+		const uint64_t key = getKey(value);
+		for (size_t pass = 0; pass < sizeof(uint64_t); ++pass) {
+			++counts[pass][(key >> (pass * 8)) & 0xFF];
+		}
+	}
+
+	scratch.resize(count);
+
+	for (size_t pass = 0; pass < sizeof(uint64_t); ++pass) {
+		auto& passCounts = counts[pass];
+
+		const uint64_t firstByte = (getKey(values.front()) >> (pass * 8)) & 0xFF;
+		if (passCounts[firstByte] == count) {
+			// Every key has the same byte.
+			continue;
+		}
+
+		// Turn the counts into the offset of each bucket.
+		size_t offset = 0;
+		for (auto& bucket : passCounts) {
+			const auto bucketCount = bucket;
+			bucket = offset;
+			offset += bucketCount;
+		}
+
+		for (auto& value : values) {
+			const auto byte = (getKey(value) >> (pass * 8)) & 0xFF;
+			scratch[passCounts[byte]++] = std::move(value);
+		}
+
+		values.swap(scratch);
+	}
+}
+
+#endif	// __RADIXSORT_H__
@@ -0,0 +1,282 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+// This Include
+#include "SceneBenchmark.h"
+
+namespace {
+	/** Random numbers that are the same on every platform for the same seed. */
+	class BenchmarkRandom {
+		// Member Functions
+	public:
+		explicit BenchmarkRandom(uint32_t seed) : m_Engine(seed) {}
+
+		/** Get a float in [0, 1), from the top 24 bits of the engine so every value is exact. */
+		float NextFloat() { return static_cast<float>(m_Engine() >> 8) * (1.0f / 16777216.0f); }
+
+		/** Get a float in [min, max). */
+		float NextFloat(float min, float max) { return min + NextFloat() * (max - min); }
+
+		/** Get a point in a box. */
+		Point<float> NextPoint(const Rect<float>& wBounds)
+		{
+			return Point<float>(NextFloat(wBounds.GetLeft(), wBounds.GetRight()), NextFloat(wBounds.GetTop(), wBounds.GetBottom()));
+		}
+
+		// Member Variables
+	private:
+		std::mt19937 m_Engine;
+	};
+
+	/** Gathers the times of a part of a frame over many frames. */
+	class TimingAccumulator {
+		// Member Functions
+	public:
+		/** Add a time between two Profiler::GetTimestamp() timestamps. */
+		void Add(uint64_t startTimestamp, uint64_t endTimestamp)
+		{
+			const auto milliseconds = (endTimestamp - startTimestamp) * 1.0e-6;
+
+			m_Total += milliseconds;
+			m_Min = std::min(m_Min, milliseconds);
+			m_Max = std::max(m_Max, milliseconds);
+			++m_Count;
+		}
+
+		SceneBenchmarkTiming GetTiming() const
+		{
+			if (m_Count == 0) {
+				return SceneBenchmarkTiming();
+			}
+
+			return { m_Total / m_Count, m_Min, m_Max };
+		}
+
+		// Member Variables
+	private:
+		double m_Total = { 0.0 };
+		double m_Min = { std::numeric_limits<double>::max() };
+		double m_Max = { 0.0 };
+		size_t m_Count = { 0 };
+	};
+}
+
+SceneBenchmarkResult SceneBenchmark::Run(SceneGraph& sceneGraph, const SceneBenchmarkConfig& config)
+{
+	SceneBenchmarkResult result;
+
+	// Through the const overload, as the other hands the tile map out for editing.
+	const auto& tileMap = static_cast<const SceneGraph&>(sceneGraph).GetTileMap();
+	const Rect<float> wBounds = { -0.5f, -0.5f, static_cast<float>(tileMap.GetWidth()), static_cast<float>(tileMap.GetLength()) };
+
+	// Restored afterwards, so the scene is left as it was found.
+	const auto previousMaxActorsPerCell = sceneGraph.GetMaxNumActorsPerCell();
+	const auto previousRenderPerspective = sceneGraph.GetRenderPerspective();
+	const auto previousZoom = sceneGraph.GetZoom();
+
+	if (config.maxActorsPerCell != 0) {
+		sceneGraph.SetMaxNumActorsPerCell(config.maxActorsPerCell);
+	}
+
+	sceneGraph.SetRenderPerspective(config.renderPerspective);
+	sceneGraph.SetZoom(config.zoom);
+
+	std::vector<Point<float>> wPositions;
+	GeneratePositions(config, wBounds, wPositions);
+
+	std::vector<Actor*> spawnedActors(wPositions.size());
+
+	TimingAccumulator spawn;
+	{
+		const auto start = Profiler::GetTimestamp();
+		result.numActors = sceneGraph.SpawnActors(config.actorXmlFilename, wPositions.data(), wPositions.size(), 0.0f, spawnedActors.data());
+		spawn.Add(start, Profiler::GetTimestamp());
+	}
+
+	// Handles, as the actors may destroy themselves during the frames.
+	std::vector<ActorHandle> spawnedHandles;
+	spawnedHandles.reserve(result.numActors);
+	for (auto pActor : spawnedActors) {
+		if (pActor) {
+			spawnedHandles.push_back(sceneGraph.GetActorHandle(pActor));
+		}
+	}
+
+	// Queries draw from their own stream, so the rays cast don't change with the number of actors.
+	BenchmarkRandom queryRandom(config.seed ^ 0x9E3779B9u);
+
+	TimingAccumulator update;
+	TimingAccumulator resolveCollisions;
+	TimingAccumulator raycasts;
+	TimingAccumulator picks;
+	TimingAccumulator render;
+	TimingAccumulator renderTileMaps;
+
+	std::vector<Actor*> actorsHit;
+
+	const auto numFrames = config.numWarmUpFrames + config.numFrames;
+	for (size_t frame = 0; frame < numFrames; ++frame) {
+		const auto isMeasured = frame >= config.numWarmUpFrames;
+
+		auto start = Profiler::GetTimestamp();
+		sceneGraph.Update(config.deltaTime);
+		auto end = Profiler::GetTimestamp();
+		if (isMeasured) {
+			update.Add(start, end);
+		}
+
+		start = Profiler::GetTimestamp();
+		sceneGraph.ResolveCollisions();
+		end = Profiler::GetTimestamp();
+		if (isMeasured) {
+			resolveCollisions.Add(start, end);
+		}
+
+		if (config.numRaycastsPerFrame != 0) {
+			start = Profiler::GetTimestamp();
+			for (size_t i = 0; i < config.numRaycastsPerFrame; ++i) {
+				const auto origin = queryRandom.NextPoint(wBounds);
+				const auto target = queryRandom.NextPoint(wBounds);
+
+				if (config.isRaycastingAllHits) {
+					actorsHit.clear();
+					sceneGraph.Raycast(origin, target, actorsHit, {});
+				}
+				else {
+					sceneGraph.RaycastFirstHit(origin, target, {});
+				}
+			}
+			end = Profiler::GetTimestamp();
+			if (isMeasured) {
+				raycasts.Add(start, end);
+			}
+		}
+
+		if (config.numPicksPerFrame != 0) {
+			start = Profiler::GetTimestamp();
+			for (size_t i = 0; i < config.numPicksPerFrame; ++i) {
+				const auto sPosition = sceneGraph.ToScreenPosition(queryRandom.NextPoint(wBounds), 0.0f);
+				sceneGraph.PickActor(Point<>(static_cast<int>(sPosition.X()), static_cast<int>(sPosition.Y())));
+			}
+			end = Profiler::GetTimestamp();
+			if (isMeasured) {
+				picks.Add(start, end);
+			}
+		}
+
+		if (config.isRendering) {
+			start = Profiler::GetTimestamp();
+			sceneGraph.Render();
+			end = Profiler::GetTimestamp();
+			if (isMeasured) {
+				render.Add(start, end);
+			}
+		}
+
+		if (config.isRenderingTileMaps) {
+			start = Profiler::GetTimestamp();
+			sceneGraph.RenderTileMaps();
+			end = Profiler::GetTimestamp();
+			if (isMeasured) {
+				renderTileMaps.Add(start, end);
+			}
+		}
+	}
+
+	result.lastFrame = sceneGraph.GetProfiler().GetLastFrame();
+
+	TimingAccumulator serialize;
+	if (!config.serializeFilename.empty()) {
+		const auto start = Profiler::GetTimestamp();
+		sceneGraph.Serialize(config.serializeFilename, false);
+		serialize.Add(start, Profiler::GetTimestamp());
+	}
+
+	sceneGraph.DestroyActors(spawnedHandles.data(), spawnedHandles.size());
+
+	sceneGraph.SetMaxNumActorsPerCell(previousMaxActorsPerCell);
+	sceneGraph.SetRenderPerspective(previousRenderPerspective);
+	sceneGraph.SetZoom(previousZoom);
+
+	result.spawn = spawn.GetTiming();
+	result.update = update.GetTiming();
+	result.resolveCollisions = resolveCollisions.GetTiming();
+	result.raycasts = raycasts.GetTiming();
+	result.picks = picks.GetTiming();
+	result.render = render.GetTiming();
+	result.renderTileMaps = renderTileMaps.GetTiming();
+	result.serialize = serialize.GetTiming();
+
+	return result;
+}
+
+std::vector<SceneBenchmarkSweepRun> SceneBenchmark::Sweep(SceneGraph& sceneGraph, const SceneBenchmarkConfig& config, const std::vector<float>& zooms, const std::vector<size_t>& numActors)
+{
+	const RenderPerspective renderPerspectives[] = { RenderPerspective::ISOMETRIC, RenderPerspective::OBLIQUE };
+
+	std::vector<SceneBenchmarkSweepRun> runs;
+	runs.reserve(2 * zooms.size() * numActors.size());
+
+	for (const auto renderPerspective : renderPerspectives) {
+		for (const auto zoom : zooms) {
+			for (const auto runNumActors : numActors) {
+				auto runConfig = config;
+				runConfig.renderPerspective = renderPerspective;
+				runConfig.zoom = zoom;
+				runConfig.numActors = runNumActors;
+
+				runs.push_back({ renderPerspective, zoom, runNumActors, Run(sceneGraph, runConfig) });
+			}
+		}
+	}
+
+	return runs;
+}
+
+void SceneBenchmark::GeneratePositions(const SceneBenchmarkConfig& config, const Rect<float>& wBounds, std::vector<Point<float>>& wPositions)
+{
+	BenchmarkRandom random(config.seed);
+
+	wPositions.clear();
+	wPositions.reserve(config.numActors);
+
+	switch (config.distribution) {
+		case ActorDistribution::CLUSTERED: {
+			// Pick the centres first, so the clusters don't move with the number of actors.
+			std::vector<Point<float>> wCentres;
+			for (size_t i = 0; i < std::max(config.numClusters, static_cast<size_t>(1)); ++i) {
+				wCentres.push_back(random.NextPoint(wBounds));
+			}
+
+			const auto twoPi = 6.28318530718f;
+			for (size_t i = 0; i < config.numActors; ++i) {
+				const auto& wCentre = wCentres[i % wCentres.size()];
+
+				// Square root of the radius, so the actors are spread evenly over the disc.
+				const auto radius = config.clusterRadius * std::sqrt(random.NextFloat());
+				const auto angle = random.NextFloat() * twoPi;
+
+				// Keep within the bounds, as actors outside them aren't added to the spatial index.
+				const auto x = std::min(std::max(wCentre.X() + radius * std::cos(angle), wBounds.GetLeft()), wBounds.GetRight() - 0.01f);
+				const auto y = std::min(std::max(wCentre.Y() + radius * std::sin(angle), wBounds.GetTop()), wBounds.GetBottom() - 0.01f);
+
+				wPositions.emplace_back(x, y);
+			}
+			break;
+		}
+		case ActorDistribution::UNIFORM:
+		default: {
+			for (size_t i = 0; i < config.numActors; ++i) {
+				wPositions.push_back(random.NextPoint(wBounds));
+			}
+			break;
+		}
+	}
+}
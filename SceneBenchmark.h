@@ -0,0 +1,132 @@
+#pragma once
+
+#ifndef __SCENEBENCHMARK_H__
+#define __SCENEBENCHMARK_H__
+
+// Library Includes
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Local Includes
+#include "SceneGraph.h"
+
+/** How the actors of a benchmark scene are spread over the tile map. */
+enum class ActorDistribution {
+	// Evenly over the whole tile map.
+	UNIFORM,
+	// In a few dense discs, the worst case for cells that subdivide.
+	CLUSTERED
+};
+
+/** The scene a benchmark builds, and what it measures. */
+struct SceneBenchmarkConfig {
+	// Seeds every random choice, so the same config always builds the same scene and casts the same rays.
+	uint32_t seed = { 1 };
+
+	// The actor spawned, and how many of it.
+	std::string actorXmlFilename;
+	size_t numActors = { 1000 };
+	ActorDistribution distribution = { ActorDistribution::UNIFORM };
+	// The number and world space radius of the discs of a CLUSTERED scene.
+	size_t numClusters = { 8 };
+	float clusterRadius = { 8.0f };
+
+	// The spatial index's maximum actors per cell, or 0 to leave it as it is.
+	size_t maxActorsPerCell = { 0 };
+
+	RenderPerspective renderPerspective = { RenderPerspective::ISOMETRIC };
+	float zoom = { 1.0f };
+
+	// The number of frames measured, after the warm up frames that aren't.
+	size_t numFrames = { 100 };
+	size_t numWarmUpFrames = { 10 };
+	float deltaTime = { 1.0f / 60.0f };
+
+	// Queries made every frame, between random points of the tile map.
+	size_t numRaycastsPerFrame = { 0 };
+	size_t numPicksPerFrame = { 0 };
+	// Whether the raycasts find every actor hit, through Raycast(), rather than the first, through RaycastFirstHit().
+	bool isRaycastingAllHits = { false };
+
+	// Whether each frame is rendered.
+	bool isRendering = { true };
+	// Whether the tile maps are also rendered on their own each frame, after the frame is rendered, for timing 
+	// tile drawing without the actors.
+	bool isRenderingTileMaps = { false };
+
+	// If not empty, the scene is also serialized here once after the frames.
+	std::string serializeFilename;
+};
+
+/** The time taken by each part of a benchmark frame, in milliseconds. */
+struct SceneBenchmarkTiming {
+	double mean = { 0.0 };
+	double min = { 0.0 };
+	double max = { 0.0 };
+};
+
+/** What a benchmark measured. */
+struct SceneBenchmarkResult {
+	// The number of actors spawned, which is fewer than asked for if any failed to spawn.
+	size_t numActors = { 0 };
+
+	SceneBenchmarkTiming spawn;
+	SceneBenchmarkTiming update;
+	SceneBenchmarkTiming resolveCollisions;
+	SceneBenchmarkTiming raycasts;
+	SceneBenchmarkTiming picks;
+	SceneBenchmarkTiming render;
+	SceneBenchmarkTiming renderTileMaps;
+	SceneBenchmarkTiming serialize;
+
+	// The last frame closed by the profiler, all zero unless built with BANANAFIGHTER_ENABLE_PROFILER.
+	ProfileFrame lastFrame;
+};
+
+/** The settings of one run of a sweep, and what it measured. */
+struct SceneBenchmarkSweepRun {
+	RenderPerspective renderPerspective;
+	float zoom;
+	size_t numActors;
+	SceneBenchmarkResult result;
+};
+
+/** Builds seeded scenes and times the hot paths of the scene graph on them, for comparing builds.
+@remarks
+	Runs against the scene graph's own renderer and actor factory, so results include them. To time the scene 
+	graph alone, construct it with a renderer that draws nothing and an actor factory that adds no components, 
+	as the executable in Benchmarks does with the stubs in Benchmarks/Stubs. Random numbers are drawn from 
+	std::mt19937 and turned into floats by hand rather than through the standard distributions, whose results 
+	differ between standard libraries, so the scene is the same across platforms as well as commits.
+*/
+namespace SceneBenchmark {
+	/** Build a scene of benchmark actors, then time a number of frames of it.
+		@remarks
+			Actors already in the scene are kept, and are part of what is measured. Only the actors spawned are
+			destroyed afterwards, and the maximum actors per cell, render perspective and zoom are put back, so 
+			runs can follow each other on the same scene.
+		@param sceneGraph The scene to run in, whose tile map the actors are spread over.
+		@param config The scene to build and the frames to run.
+	*/
+	SceneBenchmarkResult Run(SceneGraph& sceneGraph, const SceneBenchmarkConfig& config);
+
+	/** Get the world space positions the actors of a benchmark scene are spawned at.
+		@param config The seed, number of actors and distribution.
+		@param wBounds The world space bounds to spread the actors over.
+		@param wPositions Receives a position per actor.
+	*/
+	void GeneratePositions(const SceneBenchmarkConfig& config, const Rect<float>& wBounds, std::vector<Point<float>>& wPositions);
+
+	/** Run a benchmark for every combination of render perspective, zoom and number of actors.
+		@remarks Both render perspectives are run, isometric first, each over every zoom and then every number of actors.
+		@param sceneGraph The scene to run in.
+		@param config The scene and frames of every run, whose perspective, zoom and number of actors are set by each run.
+		@param zooms The zooms to run at.
+		@param numActors The numbers of actors to run with.
+		@return Every run, in the order run.
+	*/
+	std::vector<SceneBenchmarkSweepRun> Sweep(SceneGraph& sceneGraph, const SceneBenchmarkConfig& config, const std::vector<float>& zooms, const std::vector<size_t>& numActors);
+}
+
+#endif	// __SCENEBENCHMARK_H__
@@ -4,7 +4,11 @@
 
 // Library Includes
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <rapidjson/ostreamwrapper.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <rapidjson/prettywriter.h>
@@ -19,34 +23,216 @@
 #include "Actor/AnimationComponent.h"
 #include "Actor/CollisionComponent.h"
 #include "Actor/ActorFactory.h"
+#include "QuadTreeIndex.h"
+#include "UniformGrid.h"
+#include "GridTraversal.h"
+#include "RadixSort.h"
+#include "SceneSnapshot.h"
+#include "HeapAllocationCounter.h"
+#include "Profiler.h"
+
+namespace {
+	/** Write a tile map through a SAX writer.
+		@remarks 
+			Used if TileMap has a streaming Serialize(writer), so its tiles are written without building a value 
+			of the whole tile map.
+	*/
+	template<typename JsonWriter>
+	auto SerializeTileMap(const TileMap& tileMap, JsonWriter& writer, int) -> decltype(tileMap.Serialize(writer), void())
+	{
+		tileMap.Serialize(writer);
+	}
+
+	/** Write a tile map through a SAX writer by way of its value, for a TileMap without a streaming Serialize(). */
+	template<typename JsonWriter>
+	void SerializeTileMap(const TileMap& tileMap, JsonWriter& writer, long)
+	{
+		rapidjson::Document jsonDocument;
+		tileMap.Serialize(jsonDocument.GetAllocator()).Accept(writer);
+	}
+
+	/** Write a tile map through a SAX writer, streaming it if TileMap supports it. */
+	template<typename JsonWriter>
+	void SerializeTileMap(const TileMap& tileMap, JsonWriter& writer)
+	{
+		SerializeTileMap(tileMap, writer, 0);
+	}
+
+	/** Get the smallest box containing two boxes. */
+	Rect<float> Union(const Rect<float>& lhs, const Rect<float>& rhs)
+	{
+		const auto left = std::min(lhs.GetLeft(), rhs.GetLeft());
+		const auto top = std::min(lhs.GetTop(), rhs.GetTop());
+		const auto right = std::max(lhs.GetRight(), rhs.GetRight());
+		const auto bottom = std::max(lhs.GetBottom(), rhs.GetBottom());
+
+		return { left, top, right - left, bottom - top };
+	}
 
-SceneGraph::SceneGraph(ActorFactory& actorFactory, Renderer& renderer, const TileMap& tileMap, size_t maxObjectsInCell, int tileWidth, int tileHeight)
+	/** Get whether two boxes are exactly the same. */
+	bool AreBoundsEqual(const Rect<float>& lhs, const Rect<float>& rhs)
+	{
+		return lhs.GetX() == rhs.GetX() && lhs.GetY() == rhs.GetY() && lhs.GetWidth() == rhs.GetWidth() && lhs.GetHeight() == rhs.GetHeight();
+	}
+}
+
+SceneGraph::SceneGraph(ActorFactory& actorFactory, Renderer& renderer, const TileMap& tileMap, size_t maxObjectsInCell, int tileWidth, int tileHeight, CollisionBroadphase broadphase, SpatialIndexType spatialIndex)
 	:m_RendererRef(renderer),
 	m_ActorFactoryRef(actorFactory),
-	m_QuadTreeRoot(nullptr, { -0.5f, -0.5f, static_cast<float>(tileMap.GetWidth()), static_cast<float>(tileMap.GetLength()) }, maxObjectsInCell),
 	m_TileMaps({ tileMap }),
-	m_Zoom(1.0f)
+	m_Zoom(1.0f),
+	m_TileBlockingMasks(tileMap.GetWidth() * tileMap.GetLength(), 0),
+	m_TileBlockingMaskWidth(tileMap.GetWidth()),
+	m_TileBlockingMaskLength(tileMap.GetLength()),
+	m_CollisionBroadphase(broadphase)
 {
+	m_SpatialIndexType = spatialIndex;
+	m_BaseBoundingBox = { -0.5f, -0.5f, static_cast<float>(tileMap.GetWidth()), static_cast<float>(tileMap.GetLength()) };
+
+	switch (spatialIndex) {
+		case SpatialIndexType::UNIFORM_GRID: {
+			m_pSpatialIndex = std::make_unique<UniformGrid>(m_BaseBoundingBox, s_GridCellSizeInTiles, maxObjectsInCell);
+			break;
+		}
+		case SpatialIndexType::QUAD_TREE:
+		default: {
+			m_pSpatialIndex = std::make_unique<QuadTreeIndex>(m_BaseBoundingBox, maxObjectsInCell);
+			break;
+		}
+	}
+
 	SetTileDimensions(tileWidth, tileHeight);
 	
-	// Ensure m_sCameraPosition is the correct camera position in screen-space.
+	// Ensure m_sCameraPosition and the cached camera transforms are correct for the initial camera.
 	SetCameraPosition(m_wCameraPosition, m_wCameraElevation);
 }
 
+SceneGraph::~SceneGraph()
+{
+	if (m_SnapshotThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_SnapshotMutex);
+			m_IsShuttingDownSnapshots = true;
+		}
+		m_SnapshotsQueued.notify_one();
+
+		m_SnapshotThread.join();
+	}
+
+	if (m_PreloadThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_PreloadMutex);
+			m_IsShuttingDownPreloads = true;
+		}
+		m_PreloadsQueued.notify_one();
+
+		m_PreloadThread.join();
+	}
+}
 
 void SceneGraph::Update(float deltaTime)
 {
+	if (Profiler::s_IsEnabled) {
+		m_Profiler.BeginFrame();
+
+		// Outside of every timed scope, as it may visit every actor.
+		SetSpatialIndexCounters();
+	}
+
+	// The thread calling Update() is thread 0 of the update, so its scopes are traced and its queues used.
+	JobPool::SetCurrentThreadIndex(0);
+
+	PROFILE_SCOPE(m_Profiler, ProfilePhase::UPDATE);
+
+	const auto numHeapAllocations = HeapAllocationCounter::GetNumAllocations();
+	m_NumHeapAllocationsLastFrame = numHeapAllocations - m_NumHeapAllocationsAtFrameStart;
+	m_NumHeapAllocationsAtFrameStart = numHeapAllocations;
+
+	// Anything allocated from the arenas last frame is released here.
+	for (auto& frameArena : m_FrameArenas) {
+		frameArena.Reset();
+	}
+
 	m_IsUpdatingActors = true;
 
-	for (const auto& pActor : m_Actors) {
-		pActor->Update(deltaTime);
+	if (m_pUpdateJobPool) {
+		// Gather the live actors so they can be sharded across the job pool.
+		m_ActorsToUpdate.clear();
+		m_ActorDeltaTimes.clear();
+		m_Actors.ForEachLiveActorHandle([this, deltaTime](Actor* pActor, const ActorHandle& handle) {
+			auto actorDeltaTime = 0.0f;
+			if (GetActorDeltaTime(pActor, handle, deltaTime, actorDeltaTime)) {
+				m_ActorsToUpdate.push_back(pActor);
+				m_ActorDeltaTimes.push_back(actorDeltaTime);
+			}
+			else if (pActor->IsPendingDestroy()) {
+				// Not updated this frame, so it wouldn't otherwise be found to be pending destroy.
+				m_PendingDestroyActors.push_back(pActor);
+			}
+		});
+
+		m_IsUpdatingInParallel = true;
+
+		m_pUpdateJobPool->ParallelFor(m_ActorsToUpdate.size(), s_ActorsPerUpdateJob, [this](size_t begin, size_t end) {
+			auto& queues = m_ThreadActorQueues[JobPool::GetCurrentThreadIndex()];
+
+			for (auto i = begin; i < end; ++i) {
+				UpdateActor(m_ActorsToUpdate[i], m_ActorDeltaTimes[i], queues);
+			}
+		});
+
+		m_IsUpdatingInParallel = false;
+	}
+	else {
+		auto& queues = m_ThreadActorQueues[0];
+
+		m_Actors.ForEachLiveActorHandle([this, deltaTime, &queues](Actor* pActor, const ActorHandle& handle) {
+			auto actorDeltaTime = 0.0f;
+			if (GetActorDeltaTime(pActor, handle, deltaTime, actorDeltaTime)) {
+				UpdateActor(pActor, actorDeltaTime, queues);
+			}
+			else if (pActor->IsPendingDestroy()) {
+				queues.pendingDestroy.push_back(pActor);
+			}
+		});
+	}
+
+	++m_NumUpdates;
+
+	// Merge the actors queued on each thread now that the scene is safe to modify.
+	for (auto& threadQueues : m_ThreadActorQueues) {
+		for (auto pActor : threadQueues.newActors) {
+			m_pSpatialIndex->InsertActor(pActor);
+			m_NewActors.push_back(pActor);
+			m_MovedActors.push_back(m_Actors.GetHandle(pActor));
+		}
+
+		for (auto pActor : threadQueues.moved) {
+			m_MovedActors.push_back(m_Actors.GetHandle(pActor));
+		}
+
+		m_PendingDestroyActors.insert(m_PendingDestroyActors.end(), threadQueues.pendingDestroy.begin(), threadQueues.pendingDestroy.end());
+
+		// Sleep before waking, so an actor both put to sleep and woken during the update stays awake.
+		for (auto pActor : threadQueues.asleep) {
+			m_Actors.SetAsleep(pActor, true);
+		}
+
+		for (auto pActor : threadQueues.woken) {
+			m_Actors.SetAsleep(pActor, false);
+		}
+
+		threadQueues.newActors.clear();
+		threadQueues.moved.clear();
+		threadQueues.pendingDestroy.clear();
+		threadQueues.asleep.clear();
+		threadQueues.woken.clear();
 	}
 
-	// Move new actors to correct list post update so that we don't invalidate our iters
-	m_Actors.insert(
-		m_Actors.end(),
-		std::make_move_iterator(m_NewActors.begin()), 
-		std::make_move_iterator(m_NewActors.end()));
+	// Make new actors live post update so that they aren't updated until the next frame.
+	for (auto pActor : m_NewActors) {
+		m_Actors.SetLive(pActor, true);
+	}
 
 	m_NewActors.clear();
 
@@ -54,17 +240,428 @@ void SceneGraph::Update(float deltaTime)
 	DestroyPendingActors();
 
 	m_IsUpdatingActors = false;
+
+	// Capture the snapshots requested during the update now that the scene is consistent.
+	decltype(m_SnapshotRequests) snapshotRequests;
+	{
+		std::lock_guard<std::mutex> lock(m_SnapshotMutex);
+		snapshotRequests.swap(m_SnapshotRequests);
+	}
+
+	for (auto& request : snapshotRequests) {
+		QueueSnapshot(request.first, std::move(request.second));
+	}
+
+	CompleteSnapshots();
+	CompletePrototypePreloads();
+
+	if (m_pWorldStreamer) {
+		UpdateWorldStreaming();
+	}
+}
+
+void SceneGraph::SetFixedTimestep(float tickDuration)
+{
+	m_FixedTimestep = std::max(tickDuration, 0.0f);
+	m_TickAccumulator = 0.0f;
+	m_InterpolationAlpha = 1.0f;
+}
+
+size_t SceneGraph::Advance(float frameTime)
+{
+	if (m_FixedTimestep <= 0.0f) {
+		Update(frameTime);
+		ResolveCollisions();
+		return 1;
+	}
+
+	m_TickAccumulator += frameTime;
+
+	size_t numTicks = 0;
+	while (m_TickAccumulator >= m_FixedTimestep && numTicks < s_MaxTicksPerAdvance) {
+		CapturePreviousTransforms();
+
+		Update(m_FixedTimestep);
+		ResolveCollisions();
+
+		m_TickAccumulator -= m_FixedTimestep;
+		++numTicks;
+	}
+
+	if (m_TickAccumulator >= m_FixedTimestep) {
+		// Fallen too far behind to catch up, so let the simulation run slow rather than stall.
+		m_TickAccumulator = std::fmod(m_TickAccumulator, m_FixedTimestep);
+	}
+
+	m_InterpolationAlpha = m_TickAccumulator / m_FixedTimestep;
+
+	return numTicks;
+}
+
+void SceneGraph::CapturePreviousTransforms()
+{
+	const auto tick = ++m_PreviousTransformsTick;
+
+	m_Actors.ForEachLiveActorHandle([this, tick](Actor* pActor, const ActorHandle& handle) {
+		if (m_Actors.IsAsleep(handle)) {
+			return;
+		}
+
+		if (handle.pool >= m_PreviousTransforms.size()) {
+			m_PreviousTransforms.resize(handle.pool + 1);
+		}
+
+		auto& poolTransforms = m_PreviousTransforms[handle.pool];
+		if (handle.slot >= poolTransforms.size()) {
+			poolTransforms.resize(handle.slot + 1);
+		}
+
+		poolTransforms[handle.slot] = { pActor->GetPosition(), pActor->GetElevation(), handle.generation, tick };
+	});
+}
+
+bool SceneGraph::GetInterpolatedTransform(const Actor* pActor, const ActorHandle& handle, Point<float>& wPosition, float& wElevation) const
+{
+	if (handle.IsNull() || handle.pool >= m_PreviousTransforms.size() || handle.slot >= m_PreviousTransforms[handle.pool].size()) {
+		return false;
+	}
+
+	const auto& previous = m_PreviousTransforms[handle.pool][handle.slot];
+	if (previous.generation != handle.generation || previous.tick != m_PreviousTransformsTick) {
+		// Spawned since the previous tick, or asleep at the start of it and so not moving from where it was.
+		return false;
+	}
+
+	const auto alpha = m_InterpolationAlpha;
+	const auto& wCurrentPosition = pActor->GetPosition();
+	wPosition = Point<float>(
+		previous.position.X() + (wCurrentPosition.X() - previous.position.X()) * alpha,
+		previous.position.Y() + (wCurrentPosition.Y() - previous.position.Y()) * alpha);
+	wElevation = previous.elevation + (pActor->GetElevation() - previous.elevation) * alpha;
+
+	return true;
+}
+
+void SceneGraph::SetWorldStreamer(std::unique_ptr<WorldStreamer> pWorldStreamer)
+{
+	if (m_pWorldStreamer) {
+		m_pWorldStreamer->EvictAll([](int, int) {});
+		m_WorldChunkTileMaps.clear();
+
+		// With nothing loaded, this despawns every streamed actor still in the world.
+		DespawnUnloadedWorldActors();
+		m_WorldStreamedActors.clear();
+	}
+
+	m_pWorldStreamer = std::move(pWorldStreamer);
+
+	if (!m_pWorldStreamer) {
+		FitSpatialIndexToWorld();
+	}
+}
+
+void SceneGraph::UpdateWorldStreaming()
+{
+	auto hasEvicted = false;
+	auto isFitted = false;
+
+	// By the first chunk handed over, the streamer has evicted and loaded every chunk of this update, so 
+	// the index is only rebuilt once however many chunks change.
+	auto fitToLoadedChunks = [this, &isFitted]() {
+		if (isFitted) {
+			return;
+		}
+		isFitted = true;
+
+		DespawnUnloadedWorldActors();
+		FitSpatialIndexToWorld();
+	};
+
+	auto onChunkLoaded = [this, &fitToLoadedChunks](int chunkX, int chunkY, const SceneSnapshot* pSnapshot, std::vector<TileMap>& tileMaps) {
+		// Grow the index before spawning, so the actors are inserted within its bounds.
+		fitToLoadedChunks();
+
+		if (!tileMaps.empty()) {
+			const auto wChunkBounds = m_pWorldStreamer->GetChunkBounds(chunkX, chunkY);
+
+			auto& chunkTileMaps = m_WorldChunkTileMaps[ToWorldChunkKey(chunkX, chunkY)];
+			chunkTileMaps.wOrigin = Point<float>(wChunkBounds.GetX() + 0.5f, wChunkBounds.GetY() + 0.5f);
+			chunkTileMaps.tileMaps = std::move(tileMaps);
+		}
+
+		if (!pSnapshot) {
+			// Nothing in this chunk.
+			return;
+		}
+
+		for (size_t i = 0; i < pSnapshot->GetNumActors(); ++i) {
+			const auto& actor = pSnapshot->GetActor(i);
+
+			auto pActor = SpawnActor(pSnapshot->GetString(actor.resource), { actor.x, actor.y }, actor.elevation);
+			if (pActor) {
+				m_WorldStreamedActors.push_back(m_Actors.GetHandle(pActor));
+			}
+		}
+
+		if (m_OnWorldChunkLoaded) {
+			m_OnWorldChunkLoaded(chunkX, chunkY, *pSnapshot);
+		}
+	};
+
+	auto onChunkEvicted = [this, &hasEvicted](int chunkX, int chunkY) {
+		hasEvicted = true;
+		m_WorldChunkTileMaps.erase(ToWorldChunkKey(chunkX, chunkY));
+	};
+
+	m_pWorldStreamer->Update(m_wCameraPosition, onChunkLoaded, onChunkEvicted);
+
+	// Chunks were only evicted.
+	if (hasEvicted) {
+		fitToLoadedChunks();
+	}
+}
+
+void SceneGraph::DespawnUnloadedWorldActors()
+{
+	size_t numKept = 0;
+
+	for (const auto& handle : m_WorldStreamedActors) {
+		// Actors destroyed since they were spawned resolve to null, and are forgotten.
+		auto pActor = m_Actors.GetActor(handle);
+		if (!pActor) {
+			continue;
+		}
+
+		const auto& wPosition = pActor->GetPosition();
+
+		int chunkX = 0;
+		int chunkY = 0;
+		auto isKept = false;
+		if (m_pWorldStreamer && m_pWorldStreamer->GetChunk(wPosition, chunkX, chunkY)) {
+			isKept = m_pWorldStreamer->IsChunkLoaded(chunkX, chunkY);
+		}
+		else {
+			// Wandered out of the streamed world, which is only somewhere to be if it's the base tile map.
+			isKept = wPosition.X() >= m_BaseBoundingBox.GetLeft() && wPosition.X() < m_BaseBoundingBox.GetRight() &&
+				wPosition.Y() >= m_BaseBoundingBox.GetTop() && wPosition.Y() < m_BaseBoundingBox.GetBottom();
+		}
+
+		if (isKept) {
+			m_WorldStreamedActors[numKept++] = handle;
+		}
+		else {
+			m_PendingDestroyActors.push_back(pActor);
+		}
+	}
+
+	m_WorldStreamedActors.resize(numKept);
+
+	// Destroyed before the index is rebuilt, so they aren't inserted into it.
+	DestroyPendingActors();
+}
+
+void SceneGraph::FitSpatialIndexToWorld()
+{
+	auto wBoundingBox = m_BaseBoundingBox;
+
+	Rect<float> wLoadedBounds;
+	if (m_pWorldStreamer && m_pWorldStreamer->GetLoadedBounds(wLoadedBounds)) {
+		wBoundingBox = Union(wBoundingBox, wLoadedBounds);
+	}
+
+	// Cover every actor left outside, so none is clamped into the index the next time it moves.
+	auto left = wBoundingBox.GetLeft();
+	auto top = wBoundingBox.GetTop();
+	auto right = wBoundingBox.GetRight();
+	auto bottom = wBoundingBox.GetBottom();
+
+	m_Actors.ForEachLiveActor([&left, &top, &right, &bottom](Actor* pActor) {
+		const auto& wPosition = pActor->GetPosition();
+
+		left = std::min(left, wPosition.X());
+		top = std::min(top, wPosition.Y());
+		right = std::max(right, std::nextafter(wPosition.X(), std::numeric_limits<float>::max()));
+		bottom = std::max(bottom, std::nextafter(wPosition.Y(), std::numeric_limits<float>::max()));
+	});
+
+	// Only rebuild once the index no longer covers everything, or covers far more than it needs to, so loading 
+	// and evicting chunks within the slack doesn't reinsert every actor.
+	const auto& wIndexBounds = m_pSpatialIndex->GetBoundingBox();
+	const auto isExceeded = left < wIndexBounds.GetLeft() || top < wIndexBounds.GetTop() ||
+		right > wIndexBounds.GetRight() || bottom > wIndexBounds.GetBottom();
+
+	// Padded by a chunk on every side, so streaming one chunk further doesn't rebuild it again.
+	const auto padding = m_pWorldStreamer ? m_pWorldStreamer->GetChunkSize() : 0.0f;
+	wBoundingBox = { left - padding, top - padding, right - left + 2.0f * padding, bottom - top + 2.0f * padding };
+
+	const auto isOversized = wIndexBounds.GetWidth() > wBoundingBox.GetWidth() * s_SpatialIndexShrinkFactor ||
+		wIndexBounds.GetHeight() > wBoundingBox.GetHeight() * s_SpatialIndexShrinkFactor;
+
+	if (isExceeded || isOversized) {
+		ResizeSpatialIndex(wBoundingBox);
+	}
+}
+
+void SceneGraph::ResizeSpatialIndex(const Rect<float>& wBoundingBox)
+{
+	const auto maxActorsPerCell = m_pSpatialIndex->GetMaxNumActorsPerCell();
+
+	// Free the old index first, as a whole world of cells may not fit twice.
+	m_pSpatialIndex.reset();
+
+	switch (m_SpatialIndexType) {
+		case SpatialIndexType::UNIFORM_GRID: {
+			m_pSpatialIndex = std::make_unique<UniformGrid>(wBoundingBox, s_GridCellSizeInTiles, maxActorsPerCell);
+			break;
+		}
+		case SpatialIndexType::QUAD_TREE:
+		default: {
+			m_pSpatialIndex = std::make_unique<QuadTreeIndex>(wBoundingBox, maxActorsPerCell);
+			break;
+		}
+	}
+
+	m_Actors.ForEachLiveActor([this](Actor* pActor) {
+		m_pSpatialIndex->InsertActor(pActor);
+	});
+}
+
+void SceneGraph::SetNumUpdateThreads(size_t numThreads)
+{
+	assert(!m_IsUpdatingActors);
+
+	if (numThreads > 1) {
+		m_pUpdateJobPool = std::make_unique<JobPool>(numThreads);
+		m_ThreadActorQueues.resize(numThreads);
+		m_Profiler.SetNumThreads(numThreads);
+	}
+	else {
+		m_pUpdateJobPool.reset();
+		m_ThreadActorQueues.resize(1);
+		m_Profiler.SetNumThreads(1);
+	}
+
+	// Never shrunk, so the arenas of threads no longer used, and anything allocated from them, stay valid.
+	if (m_FrameArenas.size() < numThreads) {
+		m_FrameArenas.resize(numThreads);
+	}
+}
+
+FrameArena& SceneGraph::GetFrameArena()
+{
+	// Threads outside the update job pool, e.g. before the first Update(), share the arena of thread 0.
+	const auto threadIndex = JobPool::GetCurrentThreadIndex();
+	return m_FrameArenas[threadIndex < m_FrameArenas.size() ? threadIndex : 0];
+}
+
+void SceneGraph::UpdateActor(Actor* pActor, float deltaTime, ThreadActorQueues& queues)
+{
+	const auto previousPosition = pActor->GetPosition();
+
+	pActor->Update(deltaTime);
+
+	const auto& position = pActor->GetPosition();
+	if (position.X() != previousPosition.X() || position.Y() != previousPosition.Y()) {
+		queues.moved.push_back(pActor);
+	}
+
+	if (pActor->IsPendingDestroy()) {
+		queues.pendingDestroy.push_back(pActor);
+	}
+}
+
+bool SceneGraph::GetActorDeltaTime(const Actor* pActor, const ActorHandle& handle, float deltaTime, float& actorDeltaTime)
+{
+	if (m_Actors.IsAsleep(handle)) {
+		return false;
+	}
+
+	if (m_ActivityRadius <= 0.0f) {
+		actorDeltaTime = deltaTime;
+		return true;
+	}
+
+	if (handle.pool >= m_ActorActivity.size()) {
+		m_ActorActivity.resize(handle.pool + 1);
+	}
+
+	auto& poolActivity = m_ActorActivity[handle.pool];
+	if (handle.slot >= poolActivity.size()) {
+		poolActivity.resize(handle.slot + 1, { 0.0f, handle.generation });
+	}
+
+	auto& activity = poolActivity[handle.slot];
+	if (activity.generation != handle.generation) {
+		// A new actor in the slot.
+		activity = { 0.0f, handle.generation };
+	}
+
+	activity.pendingTime += deltaTime;
+
+	const auto& position = pActor->GetPosition();
+	const auto dx = position.X() - m_wCameraPosition.X();
+	const auto dy = position.Y() - m_wCameraPosition.Y();
+	const auto isDistant = dx * dx + dy * dy > m_ActivityRadius * m_ActivityRadius;
+
+	// Offset by slot so the distant actors of a pool are spread over the updates rather than all due at once.
+	if (isDistant && (m_NumUpdates + handle.slot) % m_DistantUpdateInterval != 0) {
+		return false;
+	}
+
+	actorDeltaTime = activity.pendingTime;
+	activity.pendingTime = 0.0f;
+
+	return true;
+}
+
+void SceneGraph::SetActivityRadius(float radius, size_t distantUpdateInterval)
+{
+	m_ActivityRadius = std::max(radius, 0.0f);
+	m_DistantUpdateInterval = std::max(distantUpdateInterval, static_cast<size_t>(1));
+
+	if (m_ActivityRadius <= 0.0f) {
+		m_ActorActivity.clear();
+	}
+}
+
+void SceneGraph::SleepActor(Actor* pActor)
+{
+	if (m_IsUpdatingInParallel) {
+		m_ThreadActorQueues[JobPool::GetCurrentThreadIndex()].asleep.push_back(pActor);
+	}
+	else {
+		m_Actors.SetAsleep(pActor, true);
+	}
+}
+
+void SceneGraph::WakeActor(Actor* pActor)
+{
+	if (m_IsUpdatingInParallel) {
+		m_ThreadActorQueues[JobPool::GetCurrentThreadIndex()].woken.push_back(pActor);
+	}
+	else {
+		m_Actors.SetAsleep(pActor, false);
+	}
 }
 
 void SceneGraph::ResolveCollisions()
 {
-	// Make sure no actors are outside the scene graph bounds.
-	std::vector<Actor*> actors;
-	m_QuadTreeRoot.AppendActorList(actors, false);
+	PROFILE_SCOPE(m_Profiler, ProfilePhase::RESOLVE_COLLISIONS);
+
+	// Make sure no moved actors are outside the scene graph bounds.
+	const auto& rootBoundingBox = m_pSpatialIndex->GetBoundingBox();
+
+	m_SortedMovedActors.clear();
 
-	const auto& rootBoundingBox = m_QuadTreeRoot.GetBoundingBox();
+	for (const auto& handle : m_MovedActors) {
+		auto actor = m_Actors.GetActor(handle);
+		if (!actor) {
+			// Destroyed since it moved.
+			continue;
+		}
+
+		m_SortedMovedActors.push_back(actor);
 
-	for (auto actor : actors) {
 		// Get the collision component of the actor.
 		auto pCollisionComponent = actor->GetComponent<CollisionComponent>();
 		if (pCollisionComponent) {
@@ -94,167 +691,1182 @@ void SceneGraph::ResolveCollisions()
 				actor->SetPosition(wBoundingBox.GetCentrePosition() - lBoundingBox.GetPosition());
 			}
 		}
+
+		m_pSpatialIndex->RelocateActor(actor);
+	}
+
+	m_MovedActors.clear();
+
+	std::sort(m_SortedMovedActors.begin(), m_SortedMovedActors.end(), std::less<const Actor*>());
+
+	auto onActorMoved = [this](Actor* pActor) {
+		// Keep the index in sync, and make sure the contact isn't considered at rest until next frame.
+		m_pSpatialIndex->RelocateActor(pActor);
+		m_MovedActors.push_back(m_Actors.GetHandle(pActor));
+
+		// Being pushed wakes a sleeping actor.
+		m_Actors.SetAsleep(pActor, false);
+	};
+
+	if (m_CollisionBroadphase == CollisionBroadphase::SORT_AND_SWEEP) {
+		m_CollisionWorld.ResolveCollisions(m_Actors, m_SortedMovedActors, onActorMoved);
+	}
+	else {
+		m_pSpatialIndex->ResolveCollisions(m_CollisionWorld, m_Actors, m_SortedMovedActors, onActorMoved);
+	}
+
+	// The quad tree resolves its collisions itself, without the collision world.
+	if (m_CollisionBroadphase == CollisionBroadphase::SORT_AND_SWEEP || m_SpatialIndexType == SpatialIndexType::UNIFORM_GRID) {
+		PROFILE_SET_COUNTER(m_Profiler, ProfileCounter::COLLISION_PAIRS_TESTED, m_CollisionWorld.GetNumCandidatePairs());
+	}
+}
+
+void SceneGraph::SetSpatialIndexCounters()
+{
+	// The stats are only gathered every so often, and the counters repeat them in between.
+	if (m_NumFramesSinceSpatialIndexStats == 0) {
+		m_pSpatialIndex->GetCellStats(m_SpatialIndexDepth, m_NumSpatialIndexCells);
+	}
+	m_NumFramesSinceSpatialIndexStats = (m_NumFramesSinceSpatialIndexStats + 1) % s_SpatialIndexStatsInterval;
+
+	PROFILE_SET_COUNTER(m_Profiler, ProfileCounter::SPATIAL_INDEX_DEPTH, m_SpatialIndexDepth);
+	PROFILE_SET_COUNTER(m_Profiler, ProfileCounter::SPATIAL_INDEX_CELLS, m_NumSpatialIndexCells);
+}
+
+void SceneGraph::Render()
+{
+	// Rebuild the camera transform if the renderer has been resized since it was built.
+	const auto& screenCentrePosition = m_RendererRef.GetScreenCentrePosition();
+	if (screenCentrePosition.X() != m_sScreenCentrePosition.X() || screenCentrePosition.Y() != m_sScreenCentrePosition.Y()) {
+		UpdateCameraTransform();
+	}
+
+	RenderTileMaps();
+	RenderActors();
+}
+
+
+void SceneGraph::RenderActors()
+{
+	PROFILE_SCOPE(m_Profiler, ProfilePhase::RENDER_ACTORS);
+
+	m_PickBounds.clear();
+	m_HasPickBounds = true;
+	m_IsPickIndexDirty = true;
+
+	m_IsQueuingActorSprites = m_IsActorBatchingEnabled;
+	m_pSpatialIndex->Render(*this);
+	m_IsQueuingActorSprites = false;
+
+	FlushActorBatch();
+}
+
+uint64_t SceneGraph::MakeActorSortKey(const Actor* pActor, const Sprite& sprite, size_t order) const
+{
+	// Map a float onto an unsigned integer with the same order, negative values included.
+	auto toOrderedBits = [](float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	};
+
+	// Rows of the isometric view run along x + y, so actors further down the screen are drawn later.
+	const auto& wPosition = pActor->GetPosition();
+	const auto depth = m_RenderPerspective == RenderPerspective::ISOMETRIC ? wPosition.X() + wPosition.Y() : wPosition.Y();
+
+	// Hash the atlas rather than numbering atlases, so building keys never allocates. Atlases sharing a hash
+	// only cost coherence, not order.
+	const auto spriteAddress = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&sprite));
+	const uint64_t spriteId = ((spriteAddress >> 4) * 0x9E3779B97F4A7C15ull) >> 52;
+	const uint64_t layer = std::min<size_t>(order, 0xF);
+
+	if (m_ActorBatchDepthBand > 0.0f) {
+		// Group by atlas within each band, then order by depth within the band.
+		const auto band = std::floor(depth / m_ActorBatchDepthBand);
+		const auto bandBits = static_cast<uint32_t>(static_cast<int32_t>(band)) ^ 0x80000000u;
+		const auto depthInBand = std::min(std::max(depth / m_ActorBatchDepthBand - band, 0.0f), 1.0f);
+		const auto depthInBandBits = std::min(static_cast<uint64_t>(depthInBand * 1024.0f), static_cast<uint64_t>(0x3FF));
+
+		return (static_cast<uint64_t>(bandBits) << 32) |
+			(layer << 28) |
+			(spriteId << 16) |
+			(depthInBandBits << 6) |
+			(static_cast<uint64_t>(toOrderedBits(pActor->GetElevation())) >> 26);
+	}
+
+	return (static_cast<uint64_t>(toOrderedBits(depth)) << 32) |
+		(static_cast<uint64_t>(toOrderedBits(pActor->GetElevation()) >> 16) << 16) |
+		(layer << 12) |
+		spriteId;
+}
+
+void SceneGraph::FlushActorBatch()
+{
+	// Stable, so sprites with the same key keep the order they were queued in.
+	RadixSort(m_ActorBatch, m_ActorBatchScratch, [](const ActorDrawCommand& command) {
+		return command.sortKey;
+	});
+
+	for (const auto& command : m_ActorBatch) {
+		m_RendererRef.RenderSprite(*command.pSprite, command.destRect, command.mask);
+		m_PickBounds.push_back({ command.destRect, command.mask, command.pSprite, command.actor });
+	}
+
+	PROFILE_COUNT(m_Profiler, ProfileCounter::SPRITES_SUBMITTED, m_ActorBatch.size());
+
+	m_ActorBatch.clear();
+}
+
+void SceneGraph::RenderTileMaps()
+{
+	PROFILE_SCOPE(m_Profiler, ProfilePhase::RENDER_TILE_MAPS);
+
+	// Resolve the render perspective once for the whole frame.
+	switch (m_RenderPerspective) {
+		case RenderPerspective::OBLIQUE: {
+			RenderTileMaps<RenderPerspective::OBLIQUE>();
+			break;
+		}
+		case RenderPerspective::ISOMETRIC: {
+			RenderTileMaps<RenderPerspective::ISOMETRIC>();
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+}
+
+template<RenderPerspective Perspective>
+void SceneGraph::RenderTileMaps()
+{
+	for (size_t index = 0; index < m_TileMaps.size(); ++index) {
+		if (m_IsTileChunkCachingEnabled) {
+			RenderTileMapChunks<Perspective>(index);
+		}
+		else {
+			RenderTileMap(m_TileMaps[index]);
+		}
+
+		// Submit this tile map's quads before the next tile map is drawn over it.
+		FlushTileBatch();
+	}
+
+	if (!m_WorldChunkTileMaps.empty()) {
+		RenderWorldChunkTileMaps();
+	}
+}
+
+void SceneGraph::RenderWorldChunkTileMaps()
+{
+	size_t numLayers = 0;
+	for (const auto& chunk : m_WorldChunkTileMaps) {
+		numLayers = std::max(numLayers, chunk.second.tileMaps.size());
+	}
+
+	// Every chunk's layer is drawn before the next layer of any chunk, as layers overlap across chunk edges.
+	for (size_t index = 0; index < numLayers; ++index) {
+		for (const auto& chunk : m_WorldChunkTileMaps) {
+			if (index < chunk.second.tileMaps.size()) {
+				RenderTileMap(chunk.second.tileMaps[index], chunk.second.wOrigin);
+			}
+		}
+
+		FlushTileBatch();
+	}
+}
+
+void SceneGraph::RenderTileMap(const TileMap& tileMap, const Point<float>& wOrigin)
+{
+	// Every tile is the same size on screen.
+	const auto sTileWidth = static_cast<int>(std::ceil(m_TileWidth * m_Zoom));
+	const auto sTileHeight = static_cast<int>(std::ceil(m_TileHeight * m_Zoom));
+
+	auto visibleTiles = GetVisibleTiles(tileMap, wOrigin);
+	while (visibleTiles.Next()) {
+		const auto j = visibleTiles.GetX();
+		const auto i = visibleTiles.GetY();
+		const auto& sPosition = visibleTiles.GetScreenPosition();
+
+		PROFILE_COUNT(m_Profiler, ProfileCounter::TILES_VISITED, 1);
+
+		Rect<> destRect = {
+			static_cast<int>(sPosition.X()),
+			static_cast<int>(sPosition.Y()),
+			sTileWidth,
+			sTileHeight
+		};
+
+		int numLayersToRender = tileMap.GetNumLayers(j, i);
+		if (tileMap.AreTransitionsHidden()) {
+			// Only render base tile.
+			numLayersToRender = 1;
+		}
+
+		for (int layer = 0; layer < numLayersToRender; ++layer) {
+			auto& tile = tileMap.GetTile(j, i, layer);
+			auto pSprite = tile.GetSpriteForRender();
+			if (pSprite) {
+				auto mask = tile.GetMaskForRender();
+
+				DrawTile(*pSprite, destRect, mask, layer);
+			}
+		}
+	}
+}
+
+SceneGraph::VisibleTileSpan::VisibleTileSpan(const SceneGraph& sceneGraph, const TileMap& tileMap, const Point<float>& wOrigin)
+	:m_SceneGraphRef(sceneGraph),
+	m_TileMapRef(tileMap)
+{
+	// World position is the centre of the tile, so we must adjust the screen position to the top left corner.
+	const auto sCentre = sceneGraph.ToScreenPosition(wOrigin, 0.0f);
+	m_sOrigin = {
+		sCentre.X() - sceneGraph.m_HalfTileWidth * sceneGraph.m_Zoom,
+		sCentre.Y() - sceneGraph.m_HalfTileHeight * sceneGraph.m_Zoom
+	};
+
+	sceneGraph.GetTileSteps(m_sColumnStep, m_sRowStep);
+
+	if (!sceneGraph.GetVisibleTileRows(tileMap, wOrigin, m_NextRow, m_EndRow)) {
+		m_NextRow = m_EndRow = 0;
+	}
+}
+
+bool SceneGraph::VisibleTileSpan::Next()
+{
+	// Step along the current row.
+	if (m_Column + 1 < m_EndColumn) {
+		++m_Column;
+		m_sPosition += m_sColumnStep;
+		return true;
+	}
+
+	// Move on to the next row with any visible tiles.
+	while (m_NextRow < m_EndRow) {
+		m_Row = m_NextRow++;
+
+		const auto sRowStart = m_sOrigin + m_sRowStep * static_cast<float>(m_Row);
+		if (m_SceneGraphRef.GetVisibleTileColumns(m_TileMapRef, sRowStart, m_sColumnStep, m_Column, m_EndColumn)) {
+			m_sPosition = sRowStart + m_sColumnStep * static_cast<float>(m_Column);
+			return true;
+		}
+	}
+
+	m_Column = m_EndColumn = 0;
+	return false;
+}
+
+bool SceneGraph::GetVisibleTileRows(const TileMap& tileMap, const Point<float>& wOrigin, size_t& firstRow, size_t& endRow) const
+{
+	const auto& screenCentrePosition = m_sScreenCentrePosition;
+	const auto sScreenWidth = 2 * screenCentrePosition.X();
+	const auto sScreenHeight = 2 * screenCentrePosition.Y();
+
+	// Project the corners of the screen back into the world. The projection is affine, so every visible 
+	// tile centre lies within the rows spanned by the corners.
+	const Point<float> wCorners[] = {
+		ToWorldPosition({ 0, 0 }), ToWorldPosition({ sScreenWidth, 0 }),
+		ToWorldPosition({ 0, sScreenHeight }), ToWorldPosition({ sScreenWidth, sScreenHeight })
+	};
+
+	// Rows are counted from the tile map's origin.
+	auto wMinY = wCorners[0].Y() - wOrigin.Y();
+	auto wMaxY = wMinY;
+	for (const auto& wCorner : wCorners) {
+		wMinY = std::min(wMinY, wCorner.Y() - wOrigin.Y());
+		wMaxY = std::max(wMaxY, wCorner.Y() - wOrigin.Y());
+	}
+
+	// A tile can overlap the screen while its centre is up to one tile outside of it.
+	const auto gridLength = static_cast<float>(tileMap.GetLength());
+	const auto minRow = std::max(std::floor(wMinY) - 1.0f, 0.0f);
+	const auto maxRow = std::min(std::ceil(wMaxY) + 2.0f, gridLength);
+
+	if (minRow >= maxRow) {
+		return false;
+	}
+
+	firstRow = static_cast<size_t>(minRow);
+	endRow = static_cast<size_t>(maxRow);
+	return true;
+}
+
+bool SceneGraph::GetVisibleTileColumns(
+	const TileMap& tileMap, 
+	const Point<float>& sRowStart, const Point<float>& sColumnStep,
+	size_t& firstColumn, size_t& endColumn) const
+{
+	const auto& screenCentrePosition = m_sScreenCentrePosition;
+	const auto sScreenWidth = 2.0f * screenCentrePosition.X();
+	const auto sScreenHeight = 2.0f * screenCentrePosition.Y();
+
+	const auto sTileWidth = std::ceil(m_TileWidth * m_Zoom);
+	const auto sTileHeight = std::ceil(m_TileHeight * m_Zoom);
+
+	auto lower = 0.0f;
+	auto upper = static_cast<float>(tileMap.GetWidth());
+
+	// Narrow [lower, upper] to the columns j where start + j * step overlaps [0, screenSize] on one axis.
+	auto clipAxis = [&lower, &upper](float start, float step, float size, float screenSize) {
+		if (step > 0.0f) {
+			lower = std::max(lower, (-size - start) / step);
+			upper = std::min(upper, (screenSize - start) / step);
+		}
+		else if (step < 0.0f) {
+			lower = std::max(lower, (screenSize - start) / step);
+			upper = std::min(upper, (-size - start) / step);
+		}
+		else if (start + size < 0.0f || start > screenSize) {
+			// The whole row is outside the screen on this axis.
+			upper = lower;
+		}
+	};
+
+	clipAxis(sRowStart.X(), sColumnStep.X(), sTileWidth, sScreenWidth);
+	clipAxis(sRowStart.Y(), sColumnStep.Y(), sTileHeight, sScreenHeight);
+
+	// Round outwards so tiles cut by the screen edge are kept.
+	const auto minColumn = std::max(std::floor(lower), 0.0f);
+	const auto maxColumn = std::min(std::ceil(upper), static_cast<float>(tileMap.GetWidth()));
+
+	if (minColumn >= maxColumn) {
+		return false;
+	}
+
+	firstColumn = static_cast<size_t>(minColumn);
+	endColumn = static_cast<size_t>(maxColumn);
+	return true;
+}
+
+void SceneGraph::GetTileSteps(Point<float>& sColumnStep, Point<float>& sRowStep) const
+{
+	const auto sHalfTileWidth = m_HalfTileWidth * m_Zoom;
+	const auto sHalfTileHeight = m_HalfTileHeight * m_Zoom;
+
+	if (m_RenderPerspective == RenderPerspective::ISOMETRIC) {
+		sColumnStep = { sHalfTileWidth, sHalfTileHeight };
+		sRowStep = { -sHalfTileWidth, sHalfTileHeight };
+	}
+	else {
+		sColumnStep = { m_TileWidth * m_Zoom, 0.0f };
+		sRowStep = { 0.0f, m_TileHeight * m_Zoom };
+	}
+}
+
+template<RenderPerspective Perspective>
+void SceneGraph::RenderTileMapChunks(size_t index)
+{
+	const auto& tileMap = m_TileMaps[index];
+	auto& chunkGrid = GetTileChunkGrid(index);
+
+	const auto& screenCentrePosition = m_sScreenCentrePosition;
+	const auto sScreenWidth = 2.0f * screenCentrePosition.X();
+	const auto sScreenHeight = 2.0f * screenCentrePosition.Y();
+
+	// Chunks are baked relative to the world origin, so panning the camera is only a translation.
+	const auto sOffset = Point<float>(
+		static_cast<float>(screenCentrePosition.X()),
+		static_cast<float>(screenCentrePosition.Y())) - m_sCameraPosition * m_Zoom;
+
+	const auto sHalfTileWidth = m_HalfTileWidth * m_Zoom;
+	const auto sHalfTileHeight = m_HalfTileHeight * m_Zoom;
+	const auto sTileWidth = static_cast<int>(std::ceil(m_TileWidth * m_Zoom));
+	const auto sTileHeight = static_cast<int>(std::ceil(m_TileHeight * m_Zoom));
+
+	for (size_t chunkY = 0; chunkY < chunkGrid.numChunksY; ++chunkY) {
+		for (size_t chunkX = 0; chunkX < chunkGrid.numChunksX; ++chunkX) {
+			// The tile projection is affine, so the chunk's screen bounds are spanned by its corner tiles.
+			const auto firstX = static_cast<float>(chunkX * s_TileChunkSize);
+			const auto firstY = static_cast<float>(chunkY * s_TileChunkSize);
+			const auto lastX = static_cast<float>(std::min((chunkX + 1) * s_TileChunkSize, tileMap.GetWidth()) - 1);
+			const auto lastY = static_cast<float>(std::min((chunkY + 1) * s_TileChunkSize, tileMap.GetLength()) - 1);
+
+			const Point<float> corners[] = {
+				ToCartesianCoord<Perspective>({ firstX, firstY }), ToCartesianCoord<Perspective>({ lastX, firstY }),
+				ToCartesianCoord<Perspective>({ firstX, lastY }), ToCartesianCoord<Perspective>({ lastX, lastY })
+			};
+
+			auto sLeft = corners[0].X();
+			auto sRight = corners[0].X();
+			auto sTop = corners[0].Y();
+			auto sBottom = corners[0].Y();
+			for (const auto& corner : corners) {
+				sLeft = std::min(sLeft, corner.X());
+				sRight = std::max(sRight, corner.X());
+				sTop = std::min(sTop, corner.Y());
+				sBottom = std::max(sBottom, corner.Y());
+			}
+
+			sLeft = sLeft * m_Zoom - sHalfTileWidth + sOffset.X();
+			sRight = sRight * m_Zoom - sHalfTileWidth + sOffset.X() + sTileWidth;
+			sTop = sTop * m_Zoom - sHalfTileHeight + sOffset.Y();
+			sBottom = sBottom * m_Zoom - sHalfTileHeight + sOffset.Y() + sTileHeight;
+
+			if (sRight < 0.0f || sBottom < 0.0f || sLeft > sScreenWidth || sTop > sScreenHeight) {
+				// Chunk is off screen.
+				continue;
+			}
+
+			auto& chunk = chunkGrid.chunks[chunkY * chunkGrid.numChunksX + chunkX];
+			if (chunk.isDirty) {
+				BakeTileChunk<Perspective>(tileMap, chunkX, chunkY, chunk);
+			}
+
+			// Every tile of an on screen chunk is drawn, whether it is visible or not.
+			PROFILE_COUNT(m_Profiler, ProfileCounter::TILES_VISITED, (lastX - firstX + 1.0f) * (lastY - firstY + 1.0f));
+
+			for (const auto& bakedTile : chunk.tiles) {
+				Rect<> destRect = {
+					static_cast<int>(bakedTile.sPosition.X() + sOffset.X()),
+					static_cast<int>(bakedTile.sPosition.Y() + sOffset.Y()),
+					sTileWidth,
+					sTileHeight
+				};
+
+				if (bakedTile.layer >= tileMap.GetNumLayers(bakedTile.x, bakedTile.y)) {
+					// A layer removed without invalidating the chunk.
+					continue;
+				}
+
+				const auto& tile = tileMap.GetTile(bakedTile.x, bakedTile.y, bakedTile.layer);
+				auto pSprite = tile.GetSpriteForRender();
+				if (pSprite) {
+					DrawTile(*pSprite, destRect, tile.GetMaskForRender(), bakedTile.layer);
+				}
+			}
+		}
+	}
+}
+
+SceneGraph::TileChunkGrid& SceneGraph::GetTileChunkGrid(size_t index)
+{
+	if (m_TileChunkGrids.size() < m_TileMaps.size()) {
+		// Tile maps have been added since the last render.
+		m_TileChunkGrids.resize(m_TileMaps.size());
+	}
+
+	const auto& tileMap = m_TileMaps[index];
+	auto& chunkGrid = m_TileChunkGrids[index];
+
+	const auto numChunksX = (tileMap.GetWidth() + s_TileChunkSize - 1) / s_TileChunkSize;
+	const auto numChunksY = (tileMap.GetLength() + s_TileChunkSize - 1) / s_TileChunkSize;
+
+	if (chunkGrid.width != tileMap.GetWidth() || chunkGrid.length != tileMap.GetLength()) {
+		// Resized, so every baked tile may have moved, even if the number of chunks is the same.
+		chunkGrid.width = tileMap.GetWidth();
+		chunkGrid.length = tileMap.GetLength();
+		chunkGrid.numChunksX = numChunksX;
+		chunkGrid.numChunksY = numChunksY;
+		chunkGrid.chunks.clear();
+		chunkGrid.chunks.resize(numChunksX * numChunksY);
+	}
+
+	return chunkGrid;
+}
+
+template<RenderPerspective Perspective>
+void SceneGraph::BakeTileChunk(const TileMap& tileMap, size_t chunkX, size_t chunkY, TileChunk& chunk) const
+{
+	chunk.tiles.clear();
+
+	const auto sHalfTileSize = Point<float>(m_HalfTileWidth * m_Zoom, m_HalfTileHeight * m_Zoom);
+
+	const auto endX = std::min((chunkX + 1) * s_TileChunkSize, tileMap.GetWidth());
+	const auto endY = std::min((chunkY + 1) * s_TileChunkSize, tileMap.GetLength());
+
+	for (size_t i = chunkY * s_TileChunkSize; i < endY; ++i) {
+		for (size_t j = chunkX * s_TileChunkSize; j < endX; ++j) {
+			// Top left corner of the tile, without the camera translation.
+			const auto sPosition = ToCartesianCoord<Perspective>({ static_cast<float>(j), static_cast<float>(i) }) * m_Zoom - sHalfTileSize;
+
+			int numLayersToRender = tileMap.GetNumLayers(j, i);
+			if (tileMap.AreTransitionsHidden()) {
+				// Only render base tile.
+				numLayersToRender = 1;
+			}
+
+			// Every layer is kept, as a tile without a sprite now may be animated onto one later.
+			for (int layer = 0; layer < numLayersToRender; ++layer) {
+				chunk.tiles.push_back({ static_cast<uint32_t>(j), static_cast<uint32_t>(i), layer, sPosition });
+			}
+		}
+	}
+
+	chunk.isDirty = false;
+}
+
+void SceneGraph::InvalidateTileChunk(size_t index, size_t x, size_t y)
+{
+	ReleaseTileMapCopy(index);
+
+	if (index >= m_TileChunkGrids.size()) {
+		// Tile map hasn't been cached yet.
+		return;
+	}
+
+	auto& chunkGrid = m_TileChunkGrids[index];
+	const auto chunkX = x / s_TileChunkSize;
+	const auto chunkY = y / s_TileChunkSize;
+
+	if (chunkX < chunkGrid.numChunksX && chunkY < chunkGrid.numChunksY) {
+		chunkGrid.chunks[chunkY * chunkGrid.numChunksX + chunkX].isDirty = true;
+	}
+}
+
+void SceneGraph::InvalidateTileChunks(size_t index, const Rect<>& tileRect)
+{
+	ReleaseTileMapCopy(index);
+
+	if (index >= m_TileChunkGrids.size() || tileRect.GetWidth() <= 0 || tileRect.GetHeight() <= 0 ||
+		tileRect.GetRight() <= 0 || tileRect.GetBottom() <= 0) {
+		// Tile map hasn't been cached yet, or the block is empty or before the first tile.
+		return;
+	}
+
+	auto& chunkGrid = m_TileChunkGrids[index];
+	if (chunkGrid.numChunksX == 0 || chunkGrid.numChunksY == 0) {
+		return;
+	}
+
+	// Clamp to the tile map, then mark every chunk the block overlaps.
+	const auto firstX = static_cast<size_t>(std::max(tileRect.GetX(), 0));
+	const auto firstY = static_cast<size_t>(std::max(tileRect.GetY(), 0));
+	const auto lastX = static_cast<size_t>(tileRect.GetRight() - 1);
+	const auto lastY = static_cast<size_t>(tileRect.GetBottom() - 1);
+
+	const auto lastChunkX = std::min(lastX / s_TileChunkSize, chunkGrid.numChunksX - 1);
+	const auto lastChunkY = std::min(lastY / s_TileChunkSize, chunkGrid.numChunksY - 1);
+
+	for (auto chunkY = firstY / s_TileChunkSize; chunkY <= lastChunkY; ++chunkY) {
+		for (auto chunkX = firstX / s_TileChunkSize; chunkX <= lastChunkX; ++chunkX) {
+			chunkGrid.chunks[chunkY * chunkGrid.numChunksX + chunkX].isDirty = true;
+		}
+	}
+}
+
+void SceneGraph::ReleaseTileMapCopy(size_t index)
+{
+	// The copy shared with snapshots no longer matches, so the next capture makes a new one.
+	if (index < m_TileMapCopies.size()) {
+		m_TileMapCopies[index].reset();
+	}
+}
+
+void SceneGraph::InvalidateTileChunks()
+{
+	for (auto& chunkGrid : m_TileChunkGrids) {
+		for (auto& chunk : chunkGrid.chunks) {
+			chunk.isDirty = true;
+		}
+	}
+}
+
+void SceneGraph::DrawTile(const Sprite& sprite, const Rect<>& destRect, const Rect<>& mask, int layer)
+{
+	PROFILE_COUNT(m_Profiler, ProfileCounter::TILES_DRAWN, 1);
+
+	if (m_IsTileBatchingEnabled) {
+		m_TileBatch.push_back({ &sprite, destRect, mask, layer });
+	}
+	else {
+		m_RendererRef.RenderSprite(sprite, destRect, mask);
+		PROFILE_COUNT(m_Profiler, ProfileCounter::SPRITES_SUBMITTED, 1);
+	}
+}
+
+void SceneGraph::FlushTileBatch()
+{
+	if (m_TileBatch.empty()) {
+		return;
+	}
+
+	// Order by layer first so transitions are still drawn over base tiles, then group by sprite atlas. 
+	// A stable sort keeps the visit order within an atlas run.
+	std::stable_sort(m_TileBatch.begin(), m_TileBatch.end(), [](const TileDrawCommand& lhs, const TileDrawCommand& rhs) {
+		if (lhs.layer != rhs.layer) {
+			return lhs.layer < rhs.layer;
+		}
+		return std::less<const Sprite*>()(lhs.pSprite, rhs.pSprite);
+	});
+
+	// Submit each atlas run back to back so the renderer never has to switch textures mid-run.
+	for (const auto& command : m_TileBatch) {
+		m_RendererRef.RenderSprite(*command.pSprite, command.destRect, command.mask);
+	}
+
+	PROFILE_COUNT(m_Profiler, ProfileCounter::SPRITES_SUBMITTED, m_TileBatch.size());
+
+	m_TileBatch.clear();
+}
+
+Actor* SceneGraph::SpawnActor(std::string actorXmlFilename)
+{
+	// Call overloaded method with default parameters.
+	return SpawnActor(actorXmlFilename, Point<float>(), 0);
+}
+
+Actor* SceneGraph::SpawnActor(const std::string& actorXmlFilename, const Point<float>& position, float elevation)
+{
+	auto spawnLock = LockSpawning();
+
+	// Create the actor.
+	auto pActor = m_Actors.Create<Actor>(this, position, elevation);
+	if (!InitialiseActor(pActor, actorXmlFilename)) {
+		return nullptr;
+	}
+
+	return AddActor(std::move(pActor));
+}
+
+size_t SceneGraph::SpawnActors(const std::string& actorXmlFilename, const Point<float>* pPositions, size_t count, float elevation, Actor** pSpawnedActors)
+{
+	auto spawnLock = LockSpawning();
+
+	m_Actors.Reserve(m_Actors.GetNumActors() + count);
+	if (!m_IsUpdatingInParallel) {
+		// Otherwise the actors are queued per thread.
+		m_MovedActors.reserve(m_MovedActors.size() + count);
+	}
+
+	size_t numSpawned = 0;
+
+	for (size_t i = 0; i < count; ++i) {
+		Actor* pActorRef = nullptr;
+
+		auto pActor = m_Actors.Create<Actor>(this, pPositions[i], elevation);
+		if (InitialiseActor(pActor, actorXmlFilename)) {
+			pActorRef = AddActor(std::move(pActor));
+			++numSpawned;
+		}
+
+		if (pSpawnedActors) {
+			pSpawnedActors[i] = pActorRef;
+		}
+	}
+
+	return numSpawned;
+}
+
+void SceneGraph::PreloadActorPrototypes(std::vector<std::string> actorXmlFilenames, std::function<void(size_t)> onComplete)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_PreloadMutex);
+		m_QueuedPreloads.push_back({ std::move(actorXmlFilenames), std::move(onComplete) });
+	}
+
+	if (!m_PreloadThread.joinable()) {
+		m_PreloadThread = std::thread(&SceneGraph::PreloadThreadMain, this);
+	}
+
+	m_PreloadsQueued.notify_one();
+}
+
+void SceneGraph::ClearActorPrototypes()
+{
+	{
+		// A preload finishing after the clear would bring back the prototypes of the old resources.
+		std::unique_lock<std::mutex> lock(m_PreloadMutex);
+		m_PreloadsFinished.wait(lock, [this]() { return m_IsShuttingDownPreloads || (m_QueuedPreloads.empty() && !m_IsPreloading); });
+	}
+
+	std::lock_guard<std::mutex> factoryLock(m_ActorFactoryMutex);
+	m_ActorPrototypes.clear();
+}
+
+void SceneGraph::CompletePrototypePreloads()
+{
+	std::vector<PrototypePreload> completedPreloads;
+	{
+		std::lock_guard<std::mutex> lock(m_PreloadMutex);
+		completedPreloads.swap(m_CompletedPreloads);
+	}
+
+	for (const auto& preload : completedPreloads) {
+		if (preload.onComplete) {
+			preload.onComplete(preload.numInitialised);
+		}
+	}
+}
+
+void SceneGraph::PreloadThreadMain()
+{
+	std::unique_lock<std::mutex> lock(m_PreloadMutex);
+
+	while (true) {
+		m_PreloadsQueued.wait(lock, [this]() { return m_IsShuttingDownPreloads || !m_QueuedPreloads.empty(); });
+
+		// Prototypes left unloaded are initialised by their first spawn instead.
+		if (m_IsShuttingDownPreloads) {
+			return;
+		}
+
+		auto preload = std::move(m_QueuedPreloads.front());
+		m_QueuedPreloads.pop_front();
+		m_IsPreloading = true;
+
+		lock.unlock();
+		for (const auto& actorXmlFilename : preload.actorXmlFilenames) {
+			if (GetActorPrototype(actorXmlFilename)) {
+				++preload.numInitialised;
+			}
+		}
+		lock.lock();
+
+		m_CompletedPreloads.push_back(std::move(preload));
+		m_IsPreloading = false;
+
+		m_PreloadsFinished.notify_all();
+	}
+}
+
+bool SceneGraph::InitialiseActor(PooledActorPtr<Actor>& pActor, const std::string& actorXmlFilename)
+{
+	if (!m_CloneActor) {
+		std::lock_guard<std::mutex> factoryLock(m_ActorFactoryMutex);
+		return m_ActorFactoryRef.AddComponentsAndInitaliseActor(pActor, actorXmlFilename);
+	}
+
+	// Prototypes are never destroyed while actors are being spawned, so it's safe to clone outside the lock.
+	auto pPrototype = GetActorPrototype(actorXmlFilename);
+	return pPrototype && m_CloneActor(*pPrototype, *pActor);
+}
+
+const Actor* SceneGraph::GetActorPrototype(const std::string& actorXmlFilename)
+{
+	std::lock_guard<std::mutex> factoryLock(m_ActorFactoryMutex);
+
+	auto iter = m_ActorPrototypes.find(actorXmlFilename);
+	if (iter == m_ActorPrototypes.end()) {
+		auto pPrototype = m_ActorPrototypeStore.Create<Actor>(this, Point<float>(), 0.0f);
+		if (!m_ActorFactoryRef.AddComponentsAndInitaliseActor(pPrototype, actorXmlFilename)) {
+			// Kept as null, so the resource isn't parsed again by every spawn.
+			pPrototype.reset();
+		}
+
+		iter = m_ActorPrototypes.emplace(actorXmlFilename, std::move(pPrototype)).first;
+	}
+
+	return iter->second.get();
+}
+
+void SceneGraph::NotifyActorMoved(Actor* pActor)
+{
+	if (m_IsUpdatingInParallel) {
+		m_ThreadActorQueues[JobPool::GetCurrentThreadIndex()].moved.push_back(pActor);
+	}
+	else {
+		m_MovedActors.push_back(m_Actors.GetHandle(pActor));
+	}
+
+	WakeActor(pActor);
+}
+
+void SceneGraph::NotifyActorPendingDestroy(Actor* pActor)
+{
+	if (m_IsUpdatingInParallel) {
+		m_ThreadActorQueues[JobPool::GetCurrentThreadIndex()].pendingDestroy.push_back(pActor);
+	}
+	else {
+		m_PendingDestroyActors.push_back(pActor);
+	}
+}
+
+void SceneGraph::DestroyActors(const ActorHandle* pHandles, size_t count)
+{
+	for (size_t i = 0; i < count; ++i) {
+		auto pActor = m_Actors.GetActor(pHandles[i]);
+		if (pActor) {
+			m_PendingDestroyActors.push_back(pActor);
+		}
+	}
+
+	DestroyPendingActors();
+}
+
+void SceneGraph::ClearActors()
+{
+	// Every actor, not only the live ones, as actors spawned this frame are already in the spatial index.
+	m_Actors.ForEachActor([this](Actor* pActor) {
+		RemoveActor(pActor);
+	});
+
+	m_Actors.Clear();
+	m_NewActors.clear();
+	m_PendingDestroyActors.clear();
+	m_MovedActors.clear();
+	m_CollisionWorld.ClearContacts();
+}
+
+Actor* SceneGraph::RaycastFirstHit(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, uint32_t tileBlockingMask)
+{
+	PROFILE_SCOPE(m_Profiler, ProfilePhase::RAYCAST);
+	PROFILE_COUNT(m_Profiler, ProfileCounter::RAYCASTS, 1);
+
+	// Actors behind a blocking tile can't be hit, so only cast up to the tile.
+	auto fraction = 1.0f;
+	Actor* pHit;
+	if (tileBlockingMask != 0 && FindBlockingTile(origin, end, tileBlockingMask, fraction)) {
+		pHit = m_pSpatialIndex->RaycastFirstHit(origin, origin + (end - origin) * fraction, actorsToIgnore);
+	}
+	else {
+		pHit = m_pSpatialIndex->RaycastFirstHit(origin, end, actorsToIgnore);
+	}
+
+	if (pHit) {
+		WakeActor(pHit);
+	}
+
+	return pHit;
+}
+
+Actor* SceneGraph::RaycastFirstHit(const Point<float>& origin, const Point<float>& direction, float distance, const ActorIgnoreList& actorsToIgnore)
+{
+	return RaycastFirstHit(origin, origin + (direction * distance), actorsToIgnore);
+}
+
+std::vector<Actor*> SceneGraph::Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore)
+{
+	std::vector<Actor*> actorsHit;
+	Raycast(origin, end, actorsHit, actorsToIgnore);
+	return actorsHit;
+}
+
+std::vector<Actor*> SceneGraph::Raycast(const Point<float>& origin, const Point<float>& direction, float distance, const ActorIgnoreList& actorsToIgnore)
+{
+	return Raycast(origin, origin + (direction * distance), actorsToIgnore);
+}
+
+void SceneGraph::Raycast(const Point<float>& origin, const Point<float>& end, std::vector<Actor*>& actorsHit, const ActorIgnoreList& actorsToIgnore, uint32_t tileBlockingMask)
+{
+	actorsHit.clear();
+
+	VisitRaycastHits(origin, end, actorsToIgnore, tileBlockingMask, [&actorsHit](Actor* pActor) {
+		actorsHit.push_back(pActor);
+		return true;
+	});
+}
+
+FrameVector<Actor*> SceneGraph::Raycast(const Point<float>& origin, const Point<float>& end, FrameArena& arena, const ActorIgnoreList& actorsToIgnore, uint32_t tileBlockingMask)
+{
+	FrameVector<Actor*> actorsHit{ FrameArenaAllocator<Actor*>(arena) };
+
+	VisitRaycastHits(origin, end, actorsToIgnore, tileBlockingMask, [&actorsHit](Actor* pActor) {
+		actorsHit.push_back(pActor);
+		return true;
+	});
+
+	return actorsHit;
+}
+
+void SceneGraph::VisitRaycastHits(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, uint32_t tileBlockingMask, const ActorVisitor& visitor)
+{
+	PROFILE_SCOPE(m_Profiler, ProfilePhase::RAYCAST);
+	PROFILE_COUNT(m_Profiler, ProfileCounter::RAYCASTS, 1);
+
+	auto wakeAndVisit = [this, &visitor](Actor* pActor) {
+		WakeActor(pActor);
+		return visitor(pActor);
+	};
+
+	auto fraction = 1.0f;
+	if (tileBlockingMask != 0 && FindBlockingTile(origin, end, tileBlockingMask, fraction)) {
+		m_pSpatialIndex->Raycast(origin, origin + (end - origin) * fraction, actorsToIgnore, wakeAndVisit);
+	}
+	else {
+		m_pSpatialIndex->Raycast(origin, end, actorsToIgnore, wakeAndVisit);
+	}
+}
+
+void SceneGraph::RaycastFirstHits(const Point<float>* pOrigins, const Point<float>* pEnds, size_t count, Actor** pHits, Actor* const* pCasters, const ActorIgnoreList& actorsToIgnore, uint32_t tileBlockingMask)
+{
+	PROFILE_SCOPE(m_Profiler, ProfilePhase::RAYCAST);
+	PROFILE_COUNT(m_Profiler, ProfileCounter::RAYCASTS, count);
+
+	if (tileBlockingMask == 0) {
+		m_pSpatialIndex->RaycastFirstHits(pOrigins, pEnds, pCasters, count, actorsToIgnore, pHits, m_pUpdateJobPool.get());
+	}
+	else {
+		// Shorten each ray to its first blocking tile. Kept per thread rather than in the frame arena, which
+		// would grow with every call made while the scene isn't updating.
+		thread_local std::vector<Point<float>> ends;
+		ends.assign(pEnds, pEnds + count);
+
+		for (size_t i = 0; i < count; ++i) {
+			auto fraction = 1.0f;
+			if (FindBlockingTile(pOrigins[i], pEnds[i], tileBlockingMask, fraction)) {
+				ends[i] = pOrigins[i] + (pEnds[i] - pOrigins[i]) * fraction;
+			}
+		}
+
+		m_pSpatialIndex->RaycastFirstHits(pOrigins, ends.data(), pCasters, count, actorsToIgnore, pHits, m_pUpdateJobPool.get());
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		if (pHits[i]) {
+			WakeActor(pHits[i]);
+		}
+	}
+}
+
+bool SceneGraph::RaycastTiles(const Point<float>& origin, const Point<float>& end, uint32_t blockingMask, Point<float>* pHitPosition) const
+{
+	auto fraction = 1.0f;
+	if (!FindBlockingTile(origin, end, blockingMask, fraction)) {
+		return false;
+	}
+
+	if (pHitPosition) {
+		*pHitPosition = origin + (end - origin) * fraction;
+	}
+
+	return true;
+}
+
+void SceneGraph::SetTileBlockingMask(size_t x, size_t y, uint32_t blockingMask)
+{
+	const auto& tileMap = m_TileMaps.front();
+	if (tileMap.GetWidth() != m_TileBlockingMaskWidth || tileMap.GetLength() != m_TileBlockingMaskLength) {
+		// The base tile map has been resized since.
+		ResizeTileBlockingMasks(tileMap.GetWidth(), tileMap.GetLength());
+	}
+
+	if (x >= m_TileBlockingMaskWidth || y >= m_TileBlockingMaskLength) {
+		DEBUG_ERROR() << "Failed to set tile blocking mask. Tile (" << x << ", " << y << ") is outside the base tile map.";
+		return;
+	}
+
+	m_TileBlockingMasks[y * m_TileBlockingMaskWidth + x] = blockingMask;
+	m_TileBlockingMaskCopy.reset();
+}
+
+uint32_t SceneGraph::GetTileBlockingMask(size_t x, size_t y) const
+{
+	if (x >= m_TileBlockingMaskWidth || y >= m_TileBlockingMaskLength) {
+		return 0;
+	}
+
+	return m_TileBlockingMasks[y * m_TileBlockingMaskWidth + x];
+}
+
+void SceneGraph::ResizeTileBlockingMasks(size_t width, size_t length)
+{
+	std::vector<uint32_t> tileBlockingMasks(width * length, 0);
+
+	for (size_t y = 0; y < std::min(length, m_TileBlockingMaskLength); ++y) {
+		const auto pRow = m_TileBlockingMasks.data() + y * m_TileBlockingMaskWidth;
+		std::copy(pRow, pRow + std::min(width, m_TileBlockingMaskWidth), tileBlockingMasks.data() + y * width);
+	}
+
+	m_TileBlockingMasks.swap(tileBlockingMasks);
+	m_TileBlockingMaskWidth = width;
+	m_TileBlockingMaskLength = length;
+	m_TileBlockingMaskCopy.reset();
+}
+
+bool SceneGraph::FindBlockingTile(const Point<float>& origin, const Point<float>& end, uint32_t blockingMask, float& fraction) const
+{
+	// Walk the masks rather than the base tile map, which may have been resized since they were set.
+	const auto numTilesX = static_cast<ptrdiff_t>(m_TileBlockingMaskWidth);
+	const auto numTilesY = static_cast<ptrdiff_t>(m_TileBlockingMaskLength);
+	if (numTilesX == 0 || numTilesY == 0) {
+		return false;
+	}
+
+	// Tiles are centred on whole world coordinates, so tile (0, 0) spans -0.5 to 0.5.
+	const Point<float> gridOrigin = { -0.5f, -0.5f };
+	const auto delta = end - origin;
+
+	// Clip the ray to the tile map.
+	auto start = 0.0f;
+	auto finish = 1.0f;
+
+	auto clipAxis = [&start, &finish](float position, float step, float min, float max) {
+		if (step == 0.0f) {
+			return position >= min && position <= max;
+		}
+
+		auto slabEntry = (min - position) / step;
+		auto slabExit = (max - position) / step;
+		if (slabEntry > slabExit) {
+			std::swap(slabEntry, slabExit);
+		}
+
+		start = std::max(start, slabEntry);
+		finish = std::min(finish, slabExit);
+		return start <= finish;
+	};
+
+	if (!clipAxis(origin.X(), delta.X(), gridOrigin.X(), gridOrigin.X() + numTilesX) ||
+		!clipAxis(origin.Y(), delta.Y(), gridOrigin.Y(), gridOrigin.Y() + numTilesY)) {
+		return false;
 	}
 
-	// Resolve collisions in the tree.
-	m_QuadTreeRoot.ResolveCollisions();
-}
+	auto isBlocked = false;
 
-void SceneGraph::Render()
-{
-	RenderTileMaps();
-	RenderActors();
-}
+	TraverseGrid(origin, delta, start, finish, gridOrigin, 1.0f, numTilesX, numTilesY, [&](ptrdiff_t x, ptrdiff_t y, float entry, float exit) {
+		if ((m_TileBlockingMasks[y * numTilesX + x] & blockingMask) != 0) {
+			isBlocked = true;
+			fraction = entry;
+			return false;
+		}
 
+		return true;
+	});
 
-void SceneGraph::RenderActors()
-{
-	m_QuadTreeRoot.Render(*this);
+	return isBlocked;
 }
 
-void SceneGraph::RenderTileMaps()
+Actor* SceneGraph::PickActor(const Point<>& sPosition)
 {
-	auto screenCentrePosition = m_RendererRef.GetScreenCentrePosition();
-	auto cullingBoxExtent = screenCentrePosition.X() / (m_TileWidth * m_Zoom) + screenCentrePosition.Y() / (m_TileHeight * m_Zoom);
-
-	auto minX = static_cast<int>(std::roundf(m_wCameraPosition.X() - cullingBoxExtent));
-	auto minY = static_cast<int>(std::roundf(m_wCameraPosition.Y() - cullingBoxExtent));
-	auto maxX = static_cast<int>(std::roundf(m_wCameraPosition.X() + cullingBoxExtent)) + 1;
-	auto maxY = static_cast<int>(std::roundf(m_wCameraPosition.Y() + cullingBoxExtent)) + 1;
-
-	minX = std::max(minX, 0);
-	minY = std::max(minY, 0);
+	if (!m_HasPickBounds) {
+		// Nothing has been drawn yet.
+		auto wPosition = ToWorldPosition(sPosition);
+		auto pActor = m_pSpatialIndex->RaycastFirstHit(wPosition, wPosition, {});
+		if (pActor) {
+			WakeActor(pActor);
+		}
+		return pActor;
+	}
 
-	for (auto& tileMap : m_TileMaps) {
-		const auto gridLength = tileMap.GetLength();
-		const auto gridWidth = tileMap.GetWidth();
+	if (m_IsPickIndexDirty) {
+		BuildPickIndex();
+	}
 
-		if (static_cast<size_t>(minY) < gridLength && static_cast<size_t>(minX) < gridWidth) {
-			// Render tile map.
+	if (sPosition.X() < 0 || sPosition.Y() < 0) {
+		return nullptr;
+	}
 
-			// Get the screen position of the renderable.
-			auto position = Point<float>();
-			auto screenPosition = ToScreenPosition(position, 0);
+	const auto cellX = sPosition.X() / s_PickCellSize;
+	const auto cellY = sPosition.Y() / s_PickCellSize;
+	if (cellX >= m_NumPickCellsX || cellY >= m_NumPickCellsY) {
+		return nullptr;
+	}
 
-			auto sHalfTileWidth = m_HalfTileWidth * m_Zoom;
-			auto sHalfTileHeight = m_HalfTileHeight * m_Zoom;
+	// Walk the bounds of the cell in reverse draw order, so the topmost sprite is found first.
+	const auto cell = cellY * m_NumPickCellsX + cellX;
 
-			// World position is the centre of the tile/object, so we must adjust 
-			// the screen position to the top left corner.
-			screenPosition = {
-				screenPosition.X() - sHalfTileWidth,
-				screenPosition.Y() - sHalfTileHeight
-			};
+	for (auto i = m_PickCellStarts[cell + 1]; i-- > m_PickCellStarts[cell];) {
+		const auto& bounds = m_PickBounds[m_PickCellBounds[i]];
+		const auto& destRect = bounds.destRect;
 
-			auto nextPosition = screenPosition;
+		if (sPosition.X() < destRect.GetLeft() || sPosition.X() >= destRect.GetRight() ||
+			sPosition.Y() < destRect.GetTop() || sPosition.Y() >= destRect.GetBottom()) {
+			continue;
+		}
 
-			Point<float> xIncrease;
-			Point<float> yIncrease;
-			if (m_RenderPerspective == RenderPerspective::ISOMETRIC) {
-				xIncrease = { sHalfTileWidth, sHalfTileHeight };
-				yIncrease = { -sHalfTileWidth, sHalfTileHeight };
-			}
-			else if (m_RenderPerspective == RenderPerspective::OBLIQUE) {
-				xIncrease = { m_TileWidth * m_Zoom, 0.0f };
-				yIncrease = { 0.0f, m_TileHeight * m_Zoom };
-			}
+		if (m_IsPickAlphaTestingEnabled && !IsPickOpaque(bounds, sPosition)) {
+			continue;
+		}
 
-			for (size_t i = minY; i < gridLength && i < static_cast<size_t>(maxY); ++i) {
-				for (size_t j = minX; j < gridWidth && j < static_cast<size_t>(maxX); ++j) {
-
-					nextPosition = ToScreenPosition({ static_cast<float>(j), static_cast<float>(i) }, 0.0f);
-					Rect<> destRect = {
-						static_cast<int>(nextPosition.X() - m_HalfTileWidth * m_Zoom),
-						static_cast<int>(nextPosition.Y() - m_HalfTileHeight * m_Zoom),
-						static_cast<int>(std::ceil(m_TileWidth * m_Zoom)),
-						static_cast<int>(std::ceil(m_TileHeight * m_Zoom))
-					};
-
-					int numLayersToRender = tileMap.GetNumLayers(j, i);
-					if (tileMap.AreTransitionsHidden()) {
-						// Only render base tile.
-						numLayersToRender = 1;
-					}
-
-					for (int layer = 0; layer < numLayersToRender; ++layer) {
-						auto& tile = tileMap.GetTile(j, i, layer);
-						auto pSprite = tile.GetSpriteForRender();
-						if (pSprite) {
-							auto mask = tile.GetMaskForRender();
-
-							m_RendererRef.RenderSprite(*pSprite, destRect, mask);
-						}
-					}
-				}
-			}
+		// Null if the actor has been destroyed since it was drawn.
+		auto pActor = m_Actors.GetActor(bounds.actor);
+		if (pActor) {
+			WakeActor(pActor);
+			return pActor;
 		}
 	}
-}
 
-Actor* SceneGraph::SpawnActor(std::string actorXmlFilename)
-{
-	// Call overloaded method with default parameters.
-	return SpawnActor(actorXmlFilename, Point<float>(), 0);
+	return nullptr;
 }
 
-Actor* SceneGraph::SpawnActor(const std::string& actorXmlFilename, const Point<float>& position, float elevation)
+void SceneGraph::BuildPickIndex()
 {
-	// Create the actor.
-	auto pActor = std::make_unique<Actor>(this, position, elevation);
-	if (!m_ActorFactoryRef.AddComponentsAndInitaliseActor(pActor, actorXmlFilename)) {
-		return nullptr;
-	}
+	// Bounds are clipped to the screen, as anything off screen can't be picked.
+	const auto& screenCentrePosition = m_RendererRef.GetScreenCentrePosition();
+	const auto screenWidth = screenCentrePosition.X() * 2;
+	const auto screenHeight = screenCentrePosition.Y() * 2;
 
-	return AddActor(std::move(pActor));
-}
+	m_NumPickCellsX = std::max(1, (screenWidth + s_PickCellSize - 1) / s_PickCellSize);
+	m_NumPickCellsY = std::max(1, (screenHeight + s_PickCellSize - 1) / s_PickCellSize);
 
-void SceneGraph::ClearActors()
-{
-	for (const auto& pActor : m_Actors) {
-		RemoveActor(pActor.get());
+	const auto numCells = static_cast<size_t>(m_NumPickCellsX * m_NumPickCellsY);
+
+	auto forEachCell = [this](const Rect<>& destRect, auto function) {
+		const auto left = std::max(0, destRect.GetLeft() / s_PickCellSize);
+		const auto right = std::min(m_NumPickCellsX - 1, (destRect.GetRight() - 1) / s_PickCellSize);
+		const auto top = std::max(0, destRect.GetTop() / s_PickCellSize);
+		const auto bottom = std::min(m_NumPickCellsY - 1, (destRect.GetBottom() - 1) / s_PickCellSize);
+
+		if (destRect.GetRight() <= 0 || destRect.GetBottom() <= 0) {
+			return;
+		}
+
+		for (auto y = top; y <= bottom; ++y) {
+			for (auto x = left; x <= right; ++x) {
+				function(static_cast<size_t>(y * m_NumPickCellsX + x));
+			}
+		}
+	};
+
+	// Count the bounds of each cell, then place them with a prefix sum, keeping the draw order within each cell.
+	m_PickCellStarts.assign(numCells + 1, 0);
+
+	for (const auto& bounds : m_PickBounds) {
+		forEachCell(bounds.destRect, [this](size_t cell) {
+			++m_PickCellStarts[cell + 1];
+		});
 	}
 
-	m_Actors.clear();
-}
+	for (size_t cell = 0; cell < numCells; ++cell) {
+		m_PickCellStarts[cell + 1] += m_PickCellStarts[cell];
+	}
 
-Actor* SceneGraph::RaycastFirstHit(const Point<float>& origin, const Point<float>& end, const std::vector<Actor*>& actorsToIgnore)
-{
-	return m_QuadTreeRoot.RaycastFirstHit(origin, end, actorsToIgnore);
-}
+	m_PickCellBounds.resize(m_PickCellStarts[numCells]);
 
-Actor* SceneGraph::RaycastFirstHit(const Point<float>& origin, const Point<float>& direction, float distance, const std::vector<Actor*>& actorsToIgnore)
-{
-	return RaycastFirstHit(origin, origin + (direction * distance), actorsToIgnore);
-}
+	m_PickCellEnds.assign(m_PickCellStarts.begin(), m_PickCellStarts.end() - 1);
 
-std::vector<Actor*> SceneGraph::Raycast(const Point<float>& origin, const Point<float>& end, const std::vector<Actor*>& actorsToIgnore)
-{
-	return m_QuadTreeRoot.Raycast(origin, end, actorsToIgnore);
-}
+	for (uint32_t i = 0; i < m_PickBounds.size(); ++i) {
+		forEachCell(m_PickBounds[i].destRect, [this, i](size_t cell) {
+			m_PickCellBounds[m_PickCellEnds[cell]++] = i;
+		});
+	}
 
-std::vector<Actor*> SceneGraph::Raycast(const Point<float>& origin, const Point<float>& direction, float distance, const std::vector<Actor*>& actorsToIgnore)
-{
-	return Raycast(origin, origin + (direction * distance), actorsToIgnore);
+	m_IsPickIndexDirty = false;
 }
 
-Actor* SceneGraph::PickActor(const Point<>& sPosition)
+bool SceneGraph::IsPickOpaque(const PickBounds& bounds, const Point<>& sPosition) const
 {
-	auto wPosition = ToWorldPosition(sPosition);
-	return m_QuadTreeRoot.RaycastFirstHit(wPosition, wPosition, {});
+	auto iter = m_SpriteHitMasks.find(bounds.pSprite);
+	if (iter == m_SpriteHitMasks.end()) {
+		return true;
+	}
+
+	// Map the screen position back onto the part of the sprite's image that was drawn.
+	const auto& destRect = bounds.destRect;
+	const auto& mask = bounds.mask;
+	if (destRect.GetWidth() <= 0 || destRect.GetHeight() <= 0) {
+		return false;
+	}
+
+	const auto x = mask.GetX() + (sPosition.X() - destRect.GetX()) * mask.GetWidth() / destRect.GetWidth();
+	const auto y = mask.GetY() + (sPosition.Y() - destRect.GetY()) * mask.GetHeight() / destRect.GetHeight();
+
+	return iter->second.IsOpaque(x, y);
 }
 
 TileMap& SceneGraph::GetTileMap(size_t index)
 {
+	// Edits are reported through InvalidateTileChunks(), so the copy shared with snapshots is kept until then.
 	// Perform const cast trick to avoid code duplication. This just calls the const version of GetTileMap().
 	return const_cast<TileMap&>(static_cast<const SceneGraph&>(*this).GetTileMap(index));
 }
 
+TileMap& SceneGraph::GetTileMap(size_t index, size_t x, size_t y)
+{
+	InvalidateTileChunk(index, x, y);
+	return m_TileMaps[index];
+}
+
 void SceneGraph::SetTileDimensions(int tileWidth, int tileHeight)
 {
 	m_TileWidth = tileWidth;
 	m_TileHeight = tileHeight;
 	m_HalfTileWidth = static_cast<int>(tileWidth / 2.0f);
 	m_HalfTileHeight = static_cast<int>(tileHeight / 2.0f);
+
+	UpdateCameraTransform();
+	InvalidateTileChunks();
 }
 
 Point<int> SceneGraph::GetTileDimensions() const
@@ -264,156 +1876,445 @@ Point<int> SceneGraph::GetTileDimensions() const
 
 void SceneGraph::SetMaxNumActorsPerCell(size_t maxNumActors)
 {
-	m_QuadTreeRoot.SetMaxNumActors(maxNumActors, true);
+	m_pSpatialIndex->SetMaxNumActorsPerCell(maxNumActors);
 }
 
 Point<float> SceneGraph::ToScreenPosition(const Point<float>& wPosition, float wElevation) const
 {
-	const auto sPosition = ToCartesianCoord(wPosition);
+	return m_WorldToScreenTransform.Apply(wPosition);
+}
 
-	// Get the centre of the screen in isometric space so that the camera is always the centre of the screen.
-	const auto& screenCentrePosition = m_RendererRef.GetScreenCentrePosition();
-	const auto wScreenCentreOffset = Point<float>(
-		static_cast<float>(screenCentrePosition.X()), 
-		static_cast<float>(screenCentrePosition.Y()));
+Point<float> SceneGraph::ToWorldPosition(const Point<>& sPosition) const
+{
+	return m_ScreenToWorldTransform.Apply(Point<float>(static_cast<float>(sPosition.X()), static_cast<float>(sPosition.Y())));
+}
 
-	return (sPosition - m_sCameraPosition) * m_Zoom + wScreenCentreOffset;
+void SceneGraph::ToScreenPositions(const float* pWX, const float* pWY, float* pSX, float* pSY, size_t count) const
+{
+	m_WorldToScreenTransform.Apply(pWX, pWY, pSX, pSY, count);
 }
 
-Point<float> SceneGraph::ToWorldPosition(const Point<>& sPosition) const
+void SceneGraph::ToWorldPositions(const float* pSX, const float* pSY, float* pWX, float* pWY, size_t count) const
 {
-	auto wPosition = ToIsometricCoord(sPosition - m_RendererRef.GetScreenCentrePosition());
+	m_ScreenToWorldTransform.Apply(pSX, pSY, pWX, pWY, count);
+}
+
+void SceneGraph::UpdateCameraTransform()
+{
+	// Update screen camera position.
+	m_sCameraPosition = ToCartesianCoord(m_wCameraPosition);
+	m_sCameraPosition = { std::floor(m_sCameraPosition.X()), std::floor(m_sCameraPosition.Y()) };
+
+	m_sScreenCentrePosition = m_RendererRef.GetScreenCentrePosition();
+	const auto sCentreX = static_cast<float>(m_sScreenCentrePosition.X());
+	const auto sCentreY = static_cast<float>(m_sScreenCentrePosition.Y());
+
+	// Both perspectives are linear, so the images of the unit axes are the columns of the transforms.
+	const auto sAxisX = ToCartesianCoord({ 1.0f, 0.0f });
+	const auto sAxisY = ToCartesianCoord({ 0.0f, 1.0f });
+
+	// Zoom, then offset so that the camera is always the centre of the screen.
+	m_WorldToScreenTransform.m00 = sAxisX.X() * m_Zoom;
+	m_WorldToScreenTransform.m01 = sAxisY.X() * m_Zoom;
+	m_WorldToScreenTransform.m10 = sAxisX.Y() * m_Zoom;
+	m_WorldToScreenTransform.m11 = sAxisY.Y() * m_Zoom;
+	m_WorldToScreenTransform.m02 = sCentreX - m_sCameraPosition.X() * m_Zoom;
+	m_WorldToScreenTransform.m12 = sCentreY - m_sCameraPosition.Y() * m_Zoom;
 
+	auto wAxisX = ToIsometricCoord({ 1, 0 });
+	auto wAxisY = ToIsometricCoord({ 0, 1 });
 	if (m_Zoom != 0.0f) {
-		wPosition /= m_Zoom;
+		wAxisX /= m_Zoom;
+		wAxisY /= m_Zoom;
 	}
-	wPosition += m_wCameraPosition;
 
-	return wPosition;
+	// Remove the screen centre offset before the linear part, then add the camera position after it.
+	m_ScreenToWorldTransform.m00 = wAxisX.X();
+	m_ScreenToWorldTransform.m01 = wAxisY.X();
+	m_ScreenToWorldTransform.m10 = wAxisX.Y();
+	m_ScreenToWorldTransform.m11 = wAxisY.Y();
+	m_ScreenToWorldTransform.m02 = m_wCameraPosition.X() - (wAxisX.X() * sCentreX + wAxisY.X() * sCentreY);
+	m_ScreenToWorldTransform.m12 = m_wCameraPosition.Y() - (wAxisX.Y() * sCentreX + wAxisY.Y() * sCentreY);
+
+	++m_CameraVersion;
 }
 
 Point<float> SceneGraph::ToCartesianCoord(const Point<float>& isometricCoord) const
 {
-	// The cartesian position.
-	auto cartesianPosition = Point<float>();
-
 	switch (m_RenderPerspective) {
 		case RenderPerspective::OBLIQUE: {
-			cartesianPosition = {
-				isometricCoord.X() * m_TileWidth,
-				isometricCoord.Y() * m_TileHeight
-			};
-			break;
+			return ToCartesianCoord<RenderPerspective::OBLIQUE>(isometricCoord);
 		}
 		case RenderPerspective::ISOMETRIC: {
-			cartesianPosition = {
-				(isometricCoord.X() - isometricCoord.Y()) * m_HalfTileWidth,
-				(isometricCoord.X() + isometricCoord.Y()) * m_HalfTileHeight
-			};
-			break;
+			return ToCartesianCoord<RenderPerspective::ISOMETRIC>(isometricCoord);
 		}
 		default: {
-			break;
+			return Point<float>();
 		}
 	}
-
-	return cartesianPosition;
 }
 
 Point<float> SceneGraph::ToIsometricCoord(const Point<>& cartesianCoord) const
 {
-	// The screen position.
-	auto isoPosition = Point<float>();
-
 	switch (m_RenderPerspective) {
 		case RenderPerspective::OBLIQUE: {
-			isoPosition = {
-				cartesianCoord.X() / static_cast<float>(m_TileWidth),
-				cartesianCoord.Y() / static_cast<float>(m_TileHeight)
-			};
-			break;
+			return ToIsometricCoord<RenderPerspective::OBLIQUE>(cartesianCoord);
 		}
 		case RenderPerspective::ISOMETRIC: {
-			isoPosition = {
-				((cartesianCoord.Y() / static_cast<float>(m_TileHeight)) + (cartesianCoord.X() / static_cast<float>(m_TileWidth))),
-				((cartesianCoord.Y() / static_cast<float>(m_TileHeight)) - (cartesianCoord.X() / static_cast<float>(m_TileWidth)))
-			};
-			break;
+			return ToIsometricCoord<RenderPerspective::ISOMETRIC>(cartesianCoord);
 		}
 		default: {
-			break;
+			return Point<float>();
 		}
 	}
-
-	return isoPosition;
 }
 
-void SceneGraph::Serialize(const std::string& filename)
+void SceneGraph::Serialize(const std::string& filename, bool isPretty) const
 {
-	rapidjson::Document jsonDocument;
-	jsonDocument.SetObject();
+	std::ofstream ofs(filename);
+	if (!ofs.is_open() || ofs.bad()) {
+		DEBUG_ERROR() << "Failed to serialize scene. Couldn't open file \'" << filename << "\' for writing.";
+		return;
+	}
 
-	auto& allocator = jsonDocument.GetAllocator();
+	// Write straight through to the file, so no part of the document is held in memory.
+	rapidjson::OStreamWrapper stream(ofs);
 
-	// Populate the json document.
-	rapidjson::Value jsonSceneRoot(rapidjson::kObjectType);
+	if (isPretty) {
+		rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(stream);
+		SerializeJson(writer);
+	}
+	else {
+		rapidjson::Writer<rapidjson::OStreamWrapper> writer(stream);
+		SerializeJson(writer);
+	}
 
-	// Add basic scene parameters.
-	jsonSceneRoot.AddMember("tile_width", m_TileWidth, allocator);
-	jsonSceneRoot.AddMember("tile_height", m_TileHeight, allocator);
-	jsonSceneRoot.AddMember("max_actors_per_cell", m_QuadTreeRoot.GetMaxNumActors(), allocator);
+	ofs.flush();
+	if (ofs.bad()) {
+		DEBUG_ERROR() << "Failed to serialize scene. Couldn't write file \'" << filename << "\'.";
+	}
+}
 
+template<typename JsonWriter>
+void SceneGraph::SerializeJson(JsonWriter& writer) const
+{
+	writer.StartObject();
+	writer.Key("scene");
+	writer.StartObject();
+
+	// Add basic scene parameters.
+	writer.Key("tile_width");
+	writer.Int(m_TileWidth);
+	writer.Key("tile_height");
+	writer.Int(m_TileHeight);
+	writer.Key("max_actors_per_cell");
+	writer.Uint64(m_pSpatialIndex->GetMaxNumActorsPerCell());
+
+	writer.Key("perspective");
 	if (m_RenderPerspective == RenderPerspective::ISOMETRIC) {
-		jsonSceneRoot.AddMember("perspective", "isometric", allocator);
+		writer.String("isometric");
 	}
 	else {
-		jsonSceneRoot.AddMember("perspective", "orthographic", allocator);
+		writer.String("orthographic");
 	}
 
-	// Add bounding box.
-	const auto& rootBoundingBox = m_QuadTreeRoot.GetBoundingBox();
-	jsonSceneRoot.AddMember("bounding_box", JsonHelper::ToJsonValue(rootBoundingBox, allocator), allocator);
+	// Add bounding box. Small enough that going through a value keeps it identical to JsonHelper's format.
+	{
+		rapidjson::Document jsonDocument;
+		const auto& rootBoundingBox = m_pSpatialIndex->GetBoundingBox();
+
+		writer.Key("bounding_box");
+		JsonHelper::ToJsonValue(rootBoundingBox, jsonDocument.GetAllocator()).Accept(writer);
+	}
 
 	// Add tile maps.
-	rapidjson::Value jsonTileMaps(rapidjson::kArrayType);
+	writer.Key("tile_maps");
+	writer.StartArray();
 
 	for (const auto& tileMap : m_TileMaps) {
-		jsonTileMaps.PushBack(tileMap.Serialize(allocator), allocator);
+		SerializeTileMap(tileMap, writer);
+	}
+
+	writer.EndArray();
+
+	// Add what each tile blocks.
+	writer.Key("tile_blocking_masks");
+	writer.StartObject();
+	writer.Key("width");
+	writer.Uint64(m_TileBlockingMaskWidth);
+	writer.Key("length");
+	writer.Uint64(m_TileBlockingMaskLength);
+	writer.Key("masks");
+	writer.StartArray();
+
+	for (auto tileBlockingMask : m_TileBlockingMasks) {
+		writer.Uint(tileBlockingMask);
 	}
 
-	jsonSceneRoot.AddMember("tile_maps", jsonTileMaps, allocator);
+	writer.EndArray();
+	writer.EndObject();
 
 	// Add actors.
-	rapidjson::Value jsonActors(rapidjson::kArrayType);
+	writer.Key("actors");
+	writer.StartArray();
+
+	m_Actors.ForEachLiveActor([&writer](Actor* pActor) {
+		const auto& resource = pActor->GetResource();
+
+		writer.StartObject();
+		writer.Key("resource");
+		writer.String(resource.c_str(), static_cast<rapidjson::SizeType>(resource.size()));
+		writer.Key("x");
+		writer.Double(pActor->GetPosition().X());
+		writer.Key("y");
+		writer.Double(pActor->GetPosition().Y());
+		writer.Key("elevation");
+		writer.Double(pActor->GetElevation());
+		writer.Key("angle");
+		writer.Double(pActor->GetAngle());
+		writer.EndObject();
+	});
+
+	writer.EndArray();
+
+	writer.EndObject();
+	writer.EndObject();
+}
+
+void SceneGraph::SerializeSnapshot(const std::string& filename) const
+{
+	SceneCapture capture;
+	capture.filename = filename;
+	CaptureScene(capture);
+
+	WriteSceneCapture(capture);
+}
+
+void SceneGraph::SnapshotAsync(const std::string& filename, std::function<void(bool)> onComplete)
+{
+	if (m_IsUpdatingActors) {
+		// The scene is only consistent once the update has finished.
+		std::lock_guard<std::mutex> lock(m_SnapshotMutex);
+		m_SnapshotRequests.emplace_back(filename, std::move(onComplete));
+		return;
+	}
+
+	QueueSnapshot(filename, std::move(onComplete));
+}
+
+void SceneGraph::QueueSnapshot(const std::string& filename, std::function<void(bool)> onComplete)
+{
+	auto pCapture = std::make_unique<SceneCapture>();
+	pCapture->filename = filename;
+	pCapture->onComplete = std::move(onComplete);
+
+	CaptureScene(*pCapture);
+
+	{
+		std::lock_guard<std::mutex> lock(m_SnapshotMutex);
+		m_QueuedSnapshots.push_back(std::move(pCapture));
+	}
+
+	if (!m_SnapshotThread.joinable()) {
+		m_SnapshotThread = std::thread(&SceneGraph::SnapshotThreadMain, this);
+	}
+
+	m_SnapshotsQueued.notify_one();
+}
+
+void SceneGraph::CompleteSnapshots()
+{
+	std::vector<std::unique_ptr<SceneCapture>> writtenSnapshots;
+	{
+		std::lock_guard<std::mutex> lock(m_SnapshotMutex);
+		writtenSnapshots.swap(m_WrittenSnapshots);
+	}
+
+	for (const auto& pCapture : writtenSnapshots) {
+		if (pCapture->onComplete) {
+			pCapture->onComplete(pCapture->isWritten);
+		}
+	}
+}
+
+void SceneGraph::SnapshotThreadMain()
+{
+	std::unique_lock<std::mutex> lock(m_SnapshotMutex);
+
+	while (true) {
+		m_SnapshotsQueued.wait(lock, [this]() { return m_IsShuttingDownSnapshots || !m_QueuedSnapshots.empty(); });
+
+		// Finish writing everything queued before shutting down, so no snapshot is left half written.
+		if (m_QueuedSnapshots.empty()) {
+			return;
+		}
+
+		auto pCapture = std::move(m_QueuedSnapshots.front());
+		m_QueuedSnapshots.pop_front();
+
+		lock.unlock();
+		pCapture->isWritten = WriteSceneCapture(*pCapture);
+
+		// Drop the tile map copies here rather than on the main thread.
+		pCapture->tileMaps.clear();
+		pCapture->pTileBlockingMasks.reset();
+		lock.lock();
+
+		m_WrittenSnapshots.push_back(std::move(pCapture));
+	}
+}
+
+void SceneGraph::CaptureScene(SceneCapture& capture) const
+{
+	// Share the copy of each tile map, only copying the tile maps that may have been edited since the last capture.
+	m_TileMapCopies.resize(m_TileMaps.size());
+
+	for (size_t i = 0; i < m_TileMaps.size(); ++i) {
+		const auto& pCopy = m_TileMapCopies[i];
+
+		// A resize is caught even if it wasn't reported, as it changes the dimensions.
+		if (!pCopy || pCopy->GetWidth() != m_TileMaps[i].GetWidth() || pCopy->GetLength() != m_TileMaps[i].GetLength()) {
+			m_TileMapCopies[i] = std::make_shared<const TileMap>(m_TileMaps[i]);
+		}
+	}
 
-	for (const auto& pActor : m_Actors) {
-		rapidjson::Value jsonActor(rapidjson::kObjectType);
-		rapidjson::Value jsonResource(rapidjson::kStringType);
-		jsonActor.AddMember("resource", pActor->GetResource(), allocator);
-		jsonActor.AddMember("x", pActor->GetPosition().X(), allocator);
-		jsonActor.AddMember("y", pActor->GetPosition().Y(), allocator);
-		jsonActor.AddMember("elevation", pActor->GetElevation(), allocator);
-		jsonActor.AddMember("angle", pActor->GetAngle(), allocator);
+	capture.tileMaps = m_TileMapCopies;
 
-		jsonActors.PushBack(jsonActor, allocator);
+	if (!m_TileBlockingMaskCopy) {
+		m_TileBlockingMaskCopy = std::make_shared<const std::vector<uint32_t>>(m_TileBlockingMasks);
 	}
 
-	jsonSceneRoot.AddMember("actors", jsonActors, allocator);
-	jsonDocument.AddMember("scene", jsonSceneRoot, allocator);
+	capture.pTileBlockingMasks = m_TileBlockingMaskCopy;
+
+	// Intern the resources now, so each distinct resource is only copied once.
+	std::unordered_map<std::string, uint32_t> resourceIndices;
+
+	m_Actors.ForEachLiveActor([&capture, &resourceIndices](Actor* pActor) {
+		const auto& resource = pActor->GetResource();
+
+		auto iter = resourceIndices.find(resource);
+		if (iter == resourceIndices.end()) {
+			iter = resourceIndices.emplace(resource, static_cast<uint32_t>(capture.resources.size())).first;
+			capture.resources.push_back(resource);
+		}
+
+		const auto& position = pActor->GetPosition();
+		capture.actors.push_back({ iter->second, position.X(), position.Y(), pActor->GetElevation(), pActor->GetAngle() });
+	});
+
+	auto& header = capture.header;
+	header = {};
+	header.tileWidth = m_TileWidth;
+	header.tileHeight = m_TileHeight;
+	header.perspective = static_cast<uint32_t>(m_RenderPerspective);
+	header.maxActorsPerCell = m_pSpatialIndex->GetMaxNumActorsPerCell();
+	header.tileBlockingMaskWidth = static_cast<uint32_t>(m_TileBlockingMaskWidth);
+	header.tileBlockingMaskLength = static_cast<uint32_t>(m_TileBlockingMaskLength);
+
+	const auto& boundingBox = m_pSpatialIndex->GetBoundingBox();
+	header.boundingBox[0] = boundingBox.GetX();
+	header.boundingBox[1] = boundingBox.GetY();
+	header.boundingBox[2] = boundingBox.GetWidth();
+	header.boundingBox[3] = boundingBox.GetHeight();
+}
+
+bool SceneGraph::WriteSceneCapture(const SceneCapture& capture)
+{
+	SceneSnapshotWriter writer(capture.filename);
+	if (!writer.IsGood()) {
+		DEBUG_ERROR() << "Failed to serialize scene snapshot. Couldn't open file \'" << capture.filename << "\' for writing.";
+		return false;
+	}
 
-	// Save the document out to file.
+	// Tiles are only exposed through their JSON, so each tile map is written as compact JSON into a buffer reused 
+	// for every tile map. Streamed, so no value of the whole tile map is built if TileMap can write itself.
 	rapidjson::StringBuffer buffer;
-	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
 
-	jsonDocument.Accept(writer);
+	for (const auto& pTileMap : capture.tileMaps) {
+		buffer.Clear();
+		rapidjson::Writer<rapidjson::StringBuffer> jsonWriter(buffer);
+		SerializeTileMap(*pTileMap, jsonWriter);
 
-	std::ofstream ofs(filename);
-	if (ofs.is_open() && !ofs.bad()) {
-		ofs << buffer.GetString();
+		writer.AddTileMap(
+			static_cast<uint32_t>(pTileMap->GetWidth()), static_cast<uint32_t>(pTileMap->GetLength()),
+			buffer.GetString(), buffer.GetSize());
 	}
-	else {
-		DEBUG_ERROR() << "Failed to serialize scene. Couldn't open file \'" << filename << "\' for writing.";
+
+	// Resources are interned in the same order as the capture, so the indices of the actor records carry over.
+	for (const auto& resource : capture.resources) {
+		writer.InternString(resource);
+	}
+
+	for (const auto& actor : capture.actors) {
+		writer.AddActor(actor);
+	}
+
+	writer.SetTileBlockingMasks(capture.pTileBlockingMasks->data(), capture.pTileBlockingMasks->size());
+
+	if (!writer.Finish(capture.header)) {
+		DEBUG_ERROR() << "Failed to serialize scene snapshot. Couldn't write file \'" << capture.filename << "\'.";
+		return false;
+	}
+
+	return true;
+}
+
+size_t SceneGraph::SpawnActors(const SceneSnapshot& snapshot)
+{
+	size_t numSpawned = 0;
+
+	for (size_t i = 0; i < snapshot.GetNumActors(); ++i) {
+		const auto& actor = snapshot.GetActor(i);
+
+		if (SpawnActor(snapshot.GetString(actor.resource), { actor.x, actor.y }, actor.elevation)) {
+			++numSpawned;
+		}
+	}
+
+	return numSpawned;
+}
+
+bool SceneGraph::LoadSnapshot(const SceneSnapshot& snapshot, const TileMapParser& parseTileMap)
+{
+	// Parse first, so a tile map that fails leaves the scene as it was.
+	std::vector<TileMap> tileMaps;
+	if (parseTileMap && !snapshot.ParseTileMaps(parseTileMap, tileMaps)) {
+		return false;
+	}
+
+	const auto& header = snapshot.GetHeader();
+
+	ClearActors();
+
+	if (!tileMaps.empty()) {
+		m_TileMaps.swap(tileMaps);
+
+		// Every cached chunk and snapshot copy was made from the old tile maps.
+		m_TileChunkGrids.clear();
+		m_TileMapCopies.clear();
+
+		const auto& tileMap = m_TileMaps.front();
+		m_BaseBoundingBox = { -0.5f, -0.5f, static_cast<float>(tileMap.GetWidth()), static_cast<float>(tileMap.GetLength()) };
+	}
+
+	SetTileDimensions(header.tileWidth, header.tileHeight);
+	SetRenderPerspective(static_cast<RenderPerspective>(header.perspective));
+
+	ResizeTileBlockingMasks(header.tileBlockingMaskWidth, header.tileBlockingMaskLength);
+	std::copy(snapshot.GetTileBlockingMasks(), snapshot.GetTileBlockingMasks() + m_TileBlockingMasks.size(), m_TileBlockingMasks.begin());
+
+	// Set before resizing, which keeps the maximum of the index it replaces.
+	SetMaxNumActorsPerCell(static_cast<size_t>(header.maxActorsPerCell));
+
+	const Rect<float> wSnapshotBounds = { header.boundingBox[0], header.boundingBox[1], header.boundingBox[2], header.boundingBox[3] };
+	const auto wBoundingBox = Union(m_BaseBoundingBox, wSnapshotBounds);
+	if (!AreBoundsEqual(wBoundingBox, m_pSpatialIndex->GetBoundingBox())) {
+		ResizeSpatialIndex(wBoundingBox);
 	}
+
+	SpawnActors(snapshot);
+
+	return true;
 }
 
 void SceneGraph::SetCameraPosition(const Point<float>& wCameraPosition, float wCameraElevation)
@@ -421,92 +2322,163 @@ void SceneGraph::SetCameraPosition(const Point<float>& wCameraPosition, float wC
 	m_wCameraPosition = wCameraPosition;
 	m_wCameraElevation = wCameraElevation;
 
-	// Update screen camera position.
-	m_sCameraPosition = ToCartesianCoord(wCameraPosition);
-	m_sCameraPosition = { std::floor(m_sCameraPosition.X()), std::floor(m_sCameraPosition.Y()) };
+	UpdateCameraTransform();
+}
+
+void SceneGraph::SetRenderPerspective(RenderPerspective renderPerspective)
+{
+	m_RenderPerspective = renderPerspective;
+
+	UpdateCameraTransform();
+	InvalidateTileChunks();
+}
+
+void SceneGraph::SetZoom(float zoom)
+{
+	m_Zoom = zoom;
+
+	UpdateCameraTransform();
+	InvalidateTileChunks();
 }
 
 void SceneGraph::RenderActor(Actor* pActor) const
 {
-	auto spriteComponents = pActor->GetComponents<SpriteComponent>();
-	auto animationComponents = pActor->GetComponents<AnimationComponent>();
+	const auto handle = m_Actors.GetHandle(pActor);
+
+	// Get the screen position of the actor, which every sprite is placed relative to. With a fixed timestep, the 
+	// actor is drawn between where it was at the previous tick and where it is now.
+	auto wPosition = pActor->GetPosition();
+	auto wElevation = pActor->GetElevation();
+	if (m_FixedTimestep > 0.0f) {
+		GetInterpolatedTransform(pActor, handle, wPosition, wElevation);
+	}
 
-	auto renderComponent = [&pActor, this](SpriteComponent* pSpriteComponent) {
-		if (pSpriteComponent) {
-			// Get the screen position of the actor.
-			auto screenPosition = ToScreenPosition(pActor->GetPosition(), pActor->GetElevation());
+	const auto screenPosition = ToScreenPosition(wPosition, wElevation);
 
-			for (int i = 1; pSpriteComponent; i++) {
-				auto destRect = pSpriteComponent->GetCurrentMask();
-				const auto& feetOffset = pSpriteComponent->GetFeetOffset();
+	size_t order = 0;
 
-				destRect = {
-					static_cast<int>(screenPosition.X() - (feetOffset.X() * m_Zoom)),
-					static_cast<int>(screenPosition.Y() - (feetOffset.Y() * m_Zoom)),
-					static_cast<int>(std::ceil(destRect.GetWidth() * m_Zoom)),
-					static_cast<int>(std::ceil(destRect.GetHeight() * m_Zoom))
-				};
+	auto renderComponent = [&pActor, &handle, &screenPosition, &order, this](SpriteComponent* pSpriteComponent) {
+		const auto& mask = pSpriteComponent->GetCurrentMask();
+		const auto& feetOffset = pSpriteComponent->GetFeetOffset();
 
-				// Render the sprite component.
-				m_RendererRef.RenderSprite(*pSpriteComponent->GetSprite(), destRect, pSpriteComponent->GetCurrentMask());
+		const Rect<> destRect = {
+			static_cast<int>(screenPosition.X() - (feetOffset.X() * m_Zoom)),
+			static_cast<int>(screenPosition.Y() - (feetOffset.Y() * m_Zoom)),
+			static_cast<int>(std::ceil(mask.GetWidth() * m_Zoom)),
+			static_cast<int>(std::ceil(mask.GetHeight() * m_Zoom))
+		};
 
-				// Next sprite component.
-				pSpriteComponent = pActor->GetComponent<SpriteComponent>(i);
-			}
+		// Render the sprite component.
+		const auto& sprite = *pSpriteComponent->GetSprite();
+		if (m_IsQueuingActorSprites) {
+			const auto sortKey = MakeActorSortKey(pActor, sprite, order++);
+			m_ActorBatch.push_back({ sortKey, &sprite, destRect, mask, handle });
+		}
+		else {
+			m_RendererRef.RenderSprite(sprite, destRect, mask);
+			PROFILE_COUNT(m_Profiler, ProfileCounter::SPRITES_SUBMITTED, 1);
+
+			// Record where it was drawn for picking.
+			m_PickBounds.push_back({ destRect, mask, &sprite, handle });
 		}
 	};
 
-	for (auto pSpriteComponent : spriteComponents) {
+	// Each component is rendered exactly once, walked by index rather than through GetComponents(), which would
+	// allocate a list per actor.
+	for (size_t i = 0; auto pSpriteComponent = pActor->GetComponent<SpriteComponent>(i); ++i) {
 		renderComponent(pSpriteComponent);
 	}
 
-	for (auto pSpriteComponent : animationComponents) {
-		renderComponent(pSpriteComponent);
+	for (size_t i = 0; auto pAnimationComponent = pActor->GetComponent<AnimationComponent>(i); ++i) {
+		renderComponent(pAnimationComponent);
 	}
 }
 
-Actor* SceneGraph::AddActor(std::unique_ptr<Actor> pActor)
+Actor* SceneGraph::AddActor(PooledActorPtr<Actor> pActor)
 {
-	auto pActorRef = pActor.get();
+	// The store owns the actor from here on.
+	auto pActorRef = pActor.release();
+
+	if (m_IsUpdatingInParallel) {
+		// Queued without a lock, and added to the spatial index once the parallel update is finished.
+		m_ThreadActorQueues[JobPool::GetCurrentThreadIndex()].newActors.push_back(pActorRef);
+		return pActorRef;
+	}
 
 	if (m_IsUpdatingActors) {
-		m_NewActors.push_back(std::move(pActor));
+		m_NewActors.push_back(pActorRef);
 	}
 	else {
-		m_Actors.push_back(std::move(pActor));
+		m_Actors.SetLive(pActorRef, true);
 	}
 
-	m_QuadTreeRoot.InsertActor(pActorRef);
+	m_pSpatialIndex->InsertActor(pActorRef);
+
+	// Make sure the new actor is clamped to the scene bounds by the next ResolveCollisions().
+	m_MovedActors.push_back(m_Actors.GetHandle(pActorRef));
+
 	return pActorRef;
 }
 
-bool SceneGraph::RemoveActor(Actor* pActor)
+ActorHandle SceneGraph::GetActorHandle(const Actor* pActor) const
 {
-	auto pCell = pActor->GetQuadTreeCell();
-	if (pCell) {
-		return pCell->RemoveActor(pActor);
-	}
-	else {
-		return false;
+	auto spawnLock = LockSpawning();
+	return m_Actors.GetHandle(pActor);
+}
+
+Actor* SceneGraph::GetActor(const ActorHandle& handle) const
+{
+	auto spawnLock = LockSpawning();
+	return m_Actors.GetActor(handle);
+}
+
+bool SceneGraph::IsActorAsleep(const Actor* pActor) const
+{
+	auto spawnLock = LockSpawning();
+	return m_Actors.IsAsleep(m_Actors.GetHandle(pActor));
+}
+
+std::unique_lock<std::mutex> SceneGraph::LockSpawning() const
+{
+	if (m_IsUpdatingInParallel) {
+		return std::unique_lock<std::mutex>(m_SpawnMutex);
 	}
+
+	return std::unique_lock<std::mutex>(m_SpawnMutex, std::defer_lock);
+}
+
+bool SceneGraph::RemoveActor(Actor* pActor)
+{
+	return m_pSpatialIndex->RemoveActor(pActor);
 }
 
 void SceneGraph::DestroyPendingActors()
 {
-	auto pendingDestroy = [](const std::unique_ptr<Actor>& pActor) {
-		return pActor->IsPendingDestroy();
-	};
+	PROFILE_SCOPE(m_Profiler, ProfilePhase::DESTROY_PENDING_ACTORS);
 
-	auto removeFromGraph = [this](const std::unique_ptr<Actor>& pActor) {
-		RemoveActor(pActor.get());
-	};
+	if (m_PendingDestroyActors.empty()) {
+		return;
+	}
+
+	// Group the actors by quad tree cell so each cell is visited in one go. Sorting also makes duplicate
+	// entries for actors queued more than once adjacent.
+	std::sort(m_PendingDestroyActors.begin(), m_PendingDestroyActors.end(), [](const Actor* pLhs, const Actor* pRhs) {
+		const auto pLhsCell = pLhs->GetQuadTreeCell();
+		const auto pRhsCell = pRhs->GetQuadTreeCell();
+
+		if (pLhsCell != pRhsCell) {
+			return std::less<const QuadTreeCell*>()(pLhsCell, pRhsCell);
+		}
+		return std::less<const Actor*>()(pLhs, pRhs);
+	});
 
-	// Partition actors that are pending destruction.
-	auto destroyBegin = std::partition(m_Actors.begin(), m_Actors.end(), pendingDestroy);
+	auto pendingEnd = std::unique(m_PendingDestroyActors.begin(), m_PendingDestroyActors.end());
 
-	// Remove those actors from the graph.
-	std::for_each(destroyBegin, m_Actors.end(), removeFromGraph);
+	std::for_each(m_PendingDestroyActors.begin(), pendingEnd, [this](Actor* pActor) {
+		// Remove the actor from the graph, then from the game.
+		RemoveActor(pActor);
+		m_Actors.Destroy(pActor);
+	});
 
-	// Use erase-remove idiom to remove the actors from the game.
-	m_Actors.erase(destroyBegin, m_Actors.end());
+	m_PendingDestroyActors.clear();
 }
@@ -5,18 +5,46 @@
 #define __SCENEGRAPH_H__
 
 // Library Includes
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 // Local Includes
 #include "Isometric/TileMap.h"
-#include "QuadTreeCell.h"
+#include "SpatialIndex.h"
+#include "ActorIgnoreList.h"
+#include "AffineTransform.h"
+#include "ActorStore.h"
+#include "JobPool.h"
+#include "CollisionWorld.h"
+#include "SpriteHitMask.h"
+#include "SceneSnapshot.h"
+#include "WorldStreamer.h"
+#include "FrameArena.h"
+#include "Profiler.h"
 
 // Forward Declaration
 class ActorFactory;
+class SpriteComponent;
 
 /** List of perspectives to render the scene at.
 @remarks
 	This enum allows the rendering logic to delineate between
 	isometric and oblique rendering modes. 
+@par
+	The hot paths of SceneGraph are specialised per perspective at compile time (e.g. 
+	SceneGraph::ToCartesianCoord<RenderPerspective::ISOMETRIC>()), with the runtime value only
+	dispatched on once per call site. A new perspective is added by providing specialisations of
+	SceneGraph::ToCartesianCoord() and SceneGraph::ToIsometricCoord().
 @todo
 	Could extend this to having steeper angles.
 */
@@ -26,6 +54,65 @@ enum class RenderPerspective {
 };
 
 class SceneGraph {
+	// Member Types
+public:
+	/** Copies the components of a prototype actor onto a new actor of the same resource.
+		@remarks Called as cloneActor(prototype, actor), returning false if the actor couldn't be initialised.
+	*/
+	using ActorCloneFunction = std::function<bool(const Actor&, Actor&)>;
+
+	/** Iterates the tiles of a tile map that are visible on screen, row by row.
+		@remarks
+			The screen position of each tile is derived incrementally from the start of its row using the 
+			screen space step between neighbouring tiles, rather than projecting every tile individually. Only 
+			the columns of a row that overlap the screen are visited.
+		@par
+			The span is only valid for the frame it was created in, as it captures the camera, zoom and 
+			tile dimensions at creation.
+		@code
+			auto visibleTiles = sceneGraph.GetVisibleTiles(tileMap);
+			while (visibleTiles.Next()) {
+				// Use visibleTiles.GetX(), visibleTiles.GetY() and visibleTiles.GetScreenPosition().
+			}
+		@endcode
+	*/
+	class VisibleTileSpan {
+	public:
+		/** Advance to the next visible tile.
+			@return False once every visible tile has been visited.
+		*/
+		bool Next();
+
+		/** Get the x coordinate of the current tile in the tile map. */
+		size_t GetX() const { return m_Column; }
+		/** Get the y coordinate of the current tile in the tile map. */
+		size_t GetY() const { return m_Row; }
+		/** Get the screen position of the top left corner of the current tile. */
+		const Point<float>& GetScreenPosition() const { return m_sPosition; }
+	private:
+		friend class SceneGraph;
+
+		VisibleTileSpan(const SceneGraph& sceneGraph, const TileMap& tileMap, const Point<float>& wOrigin);
+
+		const SceneGraph& m_SceneGraphRef;
+		const TileMap& m_TileMapRef;
+
+		// Screen position of the top left corner of tile (0, 0).
+		Point<float> m_sOrigin;
+		// Screen space step from a tile to its neighbour in the next column.
+		Point<float> m_sColumnStep;
+		// Screen space step from a tile to its neighbour in the next row.
+		Point<float> m_sRowStep;
+		// Screen position of the current tile.
+		Point<float> m_sPosition;
+
+		size_t m_Row = { 0 };
+		size_t m_NextRow = { 0 };
+		size_t m_EndRow = { 0 };
+		size_t m_Column = { 0 };
+		size_t m_EndColumn = { 0 };
+	};
+
 	// Member Functions
 public:
 	/** Default constructor.
@@ -35,22 +122,114 @@ public:
 		@param maxActorsPerCell The maximum amount of actors allowed in a single cell before the cell subdivides.
 		@param tileWidth The width of a single tile.
 		@param tileHeight The height or length of a single tile.
+		@param broadphase How potentially colliding actors are found when resolving collisions.
+		@param spatialIndex The structure actors are stored in for queries, collisions and render ordering. A 
+			UNIFORM_GRID has cells of s_GridCellSizeInTiles * s_GridCellSizeInTiles tiles. Only a UNIFORM_GRID 
+			speeds up region queries, see QueryAABB().
 	*/
 	SceneGraph(
 		ActorFactory& actorFactory, Renderer& renderer, 
 		const TileMap& tileMap, 
 		size_t maxActorsPerCell,
-		int tileWidth, int tileHeight);
+		int tileWidth, int tileHeight,
+		CollisionBroadphase broadphase = CollisionBroadphase::SPATIAL_INDEX,
+		SpatialIndexType spatialIndex = SpatialIndexType::QUAD_TREE);
 	
-	/** Destructor. */
-	~SceneGraph() = default;
+	/** Destructor. Waits for any snapshots still being written by SnapshotAsync(). */
+	~SceneGraph();
 
-	/** Update the entire scene. */
+	/** Update the entire scene.
+		@remarks Sleeping actors aren't updated, and distant actors only some updates, see SetActivityRadius().
+	*/
 	void Update(float deltaTime);
 
-	/** Resolve the collisions of all actors in the scene. */
+	/** Set the number of threads actors are updated on.
+		@remarks
+			With more than one thread, Update() shards the live actors across a work stealing job pool. Actors 
+			spawned during a parallel update are constructed under a lock, as the actor factory isn't thread safe, 
+			but are queued per thread and only added to the spatial index once every actor has been updated. 
+			GetActor(), GetActorHandle() and IsActorAsleep() take the same lock, as creating an actor may grow 
+			the store they read.
+		@par
+			Actor::Update() must then only modify the actor itself, and mustn't read any other actor, as other 
+			actors may be being updated on other threads at the same time. That includes scene queries such as 
+			raycasts and region queries, which read the position and colliders of every actor they test.
+		@par
+			Must not be called during an update. Frame arenas are only ever added, never moved or removed, so 
+			anything already allocated from GetFrameArena() stays valid.
+		@param numThreads The number of threads including the calling thread. 1 updates actors serially.
+	*/
+	void SetNumUpdateThreads(size_t numThreads);
+
+	/** Get the number of threads actors are updated on. */
+	size_t GetNumUpdateThreads() const { return m_pUpdateJobPool ? m_pUpdateJobPool->GetNumThreads() : 1; }
+
+	/** Get the frame arena of the calling thread, for memory that only needs to last until the next Update().
+		@remarks 
+			Each update thread has its own arena, reset at the start of Update(). Outside of an update, the 
+			arena of the thread calling Update() is returned. @see FrameVector.
+		@note 
+			As the arenas are only reset by Update(), anything allocated from them while the scene isn't being 
+			updated, e.g. while paused, accumulates until the next Update(). The scene graph's own queries only 
+			use the arenas through the overloads taking one.
+		@note
+			Only Raycast() has an overload taking an arena. ResolveCollisions(), PickActor() and RenderActor() 
+			reuse buffers kept by the scene graph instead, and the QUAD_TREE spatial index allocates inside 
+			QuadTreeCell for every raycast, so frames aren't guaranteed to be free of heap allocations. Check 
+			with GetNumHeapAllocationsLastFrame().
+	*/
+	FrameArena& GetFrameArena();
+
+	/** Get the number of heap allocations made on any thread between the starts of the last two Update() calls.
+		@remarks Always 0 unless built with BANANAFIGHTER_COUNT_HEAP_ALLOCATIONS. @see HeapAllocationCounter.
+	*/
+	size_t GetNumHeapAllocationsLastFrame() const { return m_NumHeapAllocationsLastFrame; }
+
+	/** Get the profiler timing the phases of the scene graph and keeping its per frame counters.
+		@remarks 
+			A frame runs from the start of one Update() to the start of the next. Only records anything when built 
+			with BANANAFIGHTER_ENABLE_PROFILER. The spatial index counters describe the index at the start of the 
+			frame, and are only refreshed every s_SpatialIndexStatsInterval frames. @see Profiler.
+	*/
+	Profiler& GetProfiler() { return m_Profiler; }
+	const Profiler& GetProfiler() const { return m_Profiler; }
+
+	/** Resolve the collisions of all actors in the scene.
+		@remarks
+			Only actors that moved since the last call are clamped to the scene bounds and relocated in the quad 
+			tree, before collisions are resolved by the broadphase chosen at construction.
+	*/
 	void ResolveCollisions();
 
+	/** Set the duration of a fixed simulation tick for Advance().
+		@remarks
+			With a fixed timestep, Advance() runs Update() and ResolveCollisions() at a steady tick rate no matter
+			the frame rate, and RenderActor() draws each actor between where it was at the previous tick and the
+			current one, so motion stays smooth when frames and ticks don't line up.
+		@param tickDuration The time simulated by each tick, e.g. 1 / 60. 0 disables the fixed timestep, so 
+			actors are drawn where they are.
+	*/
+	void SetFixedTimestep(float tickDuration);
+	/** Get the duration of a fixed simulation tick, or 0 if there is no fixed timestep. */
+	float GetFixedTimestep() const { return m_FixedTimestep; }
+
+	/** Advance the simulation by the time since the last frame, in fixed ticks.
+		@remarks 
+			Time left over that doesn't fill a tick is carried over to the next call. At most s_MaxTicksPerAdvance 
+			ticks are run per call, and any time past that is dropped, so a long stall can't lead to a spiral of 
+			ever longer frames. Without a fixed timestep, runs a single Update() and ResolveCollisions() by the 
+			frame time instead.
+		@param frameTime The time since the last call.
+		@return The number of ticks run.
+	*/
+	size_t Advance(float frameTime);
+
+	/** Get how far between the previous tick and the next the display is, from 0 to 1. */
+	float GetInterpolationAlpha() const { return m_InterpolationAlpha; }
+
+	/** Get the collision world used by the SORT_AND_SWEEP broadphase, e.g. to set contact callbacks. */
+	CollisionWorld& GetCollisionWorld() { return m_CollisionWorld; }
+
 	/** Render the entire scene. */
 	void Render();
 
@@ -60,9 +239,88 @@ public:
 	/** Render the tiles maps of the scene. */
 	void RenderTileMaps();
 
-	/** Render a specific actor. */
+	/** Render a specific actor.
+		@remarks 
+			The screen space bounds of each sprite drawn are recorded for PickActor(). When actor batching is 
+			enabled and the actor is visited by RenderActors(), the sprites are only queued, and are drawn by the 
+			end of RenderActors(). Otherwise they are drawn straight away.
+	*/
 	void RenderActor(Actor* pActor) const;
 
+	/** Get an iterator over the tiles of a tile map that are visible on screen.
+		@param tileMap The tile map to iterate, which must outlive the returned span.
+		@param wOrigin The world space centre of tile (0, 0), which is the world origin for the base tile maps.
+	*/
+	VisibleTileSpan GetVisibleTiles(const TileMap& tileMap, const Point<float>& wOrigin = Point<float>()) const { return VisibleTileSpan(*this, tileMap, wOrigin); }
+
+	/** Enable or disable batched tile submission.
+		@remarks
+			When enabled, RenderTileMaps() collects every visible tile quad of a tile map into a buffer and 
+			submits them grouped by sprite atlas for each tile layer. When disabled, each tile is rendered 
+			immediately as it is visited.
+	*/
+	void SetTileBatchingEnabled(bool isEnabled) { m_IsTileBatchingEnabled = isEnabled; }
+	/** Get whether batched tile submission is enabled. */
+	bool IsTileBatchingEnabled() const { return m_IsTileBatchingEnabled; }
+
+	/** Enable or disable batched actor submission.
+		@remarks
+			When enabled, RenderActors() queues a draw command for each sprite with a key ordering it by depth, 
+			elevation, sprite layer and then sprite atlas, sorts the commands once and submits them, so actors are 
+			drawn back to front whatever order the spatial index visits them in. Only sprites sharing an atlas at 
+			the same depth, e.g. props placed on tile centres, are submitted back to back, unless a depth band is 
+			set with SetActorBatchDepthBand(). When disabled, each sprite is rendered immediately in the order the 
+			spatial index visits the actors. A RenderActor() from outside RenderActors() is always rendered 
+			immediately.
+	*/
+	void SetActorBatchingEnabled(bool isEnabled) { m_IsActorBatchingEnabled = isEnabled; }
+	/** Get whether batched actor submission is enabled. */
+	bool IsActorBatchingEnabled() const { return m_IsActorBatchingEnabled; }
+
+	/** Set the depth range within which batched actor sprites are grouped by atlas rather than drawn by depth.
+		@remarks
+			Within each band of depth, sprites are drawn layer by layer, and within each layer atlas by atlas, 
+			before depth and elevation. Wider bands submit more sprites of an atlas back to back, but sprites of 
+			different atlases within a band may be drawn out of depth order, so the band should be narrower than 
+			actors overlap by, e.g. a fraction of a tile. 0, the default, orders strictly by depth.
+		@param depthBand The width of a band in world units along the view.
+	*/
+	void SetActorBatchDepthBand(float depthBand) { m_ActorBatchDepthBand = std::max(depthBand, 0.0f); }
+	/** Get the depth range within which batched actor sprites are grouped by atlas. */
+	float GetActorBatchDepthBand() const { return m_ActorBatchDepthBand; }
+
+	/** Enable or disable cached tile map chunks.
+		@remarks
+			When enabled, each tile map is split into chunks of s_TileChunkSize * s_TileChunkSize tiles. The 
+			screen space quads of a chunk are built once and only rebuilt when the chunk is invalidated, so panning 
+			the camera is just a translation of the cached quads. Each tile's sprite and mask are still read when 
+			drawn, so animated tiles are kept up to date.
+		@par
+			Editing a tile map through GetTileMap() doesn't invalidate anything, so the edited tiles must be passed 
+			to InvalidateTileChunks() afterwards. Resizing a tile map rebuilds its chunks on the next render.
+	*/
+	void SetTileChunkCachingEnabled(bool isEnabled) { m_IsTileChunkCachingEnabled = isEnabled; }
+	/** Get whether cached tile map chunks are enabled. */
+	bool IsTileChunkCachingEnabled() const { return m_IsTileChunkCachingEnabled; }
+
+	/** Mark the cached chunk containing a tile as needing to be rebuilt.
+		@remarks Also marks the tile map as edited, so the next snapshot copies it again, see SnapshotAsync().
+		@param index Index or layer of tile maps.
+		@param x The x coordinate of the tile in the tile map.
+		@param y The y coordinate of the tile in the tile map.
+	*/
+	void InvalidateTileChunk(size_t index, size_t x, size_t y);
+
+	/** Mark the cached chunks overlapping a block of tiles as needing to be rebuilt, e.g. after editing the tiles.
+		@remarks Also marks the tile map as edited, so the next snapshot copies it again, see SnapshotAsync().
+		@param index Index or layer of tile maps.
+		@param tileRect The x and y coordinates of the first tile, and the width and length in tiles, of the block.
+	*/
+	void InvalidateTileChunks(size_t index, const Rect<>& tileRect);
+
+	/** Mark every cached chunk of every tile map as needing to be rebuilt. */
+	void InvalidateTileChunks();
+
 	/** Spawn an actor of a specified actor type.
 		@param args Arguments to be forwarded to the constructor of the actor.
 		@return Pointer to the newly created actor.
@@ -82,6 +340,123 @@ public:
 	*/
 	Actor* SpawnActor(const std::string& actorXmlFilename, const Point<float>& position, float elevation);
 
+	/** Spawn many actors of the same resource at once.
+		@remarks 
+			Cheaper than spawning the actors one by one, as the spawn lock is only taken once and room for every 
+			actor is made up front, e.g. for a wave of enemies.
+		@param actorXmlFilename The filename and path of the xml resource.
+		@param pPositions The position of each actor.
+		@param count The number of actors to spawn.
+		@param elevation The elevation of every actor.
+		@param[out] pSpawnedActors Receives each actor spawned, or null for any actor that failed to spawn. May be null.
+		@return The number of actors spawned.
+	*/
+	size_t SpawnActors(const std::string& actorXmlFilename, const Point<float>* pPositions, size_t count, float elevation = 0.0f, Actor** pSpawnedActors = nullptr);
+
+	/** Spawn actors from their resource by cloning a prototype of it, so each resource is only parsed once.
+		@remarks
+			The first actor of a resource, or PreloadActorPrototypes(), initialises a prototype of it through the 
+			actor factory, and every actor of that resource is then spawned as a clone of it. Prototypes are 
+			created with this scene but never added to it, so they're never updated, drawn or found by queries. 
+			A resource that fails to initialise is remembered, and its spawns fail without parsing it again.
+		@par
+			Components can't be copied generically, so copying them is left to the game. Only actors spawned 
+			by filename are cloned, SpawnActor<ActorType>() always goes through the actor factory.
+		@param cloneActor Copies a prototype onto a new actor, or empty to initialise every actor through the 
+			actor factory, which is the default. Must be safe to call from the update threads.
+	*/
+	void SetActorCloneFunction(ActorCloneFunction cloneActor) { m_CloneActor = std::move(cloneActor); }
+
+	/** Initialise the prototypes of actor resources on a background thread, before they're spawned.
+		@remarks 
+			For parsing the resources of a level while it loads. The actor factory is only ever called by one 
+			thread at a time, so a spawn that needs the factory waits for the prototype being initialised.
+		@note
+			Prototypes are only spawned from once a clone function is set, see SetActorCloneFunction(). Without 
+			one every actor is initialised through the actor factory, and preloading only wastes the parsing.
+		@param actorXmlFilenames The filenames and paths of the xml resources.
+		@param onComplete Called with the number of prototypes initialised successfully, from the end of the 
+			first Update() after the last is done. Not called if the scene is destroyed first.
+	*/
+	void PreloadActorPrototypes(std::vector<std::string> actorXmlFilenames, std::function<void(size_t)> onComplete = {});
+
+	/** Destroy every actor prototype, e.g. after a resource has been changed.
+		@remarks 
+			Waits for every preload queued by PreloadActorPrototypes() to finish first, so none of them recreates 
+			a prototype from the old resource afterwards. Must not be called while actors are being spawned.
+	*/
+	void ClearActorPrototypes();
+
+	/** Get a stable handle to an actor in the scene.
+		@remarks Unlike the actor pointer, the handle may be kept after the actor is destroyed. @see GetActor().
+		@return The actor's handle, or a null handle if the actor isn't in the scene.
+	*/
+	ActorHandle GetActorHandle(const Actor* pActor) const;
+
+	/** Get the actor a handle refers to.
+		@return Pointer to the actor, or null if the actor has been destroyed.
+	*/
+	Actor* GetActor(const ActorHandle& handle) const;
+
+	/** Queue an actor that has been flagged as pending destroy for destruction at the end of the update.
+		@remarks
+			Actors are also queued when they are found to be pending destroy during the update, whether or not
+			they were updated that frame, as sleeping and distant actors are still checked. Calling this is only
+			required for the actor to be destroyed in the same frame it was flagged in. Queuing an actor more
+			than once is harmless.
+	*/
+	void NotifyActorPendingDestroy(Actor* pActor);
+
+	/** Destroy actors straight away, rather than at the end of the next update.
+		@remarks Must not be called during Update(). Handles of actors already destroyed are skipped.
+		@param pHandles The handles of the actors to destroy.
+		@param count The number of handles.
+	*/
+	void DestroyActors(const ActorHandle* pHandles, size_t count);
+
+	/** Queue an actor that has moved to be relocated in the spatial index by the next ResolveCollisions().
+		@remarks
+			Actors that move during their own update are queued automatically, so this is only required when an 
+			actor is moved from elsewhere, e.g. by another actor.
+	*/
+	void NotifyActorMoved(Actor* pActor);
+
+	/** Put an actor to sleep, e.g. once it is idle.
+		@remarks
+			A sleeping actor isn't updated. It stays in the spatial index, so it is still drawn and can still be 
+			hit. It is woken by WakeActor(), by being pushed by a collision, by being hit by a raycast or picked, 
+			or by being passed to NotifyActorMoved().
+		@par
+			Pairs of sleeping actors aren't tested for collisions, whichever broadphase and spatial index the 
+			scene uses, as collisions are always resolved through the collision world.
+		@par
+			Safe to call from Actor::Update() during a parallel update, in which case the actor is put to sleep 
+			once every actor has been updated.
+	*/
+	void SleepActor(Actor* pActor);
+
+	/** Wake a sleeping actor so it is updated again from the next Update(). Does nothing if it is awake. */
+	void WakeActor(Actor* pActor);
+
+	/** Get whether an actor is asleep. */
+	bool IsActorAsleep(const Actor* pActor) const;
+
+	/** Set the distance from the camera beyond which actors are updated less often.
+		@remarks 
+			Awake actors further than the radius from the camera position are only updated once every 
+			distantUpdateInterval updates, by the total time since they were last updated. Which update that is 
+			depends on the actor, so the distant actors are spread evenly over the updates.
+		@param radius The world space radius around the camera. 0 updates every awake actor every update.
+		@param distantUpdateInterval The number of updates per update of a distant actor.
+	*/
+	void SetActivityRadius(float radius, size_t distantUpdateInterval = s_DefaultDistantUpdateInterval);
+
+	/** Get the distance from the camera beyond which actors are updated less often, or 0 if they never are. */
+	float GetActivityRadius() const { return m_ActivityRadius; }
+
+	/** Get the number of updates per update of an actor outside the activity radius. */
+	size_t GetDistantUpdateInterval() const { return m_DistantUpdateInterval; }
+
 	/** Destroy all actors and remove them from the scene.
 		@note Any pointer referring to any actors in the scene will become a dangling pointer if not set to null.
 	*/
@@ -93,9 +468,10 @@ public:
 		@param origin The start of the line segment making up the ray.
 		@param end The end of the line segment making up the ray.
 	 	@param actorsToIgnore List of actors to ignore in the query.
+		@param tileBlockingMask Tiles sharing a bit of their blocking mask with this mask stop the ray. 0 ignores tiles.
 	 	@return Pointer to the first hit actor of the cast or null if there were no actors in the path of the ray.
 	*/
-	Actor* RaycastFirstHit(const Point<float>& origin, const Point<float>& end, const std::vector<Actor*>& actorsToIgnore);
+	Actor* RaycastFirstHit(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, uint32_t tileBlockingMask = 0);
 
 	/** Perform a raycast query and return the first hit actor.
 	 	@param origin The start of the line segment making up the ray.
@@ -104,7 +480,7 @@ public:
 	 	@param actorsToIgnore List of actors to ignore in the query.
 	 	@return Pointer to the first hit actor of the cast or null if there were no actors in the path of the ray.
 	*/
-	Actor* RaycastFirstHit(const Point<float>& origin, const Point<float>& direction, float distance, const std::vector<Actor*>& actorsToIgnore);
+	Actor* RaycastFirstHit(const Point<float>& origin, const Point<float>& direction, float distance, const ActorIgnoreList& actorsToIgnore);
 
 	/** Perform a raycast query and return an ordered list of all hit actors.
 		@param origin The start of the line segment making up the ray.
@@ -112,7 +488,7 @@ public:
 		@param actorsToIgnore List of actors to ignore in the query.
 	 	@return Ordered list of all hit actors from first obscuring to last obscuring.
 	*/
-	std::vector<Actor*> Raycast(const Point<float>& origin, const Point<float>& end, const std::vector<Actor*>& actorsToIgnore);
+	std::vector<Actor*> Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore);
 
 	/** Perform a raycast query and return an ordered list of all hit actors.
 		@param origin The start of the line segment making up the ray.
@@ -121,20 +497,180 @@ public:
 		@param actorsToIgnore List of actors to ignore in the query.
 	 	@return Ordered list of all hit actors from first obscuring to last obscuring.
 	*/
-	std::vector<Actor*> Raycast(const Point<float>& origin, const Point<float>& direction, float distance, const std::vector<Actor*>& actorsToIgnore);
+	std::vector<Actor*> Raycast(const Point<float>& origin, const Point<float>& direction, float distance, const ActorIgnoreList& actorsToIgnore);
+
+	/** Perform a raycast query into a caller provided list of all hit actors.
+		@remarks Reusing the same list between calls avoids allocating a new list for every query.
+		@param origin The start of the line segment making up the ray.
+		@param end The end of the line segment making up the ray.
+		@param actorsHit Cleared, then filled with all hit actors from first obscuring to last obscuring.
+		@param actorsToIgnore List of actors to ignore in the query.
+		@param tileBlockingMask Tiles sharing a bit of their blocking mask with this mask stop the ray. 0 ignores tiles.
+	*/
+	void Raycast(
+		const Point<float>& origin, const Point<float>& end, 
+		std::vector<Actor*>& actorsHit, 
+		const ActorIgnoreList& actorsToIgnore = {}, 
+		uint32_t tileBlockingMask = 0);
+
+	/** Perform a raycast query and return an ordered list of all hit actors allocated from a frame arena.
+		@remarks 
+			The spatial index writes the hits straight into the list. The list is only valid until the arena is 
+			next reset, e.g. GetFrameArena() at the next Update().
+		@param origin The start of the line segment making up the ray.
+		@param end The end of the line segment making up the ray.
+		@param arena The arena to allocate the list from.
+		@param actorsToIgnore List of actors to ignore in the query.
+		@param tileBlockingMask Tiles sharing a bit of their blocking mask with this mask stop the ray. 0 ignores tiles.
+	 	@return Ordered list of all hit actors from first obscuring to last obscuring.
+	*/
+	FrameVector<Actor*> Raycast(
+		const Point<float>& origin, const Point<float>& end, 
+		FrameArena& arena, 
+		const ActorIgnoreList& actorsToIgnore = {}, 
+		uint32_t tileBlockingMask = 0);
+
+	/** Perform a batch of raycast queries and return the first hit actor of each.
+		@remarks
+			Cheaper than a RaycastFirstHit() per ray, e.g. for the line of sight checks of many actors at once. 
+			The rays are cast in an order that keeps neighbouring rays together, and are split across the update 
+			job pool when there is more than one update thread (see SetNumUpdateThreads()).
+		@param pOrigins The start of the line segment of each ray.
+		@param pEnds The end of the line segment of each ray.
+		@param count The number of rays.
+		@param pHits Receives the first hit actor of each ray, or null if there were no actors in its path.
+		@param pCasters Optional actor for each ray that the ray can't hit, e.g. the actor looking, or null.
+		@param actorsToIgnore List of actors to ignore for every ray.
+		@param tileBlockingMask Tiles sharing a bit of their blocking mask with this mask stop the rays. 0 ignores tiles.
+	*/
+	void RaycastFirstHits(
+		const Point<float>* pOrigins, const Point<float>* pEnds, size_t count,
+		Actor** pHits,
+		Actor* const* pCasters = nullptr,
+		const ActorIgnoreList& actorsToIgnore = {},
+		uint32_t tileBlockingMask = 0);
+
+	/** Perform a raycast query against the blocking tiles of the scene only.
+		@param origin The start of the line segment making up the ray.
+		@param end The end of the line segment making up the ray.
+		@param blockingMask Tiles sharing a bit of their blocking mask with this mask stop the ray.
+		@param pHitPosition Receives the world position the ray enters the first blocking tile at, if not null.
+		@return True if the ray was stopped by a tile.
+	*/
+	bool RaycastTiles(const Point<float>& origin, const Point<float>& end, uint32_t blockingMask, Point<float>* pHitPosition = nullptr) const;
+
+	/** Set what a tile of the scene blocks.
+		@remarks
+			Static geometry such as walls can block raycasts through its tiles rather than through collision 
+			actors, which keeps it out of the spatial index. Tiles are walked directly along each ray, stopping at
+			the first blocking tile.
+		@param x The x coordinate of the tile in the base tile map.
+		@param y The y coordinate of the tile in the base tile map.
+		@param blockingMask Bits for each kind of raycast the tile blocks, e.g. sight or projectiles. 0 blocks nothing.
+		@note 
+			The masks are kept at the dimensions the base tile map had when they were last set. If the base tile 
+			map has been resized through GetTileMap() since, they are resized to match, keeping the masks of the 
+			tiles in both.
+	*/
+	void SetTileBlockingMask(size_t x, size_t y, uint32_t blockingMask);
+
+	/** Get what a tile of the scene blocks, or 0 for positions outside the tile blocking masks. */
+	uint32_t GetTileBlockingMask(size_t x, size_t y) const;
+
+	/** Get the width of the tile blocking masks, in tiles. */
+	size_t GetTileBlockingMaskWidth() const { return m_TileBlockingMaskWidth; }
+
+	/** Get the length of the tile blocking masks, in tiles. */
+	size_t GetTileBlockingMaskLength() const { return m_TileBlockingMaskLength; }
 
 	/** Pick an actor from a screen space position.
+		@remarks
+			Picks against the sprites drawn by the last RenderActors(), front to back, so the whole drawn area of 
+			a sprite can be picked and the topmost sprite wins. Until actors have been rendered, the collision 
+			boxes under the position are picked against instead.
 	 	@param sPosition The position in screen space to pick from.
 	 	@return Actor* The first found actor at the screen position or null if no actor.
 	*/
 	Actor* PickActor(const Point<>& sPosition);
 
+	/** Enable or disable per pixel picking.
+		@remarks 
+			When enabled, PickActor() skips the pixels of a sprite that are transparent in the hit mask set for 
+			the sprite. Sprites without a hit mask are picked by their bounds alone.
+	*/
+	void SetPickAlphaTestingEnabled(bool isEnabled) { m_IsPickAlphaTestingEnabled = isEnabled; }
+	/** Get whether per pixel picking is enabled. */
+	bool IsPickAlphaTestingEnabled() const { return m_IsPickAlphaTestingEnabled; }
+
+	/** Set the opaque pixels of a sprite's image for per pixel picking.
+		@param sprite The sprite, which the hit mask is kept for until removed.
+		@param hitMask The hit mask covering the whole image of the sprite.
+	*/
+	void SetSpriteHitMask(const Sprite& sprite, SpriteHitMask hitMask) { m_SpriteHitMasks[&sprite] = std::move(hitMask); }
+
+	/** Remove the hit mask of a sprite, e.g. before the sprite is destroyed. */
+	void RemoveSpriteHitMask(const Sprite& sprite) { m_SpriteHitMasks.erase(&sprite); }
+
+	// Region Queries
+
+	/** Visit every actor whose position is within a world space box.
+		@remarks 
+			Nothing is allocated and, with a uniform grid, only the cells overlapping the box are visited. 
+			The visitor mustn't spawn, move or destroy actors from within the query.
+		@note
+			With the QUAD_TREE spatial index, the default, every actor in the scene is tested however small 
+			the box, so region queries are no faster than looping over every actor, see 
+			QuadTreeIndex::QueryAABB(). Construct the scene graph with SpatialIndexType::UNIFORM_GRID if it 
+			is queried often.
+		@code
+			sceneGraph.QueryAABB<Enemy, HealthComponent>(wBox, [](Enemy* pEnemy) {
+				// Only called for enemies with a health component.
+				return true;
+			});
+		@endcode
+		@tparam ActorType Only visit actors of this type or a type derived from it.
+		@tparam RequiredComponents Only visit actors with a component of each of these types.
+		@param wBox The box in world space.
+		@param visitor Called with each actor as an ActorType*, returning false to stop the query.
+	*/
+	template<typename ActorType = Actor, typename... RequiredComponents, typename Visitor>
+	void QueryAABB(const Rect<float>& wBox, Visitor&& visitor);
+
+	/** Visit every actor whose position is within a world space distance of a position.
+		@copydetails QueryAABB()
+	*/
+	template<typename ActorType = Actor, typename... RequiredComponents, typename Visitor>
+	void QueryRadius(const Point<float>& wCentre, float radius, Visitor&& visitor);
+
+	/** Visit every actor whose position is drawn within a screen space rectangle, e.g. for drag selection.
+		@copydetails QueryAABB()
+	*/
+	template<typename ActorType = Actor, typename... RequiredComponents, typename Visitor>
+	void QueryScreenRect(const Rect<>& sRect, Visitor&& visitor);
+
+	/** Find the actors closest to a world space position.
+		@remarks 
+			Searches a radius around the position that doubles until enough actors are found, so the actors 
+			far away are never visited when there are enough nearby. As the quad tree tests every actor for each 
+			region query, it's searched once out to the maximum radius instead.
+		@tparam ActorType Only find actors of this type or a type derived from it.
+		@tparam RequiredComponents Only find actors with a component of each of these types.
+		@param wPosition The position in world space.
+		@param k The most actors to find.
+		@param pNearest Receives up to k actors, closest first.
+		@param maxRadius Actors further than this from the position aren't found.
+		@return The number of actors written to pNearest.
+	*/
+	template<typename ActorType = Actor, typename... RequiredComponents>
+	size_t QueryNearest(const Point<float>& wPosition, size_t k, ActorType** pNearest, float maxRadius = std::numeric_limits<float>::infinity());
+
 	// Space Conversion Helpers
 
 	/** Converts a world position to a position on the screen.
 		@remarks
 			This function takes into account the camera position and zoom amount, thus will return the true 
-			screen coordinate corresponding to the world position.
+			screen coordinate corresponding to the world position. It is a single multiply with the cached 
+			world to screen transform.
 	 	@param wPosition The position in world space to convert.
 	 	@param wElevation The elevation of the position in world space.
 		@todo Currently wElevation has not effect in this function.
@@ -145,12 +681,52 @@ public:
 	/** Converts a position on the screen to position in world space.
 		@remarks
 			This function takes into account the camera position and zoom amount, thus will return the true
-			world position corresponding to the screen position.
+			world position corresponding to the screen position. It is a single multiply with the cached 
+			screen to world transform.
 		@param sPosition The position in screen space to convert.
 		@return The exact position in the world where the screen coordinate projects back to.
 	*/
 	Point<float> ToWorldPosition(const Point<>& sPosition) const;
 
+	/** Converts a batch of world positions to positions on the screen.
+		@remarks
+			Equivalent to calling ToScreenPosition() on every position, but the render perspective, camera and 
+			zoom are only resolved once for the whole batch and the conversion is vectorised. Positions are 
+			given as separate x and y arrays. The output arrays may alias the input arrays.
+		@param pWX Array of world space x coordinates.
+		@param pWY Array of world space y coordinates.
+		@param[out] pSX Array receiving the screen space x coordinates.
+		@param[out] pSY Array receiving the screen space y coordinates.
+		@param count The number of positions in each array.
+	*/
+	void ToScreenPositions(const float* pWX, const float* pWY, float* pSX, float* pSY, size_t count) const;
+
+	/** Converts a batch of positions on the screen to positions in world space.
+		@remarks
+			Equivalent to calling ToWorldPosition() on every position, but the render perspective, camera and 
+			zoom are only resolved once for the whole batch and the conversion is vectorised. Positions are 
+			given as separate x and y arrays. The output arrays may alias the input arrays.
+		@param pSX Array of screen space x coordinates.
+		@param pSY Array of screen space y coordinates.
+		@param[out] pWX Array receiving the world space x coordinates.
+		@param[out] pWY Array receiving the world space y coordinates.
+		@param count The number of positions in each array.
+	*/
+	void ToWorldPositions(const float* pSX, const float* pSY, float* pWX, float* pWY, size_t count) const;
+
+	/** Get the cached affine transform from world space to screen space for the current camera, zoom and perspective. */
+	const AffineTransform& GetWorldToScreenTransform() const { return m_WorldToScreenTransform; }
+
+	/** Get the cached affine transform from screen space to world space for the current camera, zoom and perspective. */
+	const AffineTransform& GetScreenToWorldTransform() const { return m_ScreenToWorldTransform; }
+
+	/** Get the version of the camera transform.
+		@remarks
+			Incremented every time the camera position, zoom, tile dimensions, render perspective or screen size 
+			changes. Caches depending on the camera can compare against it to cheaply detect a change.
+	*/
+	uint32_t GetCameraVersion() const { return m_CameraVersion; }
+
 	/** Converts a coordinate from isometric (or oblique) space to cartesian.
 		@remarks
 			This function only takes into account the render perspective. It performs a simple conversion from
@@ -164,6 +740,13 @@ public:
 	*/
 	Point<float> ToCartesianCoord(const Point<float>& isometricCoord) const;
 
+	/** Converts a coordinate from isometric (or oblique) space to cartesian for a render perspective known at compile time.
+		@remarks Specialised for each RenderPerspective, so calls compile down to the conversion without branching.
+		@param isometricCoord The isometric (or oblique) coordinate to convert to cartesian.
+	*/
+	template<RenderPerspective Perspective>
+	Point<float> ToCartesianCoord(const Point<float>& isometricCoord) const;
+
 	/** Convert a coordinate from cartesian space to isometric (or oblique) space.
 		@remarks
 			This function only takes into account the render perspective. It performs a simple conversion from 
@@ -177,24 +760,119 @@ public:
 	*/
 	Point<float> ToIsometricCoord(const Point<>& cartesianCoord) const;
 
+	/** Convert a coordinate from cartesian space to isometric (or oblique) space for a render perspective known at compile time.
+		@remarks Specialised for each RenderPerspective, so calls compile down to the conversion without branching.
+		@param cartesianPosition The cartesian coordinate to convert to isometric (or oblique).
+	*/
+	template<RenderPerspective Perspective>
+	Point<float> ToIsometricCoord(const Point<>& cartesianCoord) const;
+
 	// Serialization
 
 	/** Serialize the scene out to a file.
+		@remarks 
+			The JSON is written straight to the file as it's generated, without building a document first. Tile 
+			maps are streamed too if TileMap provides a template<typename Writer> void Serialize(Writer&) const, 
+			otherwise a single tile map is held as a value at once.
 	 	@param filename Name and path to the file to be written to.
+		@param isPretty Whether to indent the JSON for reading, or write it as compactly as possible.
+	*/
+	void Serialize(const std::string& filename, bool isPretty = true) const;
+
+	/** Serialize the scene out to a binary snapshot file.
+		@remarks
+			Much faster to write and read than Serialize(), as actors are written as a packed table with their 
+			resources interned, and only a single tile map is held as JSON at once. Serialize() is still the 
+			format to use for anything that edits scenes by hand. @see SceneSnapshot.
+	 	@param filename Name and path to the file to be written to.
+	*/
+	void SerializeSnapshot(const std::string& filename) const;
+
+	/** Write the scene to a binary snapshot file in the background.
+		@remarks
+			The scene is captured straight away, or at the end of Update() if called during an update, after 
+			which the snapshot is encoded and written on a background thread. Capturing copies each actor's 
+			transform and resource, and shares an immutable copy of each tile map, which is only copied again 
+			once the tile map has been reported as edited through InvalidateTileChunks() or InvalidateTileChunk(), 
+			or has been resized. Edits that aren't reported are left out of snapshots until the next one that is.
+		@param filename Name and path to the file to be written to.
+		@param onComplete Called with whether the snapshot was written successfully, from the end of the first 
+			Update() after the write finishes. Not called if the scene is destroyed first.
+	*/
+	void SnapshotAsync(const std::string& filename, std::function<void(bool)> onComplete = {});
+
+	/** Spawn the actors of a binary snapshot, leaving the rest of the scene as it is.
+		@remarks 
+			The actors' angles are kept in the snapshot, but aren't applied as actors have no way to set them. 
+			@see LoadSnapshot() for loading the whole scene.
+		@param snapshot An open snapshot.
+		@return The number of actors spawned, which is less than the number in the snapshot if any failed to spawn.
+	*/
+	size_t SpawnActors(const SceneSnapshot& snapshot);
+
+	/** Replace the scene with a binary snapshot.
+		@remarks
+			Every actor is destroyed, then the snapshot's tile dimensions, render perspective, maximum actors 
+			per cell, tile maps and tile blocking masks are applied and its actors spawned. The spatial index 
+			covers the new base tile map and the bounds the snapshot was taken with, which are larger if chunks 
+			of a streamed world were loaded. If a tile map fails to parse, nothing is changed.
+		@param snapshot An open snapshot.
+		@param parseTileMap Parses the tile maps, as TileMap has no parser of its own, or empty to keep the 
+			current tile maps. A snapshot without tile maps also keeps them.
+		@return False if a tile map failed to parse.
+	*/
+	bool LoadSnapshot(const SceneSnapshot& snapshot, const TileMapParser& parseTileMap);
+
+	// World Streaming
+
+	/** Stream the chunks of a world in and out around the camera.
+		@remarks
+			At the end of each Update(), the chunks around the camera position are paged through the streamer. 
+			The actors of a chunk are spawned once it has loaded. Streamed actors belong to whichever chunk they 
+			are in, rather than the one that spawned them, and those in a chunk that's no longer loaded are 
+			destroyed, unless they're on the base tile map outside the streamed world.
+		@par
+			Whenever the loaded chunks change, the spatial index is rebuilt once to cover the base tile map, 
+			every loaded chunk and any other actor outside them, so an actor that isn't streamed, such as the 
+			player, is never moved by the index shrinking under it.
+		@par
+			If the streamer was given a tile map parser, each chunk's tile maps are kept while it's loaded and 
+			drawn after the base tile maps, layer for layer, with tile (0, 0) centred half a tile in from the 
+			chunk's top left corner. The base tile map then only needs to cover what's always loaded, and the 
+			rest of the world's tiles are paged with the chunks. Chunk tiles aren't cached in chunks, and 
+			aren't seen by raycasts, which only test the base tile blocking masks.
+		@param pWorldStreamer The streamer to page chunks through, or null to stop streaming and evict every chunk.
 	*/
-	void Serialize(const std::string& filename);
+	void SetWorldStreamer(std::unique_ptr<WorldStreamer> pWorldStreamer);
+
+	/** Set a function called with each chunk streamed in, after its actors have been spawned.
+		@param onChunkLoaded Called as onChunkLoaded(chunkX, chunkY, snapshot), from the end of Update().
+	*/
+	void SetWorldChunkLoadedCallback(std::function<void(int, int, const SceneSnapshot&)> onChunkLoaded) { m_OnWorldChunkLoaded = std::move(onChunkLoaded); }
 
 	// Accessors
 
 	/** Add a new tile map to the back of the list of tile maps. */
 	void AddTileMap(TileMap tileMap) { m_TileMaps.push_back(tileMap); }
 
-	/** Get a tile map on a specified layer.
+	/** Get a tile map on a specified layer for editing.
+		@remarks
+			Nothing is invalidated by getting the tile map, so once tiles have been edited they must be passed to 
+			InvalidateTileChunks(), or edited through the overload taking a tile coordinate, which does this itself. 
+			This is also what tells SnapshotAsync() that the tile map needs copying again.
 		@todo Could have layering within the TileMap class, thus ensuring all layers are the same size, effectively making TileMaps 3D grids.
 	 	@param index Index or layer of tile maps.
 	*/
 	TileMap& GetTileMap(size_t index = 0);
 
+	/** Get a tile map on a specified layer for editing a single tile.
+		@remarks Only the cached chunk containing the tile is invalidated.
+		@param index Index or layer of tile maps.
+		@param x The x coordinate of the tile to be edited.
+		@param y The y coordinate of the tile to be edited.
+	*/
+	TileMap& GetTileMap(size_t index, size_t x, size_t y);
+
 	/** Get a tile map on a specified layer.
 		@todo Could have layering within the TileMap class, thus ensuring all layers are the same size, effectively making TileMaps 3D grids.
 		@param index Index or layer of tile maps.
@@ -211,18 +889,22 @@ public:
 	/** Get the dimensions of a single tile in pixels. */
 	Point<int> GetTileDimensions() const;
 
-	/** Set the maximum number of actors allowed in a cell of the quad tree before the cell subdivides. */
+	/** Set the maximum number of actors allowed in a cell of the quad tree before the cell subdivides.
+		@remarks Has no effect on a uniform grid, as its cells don't subdivide.
+	*/
 	void SetMaxNumActorsPerCell(size_t maxNumActors);
+	/** Get the maximum number of actors allowed in a cell of the spatial index. */
+	size_t GetMaxNumActorsPerCell() const { return m_pSpatialIndex->GetMaxNumActorsPerCell(); }
 
 	/** Set the render perspective. */
-	void SetRenderPerspective(RenderPerspective renderPerspective) { m_RenderPerspective = renderPerspective; }
+	void SetRenderPerspective(RenderPerspective renderPerspective);
 	/** Get the render perspective. */
 	const RenderPerspective GetRenderPerspective() const { return m_RenderPerspective; }
 
 	/** Set the zoom. 
 		@remarks The closer this value is to 0 the more zoomed out the camera is.
 	*/
-	void SetZoom(float zoom) { m_Zoom = zoom; }
+	void SetZoom(float zoom);
 	/** Get the zoom. */
 	const float GetZoom() const { return m_Zoom; }
 
@@ -243,15 +925,327 @@ public:
 	const int GetTileHeight() const { return m_TileHeight; }
 protected:
 private:
+	/** Actors queued by a single thread during an update. */
+	struct ThreadActorQueues {
+		std::vector<Actor*> newActors;
+		std::vector<Actor*> pendingDestroy;
+		std::vector<Actor*> moved;
+		std::vector<Actor*> asleep;
+		std::vector<Actor*> woken;
+	};
+
+	/** The update time owed to an actor outside the activity radius. */
+	struct ActorActivity {
+		// Time passed since the actor was last updated.
+		float pendingTime;
+		// The generation of the actor's slot, so time isn't carried over to a new actor reusing the slot.
+		uint32_t generation;
+	};
+
+	/** A single tile quad queued for batched submission. */
+	struct TileDrawCommand {
+		const Sprite* pSprite;
+		Rect<> destRect;
+		Rect<> mask;
+		int layer;
+	};
+
+	/** The state of the scene captured for a binary snapshot. */
+	struct SceneCapture {
+		std::string filename;
+		SceneSnapshotFormat::Header header;
+		std::vector<std::shared_ptr<const TileMap>> tileMaps;
+		// Each distinct actor resource, indexed by the resources of the actor records.
+		std::vector<std::string> resources;
+		std::vector<SceneSnapshotFormat::Actor> actors;
+		std::shared_ptr<const std::vector<uint32_t>> pTileBlockingMasks;
+		std::function<void(bool)> onComplete;
+		bool isWritten = { false };
+	};
+
+	/** The actor resources queued by PreloadActorPrototypes(). */
+	struct PrototypePreload {
+		std::vector<std::string> actorXmlFilenames;
+		std::function<void(size_t)> onComplete;
+		size_t numInitialised = { 0 };
+	};
+
+	/** Where an actor was at the start of the current tick. */
+	struct PreviousTransform {
+		Point<float> position;
+		float elevation;
+		// The generation of the actor's slot, so a transform isn't used by a new actor reusing the slot.
+		uint32_t generation;
+		// The tick it was captured at, as sleeping actors aren't captured.
+		uint32_t tick;
+	};
+
+	/** A single actor sprite queued for sorted submission. */
+	struct ActorDrawCommand {
+		uint64_t sortKey;
+		const Sprite* pSprite;
+		Rect<> destRect;
+		Rect<> mask;
+		ActorHandle actor;
+	};
+
+	/** The screen space bounds of a sprite drawn by RenderActor(). */
+	struct PickBounds {
+		Rect<> destRect;
+		Rect<> mask;
+		const Sprite* pSprite;
+		// A handle, as the actor may be destroyed before the next render.
+		ActorHandle actor;
+	};
+
+	/** A tile quad cached in a chunk, positioned relative to the screen space origin of the world.
+		@remarks 
+			The tile's sprite and mask are read when drawn rather than baked, as they change for animated tiles. 
+			The tile is kept by its coordinate rather than a pointer, so the chunk never refers to tile storage 
+			that has since moved, e.g. when a tile map is added or replaced.
+	*/
+	struct BakedTile {
+		uint32_t x;
+		uint32_t y;
+		int layer;
+		Point<float> sPosition;
+	};
+
+	/** A block of tiles whose quads are built once and reused until the chunk is invalidated. */
+	struct TileChunk {
+		std::vector<BakedTile> tiles;
+		bool isDirty = { true };
+	};
+
+	/** The cached chunks of a single tile map. */
+	struct TileChunkGrid {
+		// The dimensions of the tile map the chunks were made for, as resizing the tile map moves its tiles.
+		size_t width = { 0 };
+		size_t length = { 0 };
+		size_t numChunksX = { 0 };
+		size_t numChunksY = { 0 };
+		std::vector<TileChunk> chunks;
+	};
+
+	/** The tile maps of a loaded world chunk. */
+	struct WorldChunkTileMaps {
+		// The world space centre of tile (0, 0).
+		Point<float> wOrigin;
+		std::vector<TileMap> tileMaps;
+	};
+
+	/** Internal helper method for rendering a single tile map by visiting each of its visible tiles.
+		@param wOrigin The world space centre of tile (0, 0).
+	*/
+	void RenderTileMap(const TileMap& tileMap, const Point<float>& wOrigin = Point<float>());
+
+	/** Internal helper method for rendering the tile maps of every loaded world chunk, a layer at a time. */
+	void RenderWorldChunkTileMaps();
+
+	/** Internal helper method for getting the range of rows of a tile map that may be visible on screen.
+		@param wOrigin The world space centre of tile (0, 0).
+		@param[out] firstRow The first row that may be visible.
+		@param[out] endRow One past the last row that may be visible.
+		@return False if no row of the tile map is visible.
+	*/
+	bool GetVisibleTileRows(const TileMap& tileMap, const Point<float>& wOrigin, size_t& firstRow, size_t& endRow) const;
+
+	/** Internal helper method for getting the range of columns of a tile map row that is visible on screen.
+		@remarks
+			Each column of a row is one step along the x axis of the tile grid, which is a straight line in 
+			screen space for both perspectives. The range is found by solving where that line overlaps the screen.
+		@param sRowStart Screen position of the top left corner of the first tile of the row.
+		@param sColumnStep Screen space step from one column to the next.
+		@param[out] firstColumn The first visible column.
+		@param[out] endColumn One past the last visible column.
+		@return False if no tile in the row is visible.
+	*/
+	bool GetVisibleTileColumns(
+		const TileMap& tileMap, 
+		const Point<float>& sRowStart, const Point<float>& sColumnStep,
+		size_t& firstColumn, size_t& endColumn) const;
+
+	/** Internal helper method for getting the screen space steps between neighbouring tiles.
+		@param[out] sColumnStep Step from a tile to its neighbour in the next column.
+		@param[out] sRowStep Step from a tile to its neighbour in the next row.
+	*/
+	void GetTileSteps(Point<float>& sColumnStep, Point<float>& sRowStep) const;
+
+	/** Internal helper method for rendering all tile maps with the render perspective resolved. */
+	template<RenderPerspective Perspective>
+	void RenderTileMaps();
+
+	/** Internal helper method for rendering a single tile map from its cached chunks. */
+	template<RenderPerspective Perspective>
+	void RenderTileMapChunks(size_t index);
+
+	/** Internal helper method for getting the chunk grid of a tile map, recreating it if the tile map was resized. */
+	TileChunkGrid& GetTileChunkGrid(size_t index);
+
+	/** Internal helper method for dropping the copy of a tile map shared with snapshots once it has been edited. */
+	void ReleaseTileMapCopy(size_t index);
+
+	/** Internal helper method for rebuilding the cached quads of a chunk. */
+	template<RenderPerspective Perspective>
+	void BakeTileChunk(const TileMap& tileMap, size_t chunkX, size_t chunkY, TileChunk& chunk) const;
+
+	/** Internal helper method for rebuilding the cached camera transforms.
+		@remarks Called whenever anything the transforms depend on changes.
+	*/
+	void UpdateCameraTransform();
+
+	/** Internal helper method for drawing a tile, either immediately or by queueing it in the tile batch. */
+	void DrawTile(const Sprite& sprite, const Rect<>& destRect, const Rect<>& mask, int layer);
+
+	/** Internal helper method for submitting the queued tile batch.
+		@remarks Quads are submitted layer by layer, with each layer grouped into contiguous runs per sprite atlas.
+	*/
+	void FlushTileBatch();
+
+	/** Internal helper method for writing the scene through a rapidjson SAX writer, pretty or compact. */
+	template<typename JsonWriter>
+	void SerializeJson(JsonWriter& writer) const;
+
+	/** Internal helper method for capturing the state of the scene for a binary snapshot. */
+	void CaptureScene(SceneCapture& capture) const;
+
+	/** Internal helper method for encoding and writing a captured scene.
+		@remarks Only reads the capture, so may be called from any thread.
+		@return False if the file couldn't be written.
+	*/
+	static bool WriteSceneCapture(const SceneCapture& capture);
+
+	/** Internal helper method for capturing the scene for a SnapshotAsync() and queueing it for writing. */
+	void QueueSnapshot(const std::string& filename, std::function<void(bool)> onComplete);
+
+	/** Internal helper method for calling the callbacks of the snapshots written since the last call. */
+	void CompleteSnapshots();
+
+	/** Entry point of the thread writing the snapshots queued by SnapshotAsync(). */
+	void SnapshotThreadMain();
+
+	/** Internal helper method for calling the callbacks of the prototype preloads finished since the last call. */
+	void CompletePrototypePreloads();
+
+	/** Entry point of the thread initialising the prototypes queued by PreloadActorPrototypes(). */
+	void PreloadThreadMain();
+
+	/** Internal helper method for initialising a new actor from its resource, by cloning its prototype if 
+		there's a clone function.
+		@return False if the actor couldn't be initialised.
+	*/
+	bool InitialiseActor(PooledActorPtr<Actor>& pActor, const std::string& actorXmlFilename);
+
+	/** Internal helper method for getting the prototype of an actor resource, initialising it if need be.
+		@return The prototype, or null if the resource failed to initialise.
+	*/
+	const Actor* GetActorPrototype(const std::string& actorXmlFilename);
+
+	/** Internal helper method for packing the column and row of a world chunk into a single key. */
+	static uint64_t ToWorldChunkKey(int chunkX, int chunkY) { return (static_cast<uint64_t>(static_cast<uint32_t>(chunkX)) << 32) | static_cast<uint32_t>(chunkY); }
+
+	/** Internal helper method for recording where every awake actor is before a tick.
+		@remarks Sleeping actors are skipped, as they don't move until they're woken.
+	*/
+	void CapturePreviousTransforms();
+
+	/** Internal helper method for getting where to draw an actor between the previous tick and the current one.
+		@param handle The actor's handle, which the caller already has.
+		@return False if the actor wasn't alive and awake at the start of the tick, so should be drawn where it is.
+	*/
+	bool GetInterpolatedTransform(const Actor* pActor, const ActorHandle& handle, Point<float>& wPosition, float& wElevation) const;
+
+	/** Internal helper method for setting the profiler counters describing the spatial index.
+		@remarks Only gathers the stats every s_SpatialIndexStatsInterval frames, as that may visit every actor.
+	*/
+	void SetSpatialIndexCounters();
+
+	/** Internal helper method for paging the world chunks around the camera in and out. */
+	void UpdateWorldStreaming();
+
+	/** Internal helper method for destroying the streamed actors that are no longer in a loaded chunk. */
+	void DespawnUnloadedWorldActors();
+
+	/** Internal helper method for resizing the spatial index to the base tile map, the loaded world chunks and 
+		any actor outside them.
+		@remarks 
+			Only resized once something falls outside the index, or the index is more than 
+			s_SpatialIndexShrinkFactor times as wide or long as it needs to be.
+	*/
+	void FitSpatialIndexToWorld();
+
+	/** Internal helper method for rebuilding the spatial index with new bounds, keeping every actor. */
+	void ResizeSpatialIndex(const Rect<float>& wBoundingBox);
+
+	/** Internal helper method for building the sort key of an actor sprite.
+		@remarks
+			From the most significant bits: the depth of the actor's position along the view (32 bits), its 
+			elevation (16 bits), the sprite's position among the actor's sprites (4 bits) and a hash of the 
+			sprite's atlas (12 bits). With a depth band, the depth is split into the band (32 bits) and the depth 
+			within it (10 bits), with the sprite's position (4 bits) and atlas (12 bits) between them and the 
+			elevation (6 bits) last. @see SetActorBatchDepthBand().
+		@param order The position of the sprite among the sprites of its actor.
+	*/
+	uint64_t MakeActorSortKey(const Actor* pActor, const Sprite& sprite, size_t order) const;
+
+	/** Internal helper method for sorting and submitting the queued actor draw commands. */
+	void FlushActorBatch();
+
+	/** Internal helper method for passing an actor to a region query visitor if it matches the query filters.
+		@return False if the visitor stopped the query.
+	*/
+	template<typename ActorType, typename... RequiredComponents, typename Visitor>
+	static bool VisitFiltered(Actor* pActor, Visitor& visitor);
+
+	/** Internal helper method for bucketing the pick bounds of the last render by the cells of the screen they overlap. */
+	void BuildPickIndex();
+
+	/** Internal helper method for testing a screen position against the hit mask of a drawn sprite.
+		@return True if the pixel under the position is opaque, or the sprite has no hit mask.
+	*/
+	bool IsPickOpaque(const PickBounds& bounds, const Point<>& sPosition) const;
+
+	/** Internal helper method for resizing the tile blocking masks, keeping the masks of the tiles in both sizes. */
+	void ResizeTileBlockingMasks(size_t width, size_t length);
+
+	/** Internal helper method for finding the first tile blocking a ray.
+		@param fraction Receives the fraction along the ray it enters the blocking tile at.
+		@return True if a blocking tile was found.
+	*/
+	bool FindBlockingTile(const Point<float>& origin, const Point<float>& end, uint32_t blockingMask, float& fraction) const;
+
+	/** Internal helper method for visiting every actor hit by a ray, up to the first blocking tile, waking each one.
+		@param visitor Called with each actor hit, ordered by distance from the origin, returning false to stop.
+	*/
+	void VisitRaycastHits(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, uint32_t tileBlockingMask, const ActorVisitor& visitor);
+
+	/** Internal helper method for locking the actor store while actors are being updated in parallel.
+		@remarks 
+			Taken both to create actors and to look them up, as creating an actor may grow the slots and the 
+			handle lookup another thread is reading.
+		@return A lock that is only held during a parallel update.
+	*/
+	std::unique_lock<std::mutex> LockSpawning() const;
+
+	/** Internal helper method for updating a single actor and queuing it if it moved or is pending destroy. */
+	void UpdateActor(Actor* pActor, float deltaTime, ThreadActorQueues& queues);
+
+	/** Internal helper method for getting the time to update an actor by this update.
+		@return False if the actor is asleep, or is distant and not due an update.
+	*/
+	bool GetActorDeltaTime(const Actor* pActor, const ActorHandle& handle, float deltaTime, float& actorDeltaTime);
+
 	/** Internal helper method for adding an actor to the scene. */
-	Actor* AddActor(std::unique_ptr<Actor> pActor);
+	Actor* AddActor(PooledActorPtr<Actor> pActor);
 
 	/** Internal helper method for removing an actor from the scene graph.
 		@return True if the actor was found and successfully removed, false if the actor doesn't exist in the scene and thus can't be removed.
 	*/
 	bool RemoveActor(Actor* pActor);
 
-	/** Internal helper method for removing actors that are pending destroy. */
+	/** Internal helper method for removing actors that are pending destroy.
+		@remarks Only visits the actors queued for destruction, not every actor in the scene.
+	*/
 	void DestroyPendingActors();
 
 	// Member Variables
@@ -261,13 +1255,20 @@ private:
 	// Reference to the renderer.
 	Renderer& m_RendererRef;
 
-	std::vector<std::unique_ptr<Actor>> m_Actors;
+	// Owns every actor in the scene, pooled by actor type.
+	ActorStore m_Actors;
 	ActorFactory& m_ActorFactoryRef;
 
 	// The map of tiles.
 	//TileMap m_TileMap;
 	std::vector<TileMap> m_TileMaps;
 
+	// An immutable copy of each tile map shared with captured snapshots, or null once the tile map has been 
+	// reported as edited since the copy was made, and the same for the tile blocking masks. Mutable as the copies 
+	// are made by capturing the scene.
+	mutable std::vector<std::shared_ptr<const TileMap>> m_TileMapCopies;
+	mutable std::shared_ptr<const std::vector<uint32_t>> m_TileBlockingMaskCopy;
+
 	// The width of an individual tile.
 	int m_TileWidth;
 	// The height of an individual tile.
@@ -287,26 +1288,249 @@ private:
 
 	Point<float> m_sCameraPosition;
 
-	// The root of the quad tree for fast collision detection and render ordering.
-	QuadTreeCell m_QuadTreeRoot;
+	// Cached transforms between world and screen space, rebuilt by UpdateCameraTransform().
+	AffineTransform m_WorldToScreenTransform;
+	AffineTransform m_ScreenToWorldTransform;
+
+	// The screen centre the cached transforms were built with, used to detect the renderer resizing.
+	Point<> m_sScreenCentrePosition;
+
+	// Incremented every time the cached transforms are rebuilt.
+	uint32_t m_CameraVersion = { 0 };
+
+	// The width and length in tiles of a cell of a UNIFORM_GRID spatial index.
+	static constexpr float s_GridCellSizeInTiles = 4.0f;
+
+	// How many times wider or longer than the streamed world the spatial index may be before it is shrunk.
+	static constexpr float s_SpatialIndexShrinkFactor = 2.0f;
+
+	// The radius in tiles QueryNearest() starts searching within.
+	static constexpr float s_NearestQueryStartRadius = 4.0f;
+
+	// Stores actors by position for fast collision detection and render ordering.
+	std::unique_ptr<SpatialIndex> m_pSpatialIndex;
+
+	// What each tile of the base tile map blocks, row by row, and the dimensions of the base tile map they were set for.
+	std::vector<uint32_t> m_TileBlockingMasks;
+	size_t m_TileBlockingMaskWidth = { 0 };
+	size_t m_TileBlockingMaskLength = { 0 };
+
+	// The bounds of each sprite drawn by the last RenderActors(), in draw order. Mutable as it's recorded by
+	// RenderActor().
+	mutable std::vector<PickBounds> m_PickBounds;
+	bool m_HasPickBounds = { false };
+
+	// The width and height in pixels of a cell of the pick index.
+	static constexpr int s_PickCellSize = 64;
+
+	// The pick bounds overlapping each cell of the screen in draw order, with the bounds of cell i stored from
+	// m_PickCellStarts[i] up to m_PickCellStarts[i + 1].
+	std::vector<uint32_t> m_PickCellStarts;
+	std::vector<uint32_t> m_PickCellBounds;
+	// The next free entry of each cell while the pick index is built, kept to save allocating.
+	std::vector<uint32_t> m_PickCellEnds;
+	int m_NumPickCellsX = { 0 };
+	int m_NumPickCellsY = { 0 };
+	bool m_IsPickIndexDirty = { true };
+
+	bool m_IsPickAlphaTestingEnabled = { false };
+	std::unordered_map<const Sprite*, SpriteHitMask> m_SpriteHitMasks;
 
 	// The perspective to render the scene, used for calculating positions in screen space.
 	RenderPerspective m_RenderPerspective;
 
-	std::vector<std::unique_ptr<Actor>> m_NewActors;
+	// Actors spawned during Update(), made live once the update is finished.
+	std::vector<Actor*> m_NewActors;
 
 	bool m_IsUpdatingActors = { false };
+
+	// Job pool for updating actors in parallel, or null to update actors serially.
+	std::unique_ptr<JobPool> m_pUpdateJobPool;
+	bool m_IsUpdatingInParallel = { false };
+
+	// The number of actors updated by a single job of a parallel update.
+	static constexpr size_t s_ActorsPerUpdateJob = 64;
+
+	// The live actors of a parallel update, gathered so they can be split into jobs, along with the time to 
+	// update each by.
+	std::vector<Actor*> m_ActorsToUpdate;
+	std::vector<float> m_ActorDeltaTimes;
+
+	// The number of updates per update of a distant actor, unless set otherwise.
+	static constexpr size_t s_DefaultDistantUpdateInterval = 4;
+
+	// Distance from the camera beyond which actors are updated every m_DistantUpdateInterval updates, or 0.
+	float m_ActivityRadius = { 0.0f };
+	size_t m_DistantUpdateInterval = { s_DefaultDistantUpdateInterval };
+	// The number of updates so far, for picking the distant actors due an update.
+	size_t m_NumUpdates = { 0 };
+	// The update time owed to each distant actor, indexed by the pool and slot of its handle.
+	std::vector<std::vector<ActorActivity>> m_ActorActivity;
+
+	// The duration of a fixed simulation tick, or 0 for none.
+	float m_FixedTimestep = { 0.0f };
+	// Time not yet simulated by Advance().
+	float m_TickAccumulator = { 0.0f };
+	float m_InterpolationAlpha = { 1.0f };
+
+	// The most ticks a single Advance() runs.
+	static constexpr size_t s_MaxTicksPerAdvance = 8;
+
+	// Where each actor was at the start of the current tick, indexed by the pool and slot of its handle.
+	std::vector<std::vector<PreviousTransform>> m_PreviousTransforms;
+	// Counts the ticks the previous transforms have been captured at.
+	uint32_t m_PreviousTransformsTick = { 0 };
+
+	// The frame arena of each update thread, indexed by JobPool::GetCurrentThreadIndex(). A deque that only grows, 
+	// so an arena never moves while anything allocated from it is alive.
+	std::deque<FrameArena> m_FrameArenas = { std::deque<FrameArena>(1) };
+
+	size_t m_NumHeapAllocationsAtFrameStart = { 0 };
+	size_t m_NumHeapAllocationsLastFrame = { 0 };
+
+	// Mutable, as rendering an actor counts the sprites it submits.
+	mutable Profiler m_Profiler;
+
+	// The last stats of the spatial index, and the frames since they were gathered.
+	size_t m_SpatialIndexDepth = { 0 };
+	size_t m_NumSpatialIndexCells = { 0 };
+	size_t m_NumFramesSinceSpatialIndexStats = { 0 };
+
+	// The number of frames between gathering the stats of the spatial index for the profiler.
+	static constexpr size_t s_SpatialIndexStatsInterval = 30;
+	// The queues of each thread during an update, indexed by JobPool::GetCurrentThreadIndex().
+	std::vector<ThreadActorQueues> m_ThreadActorQueues = { std::vector<ThreadActorQueues>(1) };
+
+	// Actors queued for destruction at the end of the update, possibly more than once.
+	std::vector<Actor*> m_PendingDestroyActors;
+
+	// Actors that moved since the last ResolveCollisions(). Handles, as the actors may since have been destroyed.
+	std::vector<ActorHandle> m_MovedActors;
+
+	CollisionBroadphase m_CollisionBroadphase;
+	CollisionWorld m_CollisionWorld;
+
+	// The moved actors of the current ResolveCollisions(), sorted by address.
+	std::vector<const Actor*> m_SortedMovedActors;
+	// Guards the actor store during a parallel update.
+	mutable std::mutex m_SpawnMutex;
+
+	// Guards the actor factory and the prototypes, which are shared with the preload thread.
+	std::mutex m_ActorFactoryMutex;
+	ActorCloneFunction m_CloneActor;
+	// Declared before the prototypes, so it outlives them.
+	ActorStore m_ActorPrototypeStore;
+	// The prototype of each actor resource, or null if it failed to initialise.
+	std::unordered_map<std::string, PooledActorPtr<Actor>> m_ActorPrototypes;
+
+	// Guards the preload queues, which are shared with the preload thread.
+	std::mutex m_PreloadMutex;
+	std::condition_variable m_PreloadsQueued;
+	std::deque<PrototypePreload> m_QueuedPreloads;
+	std::vector<PrototypePreload> m_CompletedPreloads;
+	// Whether the preload thread is initialising the prototypes of a preload it has taken off the queue.
+	bool m_IsPreloading = { false };
+	std::condition_variable m_PreloadsFinished;
+	bool m_IsShuttingDownPreloads = { false };
+
+	// Started by the first PreloadActorPrototypes().
+	std::thread m_PreloadThread;
+
+	// Tile quads queued for batched submission. Kept as a member so its capacity is reused between frames.
+	std::vector<TileDrawCommand> m_TileBatch;
+	bool m_IsTileBatchingEnabled = { true };
+
+	// Actor sprites queued for sorted submission. Mutable as they're queued by RenderActor().
+	mutable std::vector<ActorDrawCommand> m_ActorBatch;
+	std::vector<ActorDrawCommand> m_ActorBatchScratch;
+	bool m_IsActorBatchingEnabled = { true };
+	float m_ActorBatchDepthBand = { 0.0f };
+	// Whether RenderActors() is visiting the actors, so RenderActor() queues rather than draws.
+	bool m_IsQueuingActorSprites = { false };
+
+	// Guards the snapshot queues below, which are shared with the snapshot thread and with actors updating in parallel.
+	std::mutex m_SnapshotMutex;
+
+	// The snapshots requested by SnapshotAsync() during an update, captured at the end of it.
+	std::vector<std::pair<std::string, std::function<void(bool)>>> m_SnapshotRequests;
+
+	std::condition_variable m_SnapshotsQueued;
+	std::deque<std::unique_ptr<SceneCapture>> m_QueuedSnapshots;
+	std::vector<std::unique_ptr<SceneCapture>> m_WrittenSnapshots;
+	bool m_IsShuttingDownSnapshots = { false };
+
+	// Started by the first SnapshotAsync().
+	std::thread m_SnapshotThread;
+
+	// The type of m_pSpatialIndex, and the bounds of the base tile map it always covers.
+	SpatialIndexType m_SpatialIndexType;
+	Rect<float> m_BaseBoundingBox;
+
+	std::unique_ptr<WorldStreamer> m_pWorldStreamer;
+	std::function<void(int, int, const SceneSnapshot&)> m_OnWorldChunkLoaded;
+	// Every actor spawned by a world chunk, some of which may have since been destroyed.
+	std::vector<ActorHandle> m_WorldStreamedActors;
+	// The tile maps of each loaded world chunk, by chunk column and row.
+	std::unordered_map<uint64_t, WorldChunkTileMaps> m_WorldChunkTileMaps;
+
+	// The width and length in tiles of a cached tile chunk.
+	static constexpr size_t s_TileChunkSize = 16;
+
+	// The cached chunks of each tile map, indexed the same as m_TileMaps.
+	std::vector<TileChunkGrid> m_TileChunkGrids;
+	bool m_IsTileChunkCachingEnabled = { true };
 };
 
+template<>
+inline Point<float> SceneGraph::ToCartesianCoord<RenderPerspective::OBLIQUE>(const Point<float>& isometricCoord) const
+{
+	return {
+		isometricCoord.X() * m_TileWidth,
+		isometricCoord.Y() * m_TileHeight
+	};
+}
+
+template<>
+inline Point<float> SceneGraph::ToCartesianCoord<RenderPerspective::ISOMETRIC>(const Point<float>& isometricCoord) const
+{
+	return {
+		(isometricCoord.X() - isometricCoord.Y()) * m_HalfTileWidth,
+		(isometricCoord.X() + isometricCoord.Y()) * m_HalfTileHeight
+	};
+}
+
+template<>
+inline Point<float> SceneGraph::ToIsometricCoord<RenderPerspective::OBLIQUE>(const Point<>& cartesianCoord) const
+{
+	return {
+		cartesianCoord.X() / static_cast<float>(m_TileWidth),
+		cartesianCoord.Y() / static_cast<float>(m_TileHeight)
+	};
+}
+
+template<>
+inline Point<float> SceneGraph::ToIsometricCoord<RenderPerspective::ISOMETRIC>(const Point<>& cartesianCoord) const
+{
+	return {
+		((cartesianCoord.Y() / static_cast<float>(m_TileHeight)) + (cartesianCoord.X() / static_cast<float>(m_TileWidth))),
+		((cartesianCoord.Y() / static_cast<float>(m_TileHeight)) - (cartesianCoord.X() / static_cast<float>(m_TileWidth)))
+	};
+}
+
 template<typename ActorType, typename... Ts>
 ActorType* SceneGraph::SpawnActor(const std::string& jsonResource, Ts&&... args)
 {
 	static_assert(std::is_base_of<Actor, ActorType>::value,
 		"ActorType must be derived from Actor");
 
-	// Construct an actor of the ActorType using the given arguments.
-	auto pActor = std::make_unique<ActorType>(this, std::forward<Ts>(args)...);
-	m_ActorFactoryRef.AddComponentsAndInitaliseActor(pActor, jsonResource);
+	auto spawnLock = LockSpawning();
+
+	// Construct an actor of the ActorType using the given arguments, in the pool of the ActorType.
+	auto pActor = m_Actors.Create<ActorType>(this, std::forward<Ts>(args)...);
+	{
+		std::lock_guard<std::mutex> factoryLock(m_ActorFactoryMutex);
+		m_ActorFactoryRef.AddComponentsAndInitaliseActor(pActor, jsonResource);
+	}
 
 	assert(pActor);
 
@@ -318,4 +1542,129 @@ ActorType* SceneGraph::SpawnActor(const std::string& jsonResource, Ts&&... args)
 	return pActorRef;
 }
 
+template<typename ActorType, typename... RequiredComponents, typename Visitor>
+bool SceneGraph::VisitFiltered(Actor* pActor, Visitor& visitor)
+{
+	auto pTypedActor = dynamic_cast<ActorType*>(pActor);
+	if (!pTypedActor) {
+		return true;
+	}
+
+	const bool hasComponents[] = { true, (pTypedActor->template GetComponent<RequiredComponents>() != nullptr)... };
+	if (!std::all_of(std::begin(hasComponents), std::end(hasComponents), [](bool hasComponent) { return hasComponent; })) {
+		return true;
+	}
+
+	return static_cast<bool>(visitor(pTypedActor));
+}
+
+template<typename ActorType, typename... RequiredComponents, typename Visitor>
+void SceneGraph::QueryAABB(const Rect<float>& wBox, Visitor&& visitor)
+{
+	m_pSpatialIndex->QueryAABB(wBox, [&visitor](Actor* pActor) {
+		return VisitFiltered<ActorType, RequiredComponents...>(pActor, visitor);
+	});
+}
+
+template<typename ActorType, typename... RequiredComponents, typename Visitor>
+void SceneGraph::QueryRadius(const Point<float>& wCentre, float radius, Visitor&& visitor)
+{
+	const Rect<float> wBox = { wCentre.X() - radius, wCentre.Y() - radius, radius * 2.0f, radius * 2.0f };
+	const auto radiusSquared = radius * radius;
+
+	m_pSpatialIndex->QueryAABB(wBox, [&](auto* pActor) {
+		const auto offset = pActor->GetPosition() - wCentre;
+		if (offset.X() * offset.X() + offset.Y() * offset.Y() > radiusSquared) {
+			return true;
+		}
+
+		return VisitFiltered<ActorType, RequiredComponents...>(pActor, visitor);
+	});
+}
+
+template<typename ActorType, typename... RequiredComponents, typename Visitor>
+void SceneGraph::QueryScreenRect(const Rect<>& sRect, Visitor&& visitor)
+{
+	// The rectangle can be any quadrilateral in world space, so query the world space box around its corners.
+	const Point<float> wCorners[] = {
+		ToWorldPosition(Point<>(sRect.GetLeft(), sRect.GetTop())),
+		ToWorldPosition(Point<>(sRect.GetRight(), sRect.GetTop())),
+		ToWorldPosition(Point<>(sRect.GetLeft(), sRect.GetBottom())),
+		ToWorldPosition(Point<>(sRect.GetRight(), sRect.GetBottom()))
+	};
+
+	auto left = wCorners[0].X();
+	auto right = wCorners[0].X();
+	auto top = wCorners[0].Y();
+	auto bottom = wCorners[0].Y();
+
+	for (const auto& wCorner : wCorners) {
+		left = std::min(left, wCorner.X());
+		right = std::max(right, wCorner.X());
+		top = std::min(top, wCorner.Y());
+		bottom = std::max(bottom, wCorner.Y());
+	}
+
+	m_pSpatialIndex->QueryAABB({ left, top, right - left, bottom - top }, [&](auto* pActor) {
+		const auto sPosition = ToScreenPosition(pActor->GetPosition(), pActor->GetElevation());
+		if (sPosition.X() < sRect.GetLeft() || sPosition.X() > sRect.GetRight() ||
+			sPosition.Y() < sRect.GetTop() || sPosition.Y() > sRect.GetBottom()) {
+			return true;
+		}
+
+		return VisitFiltered<ActorType, RequiredComponents...>(pActor, visitor);
+	});
+}
+
+template<typename ActorType, typename... RequiredComponents>
+size_t SceneGraph::QueryNearest(const Point<float>& wPosition, size_t k, ActorType** pNearest, float maxRadius)
+{
+	if (k == 0) {
+		return 0;
+	}
+
+	auto distanceSquared = [&wPosition](const ActorType* pActor) {
+		const auto offset = pActor->GetPosition() - wPosition;
+		return offset.X() * offset.X() + offset.Y() * offset.Y();
+	};
+
+	// No actor is further from the position than the furthest corner of the index, wherever the position is.
+	const auto& boundingBox = m_pSpatialIndex->GetBoundingBox();
+	const auto dx = std::max(std::abs(wPosition.X() - boundingBox.GetLeft()), std::abs(wPosition.X() - boundingBox.GetRight()));
+	const auto dy = std::max(std::abs(wPosition.Y() - boundingBox.GetTop()), std::abs(wPosition.Y() - boundingBox.GetBottom()));
+	const auto sceneRadius = std::sqrt(dx * dx + dy * dy);
+
+	// Growing the radius only saves work if a query doesn't test every actor anyway.
+	auto radius = m_pSpatialIndex->IsQueryAABBLocal() ? std::min(s_NearestQueryStartRadius, maxRadius) : std::min(sceneRadius, maxRadius);
+	size_t numFound = 0;
+
+	while (true) {
+		numFound = 0;
+
+		QueryRadius<ActorType, RequiredComponents...>(wPosition, radius, [&](ActorType* pActor) {
+			const auto actorDistanceSquared = distanceSquared(pActor);
+			if (numFound == k && actorDistanceSquared >= distanceSquared(pNearest[k - 1])) {
+				return true;
+			}
+
+			// Insert the actor in order, dropping the furthest actor once k have been found.
+			auto i = std::min(numFound, k - 1);
+			numFound = std::min(numFound + 1, k);
+
+			for (; i > 0 && distanceSquared(pNearest[i - 1]) > actorDistanceSquared; --i) {
+				pNearest[i] = pNearest[i - 1];
+			}
+
+			pNearest[i] = pActor;
+			return true;
+		});
+
+		if (numFound == k || radius >= maxRadius || radius >= sceneRadius) {
+			return numFound;
+		}
+
+		radius = std::min(radius * 2.0f, maxRadius);
+	}
+}
+
 #endif	// __SCENEGRAPH_H__
\ No newline at end of file
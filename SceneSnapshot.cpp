@@ -0,0 +1,192 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <cstring>
+
+// This Include
+#include "SceneSnapshot.h"
+
+SceneSnapshotWriter::SceneSnapshotWriter(const std::string& filename)
+	:m_Stream(filename, std::ios::binary | std::ios::trunc)
+{
+	// Reserve the header, which is only known once everything else has been written.
+	const SceneSnapshotFormat::Header header = {};
+	m_Stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void SceneSnapshotWriter::AddTileMap(uint32_t width, uint32_t length, const char* pData, size_t size)
+{
+	SceneSnapshotFormat::TileMap tileMap = { width, length, static_cast<uint64_t>(m_Stream.tellp()), size };
+	m_TileMaps.push_back(tileMap);
+
+	m_Stream.write(pData, size);
+}
+
+void SceneSnapshotWriter::AddActor(const std::string& resource, float x, float y, float elevation, float angle)
+{
+	m_Actors.push_back({ InternString(resource), x, y, elevation, angle });
+}
+
+uint32_t SceneSnapshotWriter::InternString(const std::string& string)
+{
+	auto iter = m_StringIndices.emplace(string, static_cast<uint32_t>(m_Strings.size())).first;
+	if (iter->second == m_Strings.size()) {
+		m_Strings.push_back(&iter->first);
+	}
+
+	return iter->second;
+}
+
+bool SceneSnapshotWriter::Finish(SceneSnapshotFormat::Header header)
+{
+	std::memcpy(header.magic, SceneSnapshotFormat::s_Magic, sizeof(header.magic));
+	header.version = SceneSnapshotFormat::s_Version;
+	header.numTileMaps = static_cast<uint32_t>(m_TileMaps.size());
+	header.numActors = m_Actors.size();
+	header.numStrings = m_Strings.size();
+
+	Align();
+	header.tileMapTableOffset = static_cast<uint64_t>(m_Stream.tellp());
+	m_Stream.write(reinterpret_cast<const char*>(m_TileMaps.data()), m_TileMaps.size() * sizeof(SceneSnapshotFormat::TileMap));
+
+	Align();
+	header.actorTableOffset = static_cast<uint64_t>(m_Stream.tellp());
+	m_Stream.write(reinterpret_cast<const char*>(m_Actors.data()), m_Actors.size() * sizeof(SceneSnapshotFormat::Actor));
+
+	// The characters follow the string table, so the offset of each string is known before writing the table.
+	Align();
+	header.stringTableOffset = static_cast<uint64_t>(m_Stream.tellp());
+
+	auto stringOffset = header.stringTableOffset + m_Strings.size() * sizeof(SceneSnapshotFormat::String);
+	for (auto pString : m_Strings) {
+		const SceneSnapshotFormat::String string = { stringOffset, pString->size() };
+		m_Stream.write(reinterpret_cast<const char*>(&string), sizeof(string));
+
+		stringOffset += pString->size() + 1;
+	}
+
+	for (auto pString : m_Strings) {
+		m_Stream.write(pString->c_str(), pString->size() + 1);
+	}
+
+	// Masks are only written if they match the dimensions in the header, so the reader can trust them.
+	if (m_NumTileBlockingMasks != static_cast<size_t>(header.tileBlockingMaskWidth) * header.tileBlockingMaskLength) {
+		header.tileBlockingMaskWidth = 0;
+		header.tileBlockingMaskLength = 0;
+	}
+
+	Align();
+	header.tileBlockingMaskTableOffset = static_cast<uint64_t>(m_Stream.tellp());
+	m_Stream.write(reinterpret_cast<const char*>(m_pTileBlockingMasks), static_cast<size_t>(header.tileBlockingMaskWidth) * header.tileBlockingMaskLength * sizeof(uint32_t));
+
+	m_Stream.seekp(0);
+	m_Stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	m_Stream.flush();
+
+	return m_Stream.good();
+}
+
+void SceneSnapshotWriter::Align()
+{
+	static const char s_Padding[8] = {};
+
+	const auto position = static_cast<size_t>(m_Stream.tellp());
+	m_Stream.write(s_Padding, (8 - position % 8) % 8);
+}
+
+bool SceneSnapshot::Open(const std::string& filename)
+{
+	m_pHeader = nullptr;
+	m_pTileMaps = nullptr;
+	m_pActors = nullptr;
+	m_pStrings = nullptr;
+	m_pTileBlockingMasks = nullptr;
+
+	if (!m_File.Open(filename)) {
+		DEBUG_ERROR() << "Failed to open scene snapshot. Couldn't map file \'" << filename << "\'.";
+		return false;
+	}
+
+	auto fail = [this, &filename](const char* pReason) {
+		DEBUG_ERROR() << "Failed to open scene snapshot \'" << filename << "\'. " << pReason;
+		m_File.Close();
+		return false;
+	};
+
+	if (!IsInFile(0, sizeof(SceneSnapshotFormat::Header))) {
+		return fail("The file is too small.");
+	}
+
+	const auto pData = m_File.GetData();
+	const auto pHeader = reinterpret_cast<const SceneSnapshotFormat::Header*>(pData);
+
+	if (std::memcmp(pHeader->magic, SceneSnapshotFormat::s_Magic, sizeof(pHeader->magic)) != 0) {
+		return fail("The file isn't a scene snapshot.");
+	}
+
+	if (pHeader->version != SceneSnapshotFormat::s_Version) {
+		return fail("The snapshot was written by another version.");
+	}
+
+	// Every table must be aligned and lie within the file, so records can be read in place.
+	auto isTableInFile = [this](uint64_t offset, uint64_t count, size_t recordSize) {
+		return offset % 8 == 0 && (count == 0 || count <= m_File.GetSize() / recordSize) && IsInFile(offset, count * recordSize);
+	};
+
+	if (!isTableInFile(pHeader->tileMapTableOffset, pHeader->numTileMaps, sizeof(SceneSnapshotFormat::TileMap)) ||
+		!isTableInFile(pHeader->actorTableOffset, pHeader->numActors, sizeof(SceneSnapshotFormat::Actor)) ||
+		!isTableInFile(pHeader->stringTableOffset, pHeader->numStrings, sizeof(SceneSnapshotFormat::String)) ||
+		!isTableInFile(pHeader->tileBlockingMaskTableOffset, static_cast<uint64_t>(pHeader->tileBlockingMaskWidth) * pHeader->tileBlockingMaskLength, sizeof(uint32_t))) {
+		return fail("A table lies outside the file.");
+	}
+
+	const auto pTileMaps = reinterpret_cast<const SceneSnapshotFormat::TileMap*>(pData + pHeader->tileMapTableOffset);
+	for (uint32_t i = 0; i < pHeader->numTileMaps; ++i) {
+		if (!IsInFile(pTileMaps[i].dataOffset, pTileMaps[i].dataSize)) {
+			return fail("The data of a tile map lies outside the file.");
+		}
+	}
+
+	const auto pStrings = reinterpret_cast<const SceneSnapshotFormat::String*>(pData + pHeader->stringTableOffset);
+	for (uint64_t i = 0; i < pHeader->numStrings; ++i) {
+		const auto& string = pStrings[i];
+		if (string.length == UINT64_MAX || !IsInFile(string.offset, string.length + 1) || pData[string.offset + string.length] != '\0') {
+			return fail("A string lies outside the file.");
+		}
+	}
+
+	const auto pActors = reinterpret_cast<const SceneSnapshotFormat::Actor*>(pData + pHeader->actorTableOffset);
+	for (uint64_t i = 0; i < pHeader->numActors; ++i) {
+		if (pActors[i].resource >= pHeader->numStrings) {
+			return fail("An actor refers to a missing resource.");
+		}
+	}
+
+	m_pHeader = pHeader;
+	m_pTileMaps = pTileMaps;
+	m_pActors = pActors;
+	m_pStrings = pStrings;
+	m_pTileBlockingMasks = reinterpret_cast<const uint32_t*>(pData + pHeader->tileBlockingMaskTableOffset);
+
+	return true;
+}
+
+bool SceneSnapshot::ParseTileMaps(const TileMapParser& parseTileMap, std::vector<TileMap>& tileMaps) const
+{
+	for (size_t i = 0; i < GetNumTileMaps(); ++i) {
+		if (!parseTileMap(GetTileMapData(i), static_cast<size_t>(m_pTileMaps[i].dataSize), tileMaps)) {
+			DEBUG_ERROR() << "Failed to parse tile map " << i << " of scene snapshot.";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SceneSnapshot::IsInFile(uint64_t offset, uint64_t size) const
+{
+	const auto fileSize = static_cast<uint64_t>(m_File.GetSize());
+	return offset <= fileSize && size <= fileSize - offset;
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#ifndef __SCENESNAPSHOT_H__
+#define __SCENESNAPSHOT_H__
+
+// Library Includes
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Local Includes
+#include "MappedFile.h"
+
+// Forward Declaration
+class TileMap;
+
+/** The records making up a binary scene snapshot, as laid out in the file.
+@remarks
+	A snapshot is a header followed by the data of each tile map, then a table of tile maps, a packed table of
+	actors, a table of interned strings followed by their characters, and the blocking mask of each tile of the
+	base tile map, row by row. Tables start on 8 byte boundaries and
+	every value is stored in the native byte order, so the file is read in place without parsing.
+*/
+namespace SceneSnapshotFormat {
+	/** The first bytes of every snapshot. */
+	static constexpr char s_Magic[4] = { 'B', 'F', 'S', 'N' };
+
+	/** The version written, bumped whenever the layout of any record changes. */
+	static constexpr uint32_t s_Version = 2;
+
+	/** The start of the file. Offsets are in bytes from the start of the file. */
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		int32_t tileWidth;
+		int32_t tileHeight;
+		// The RenderPerspective of the scene.
+		uint32_t perspective;
+		uint32_t numTileMaps;
+		// The x, y, width and height of the world space bounds of the scene.
+		float boundingBox[4];
+		uint64_t maxActorsPerCell;
+		uint64_t numActors;
+		uint64_t numStrings;
+		uint64_t tileMapTableOffset;
+		uint64_t actorTableOffset;
+		uint64_t stringTableOffset;
+		// The dimensions of the grid of tile blocking masks, which are uint32_t.
+		uint32_t tileBlockingMaskWidth;
+		uint32_t tileBlockingMaskLength;
+		uint64_t tileBlockingMaskTableOffset;
+	};
+
+	/** A tile map, in the same order as the tile maps of the scene. */
+	struct TileMap {
+		uint32_t width;
+		uint32_t length;
+		// The tile map as compact JSON, as written by TileMap::Serialize().
+		uint64_t dataOffset;
+		uint64_t dataSize;
+	};
+
+	/** A live actor of the scene. */
+	struct Actor {
+		// The index of the actor's resource in the string table.
+		uint32_t resource;
+		float x;
+		float y;
+		float elevation;
+		float angle;
+	};
+
+	/** An interned string. The characters are followed by a null terminator, which isn't counted in the length. */
+	struct String {
+		uint64_t offset;
+		uint64_t length;
+	};
+
+	static_assert(sizeof(Header) == 104, "Header layout must match the file format");
+	static_assert(sizeof(TileMap) == 24, "TileMap layout must match the file format");
+	static_assert(sizeof(Actor) == 20, "Actor layout must match the file format");
+	static_assert(sizeof(String) == 16, "String layout must match the file format");
+}
+
+/** Parses the JSON of a snapshot tile map, as written by TileMap::Serialize(), and appends the tile map to a list.
+@remarks Called as parseTileMap(pJson, size, tileMaps), returning false if the JSON isn't a tile map.
+*/
+using TileMapParser = std::function<bool(const char*, size_t, std::vector<TileMap>&)>;
+
+/** Writes a binary scene snapshot straight to a file.
+@remarks
+	Tile map data is written as soon as it's added, and the tables after the last tile map, so only the actor
+	table and the interned strings are held in memory.
+*/
+class SceneSnapshotWriter {
+	// Member Functions
+public:
+	/** Constructor. Opens the file for writing.
+		@param filename Name and path to the file to be written to.
+	*/
+	explicit SceneSnapshotWriter(const std::string& filename);
+
+	/** Get whether the file was opened and everything so far has been written. */
+	bool IsGood() const { return m_Stream.good(); }
+
+	/** Write the data of the next tile map. */
+	void AddTileMap(uint32_t width, uint32_t length, const char* pData, size_t size);
+
+	/** Queue an actor for the actor table. */
+	void AddActor(const std::string& resource, float x, float y, float elevation, float angle);
+
+	/** Queue an actor record for the actor table.
+		@param actor An actor whose resource is an index returned by InternString().
+	*/
+	void AddActor(const SceneSnapshotFormat::Actor& actor) { m_Actors.push_back(actor); }
+
+	/** Add a string to the string table, if it isn't there already.
+		@return The index of the string in the string table.
+	*/
+	uint32_t InternString(const std::string& string);
+
+	/** Set the tile blocking masks, whose dimensions are given by the header passed to Finish().
+		@remarks Not copied, so they must outlive Finish().
+	*/
+	void SetTileBlockingMasks(const uint32_t* pMasks, size_t count)
+	{
+		m_pTileBlockingMasks = pMasks;
+		m_NumTileBlockingMasks = count;
+	}
+
+	/** Write the tables and the header.
+		@param header The scene parameters. The magic, version, counts and offsets are filled in.
+		@return False if anything failed to be written.
+	*/
+	bool Finish(SceneSnapshotFormat::Header header);
+private:
+	/** Pad the file with zeros up to the next 8 byte boundary. */
+	void Align();
+
+	// Member Variables
+private:
+	std::ofstream m_Stream;
+
+	std::vector<SceneSnapshotFormat::TileMap> m_TileMaps;
+	std::vector<SceneSnapshotFormat::Actor> m_Actors;
+
+	const uint32_t* m_pTileBlockingMasks = { nullptr };
+	size_t m_NumTileBlockingMasks = { 0 };
+
+	// Each distinct string in the order first interned, along with its index.
+	std::vector<const std::string*> m_Strings;
+	std::unordered_map<std::string, uint32_t> m_StringIndices;
+};
+
+/** A binary scene snapshot read in place from a memory mapped file.
+@remarks
+	Open() checks that every table and string lies within the file, after which the records are read straight
+	from the mapping. Nothing is copied, so the accessors are only valid while the snapshot is open.
+*/
+class SceneSnapshot {
+	// Member Functions
+public:
+	/** Map a snapshot and check its layout.
+		@param filename Name and path to the file to be read.
+		@return False if the file couldn't be mapped, isn't a snapshot, is of another version or is truncated.
+	*/
+	bool Open(const std::string& filename);
+
+	/** Unmap the snapshot. */
+	void Close() { m_File.Close(); }
+
+	/** Get whether a snapshot is open. */
+	bool IsOpen() const { return m_File.IsOpen(); }
+
+	/** Get the header of the snapshot. */
+	const SceneSnapshotFormat::Header& GetHeader() const { return *m_pHeader; }
+
+	/** Get the number of tile maps. */
+	size_t GetNumTileMaps() const { return m_pHeader->numTileMaps; }
+	/** Get a tile map record. */
+	const SceneSnapshotFormat::TileMap& GetTileMap(size_t index) const { return m_pTileMaps[index]; }
+	/** Get the JSON of a tile map, which isn't null terminated. */
+	const char* GetTileMapData(size_t index) const { return reinterpret_cast<const char*>(m_File.GetData() + m_pTileMaps[index].dataOffset); }
+
+	/** Parse every tile map, in order.
+		@param parseTileMap Parses the JSON of each tile map.
+		@param tileMaps Has each tile map appended.
+		@return False if a tile map failed to parse, leaving those before it appended.
+	*/
+	bool ParseTileMaps(const TileMapParser& parseTileMap, std::vector<TileMap>& tileMaps) const;
+
+	/** Get the number of actors. */
+	size_t GetNumActors() const { return static_cast<size_t>(m_pHeader->numActors); }
+	/** Get an actor record. */
+	const SceneSnapshotFormat::Actor& GetActor(size_t index) const { return m_pActors[index]; }
+
+	/** Get the number of interned strings. */
+	size_t GetNumStrings() const { return static_cast<size_t>(m_pHeader->numStrings); }
+	/** Get an interned string, which is null terminated. */
+	const char* GetString(size_t index) const { return reinterpret_cast<const char*>(m_File.GetData() + m_pStrings[index].offset); }
+	/** Get the length of an interned string, not counting the null terminator. */
+	size_t GetStringLength(size_t index) const { return static_cast<size_t>(m_pStrings[index].length); }
+
+	/** Get the tile blocking masks, row by row, of the dimensions given by the header. */
+	const uint32_t* GetTileBlockingMasks() const { return m_pTileBlockingMasks; }
+private:
+	/** Get whether a range of bytes lies within the file. */
+	bool IsInFile(uint64_t offset, uint64_t size) const;
+
+	// Member Variables
+private:
+	MappedFile m_File;
+
+	const SceneSnapshotFormat::Header* m_pHeader = { nullptr };
+	const SceneSnapshotFormat::TileMap* m_pTileMaps = { nullptr };
+	const SceneSnapshotFormat::Actor* m_pActors = { nullptr };
+	const SceneSnapshotFormat::String* m_pStrings = { nullptr };
+	const uint32_t* m_pTileBlockingMasks = { nullptr };
+};
+
+#endif	// __SCENESNAPSHOT_H__
@@ -0,0 +1,17 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// This Include
+#include "SpatialIndex.h"
+
+void SpatialIndex::RaycastFirstHits(
+	const Point<float>* pOrigins, const Point<float>* pEnds, Actor* const* pCasters, size_t count,
+	const ActorIgnoreList& actorsToIgnore,
+	Actor** pHits,
+	JobPool* pJobPool)
+{
+	for (size_t i = 0; i < count; ++i) {
+		pHits[i] = RaycastFirstHitSkipping(pOrigins[i], pEnds[i], actorsToIgnore, pCasters ? pCasters[i] : nullptr);
+	}
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#ifndef __SPATIALINDEX_H__
+#define __SPATIALINDEX_H__
+
+// Library Includes
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Local Includes
+#include "ActorStore.h"
+#include "ActorIgnoreList.h"
+
+// Forward Declaration
+class Actor;
+class CollisionWorld;
+class JobPool;
+class SceneGraph;
+
+/** List of spatial indices the scene graph can store its actors in.
+@remarks
+	QUAD_TREE subdivides cells as they fill up, which suits sparse or clustered scenes. UNIFORM_GRID is a
+	flat grid of fixed size cells, which suits bounded, dense and uniformly populated scenes. Only UNIFORM_GRID 
+	answers region queries without testing every actor, so it's the one to use for scenes that query often.
+*/
+enum class SpatialIndexType {
+	QUAD_TREE,
+	UNIFORM_GRID
+};
+
+/** Non-owning reference to a callable taking an actor, e.g. a lambda visiting the results of a query.
+@remarks
+	Unlike std::function, wrapping a callable never allocates, so visitors can be passed through virtual calls for
+	free. The callable must outlive the visitor, which holds for a temporary passed straight to a query.
+*/
+class ActorVisitor {
+	// Member Functions
+public:
+	/** Construct from a callable returning false to stop visiting. */
+	template<typename Callable, typename = typename std::enable_if<!std::is_same<typename std::decay<Callable>::type, ActorVisitor>::value>::type>
+	ActorVisitor(Callable&& callable)
+		:m_pCallable(const_cast<void*>(static_cast<const void*>(std::addressof(callable)))),
+		m_pInvoke([](void* pCallable, Actor* pActor) {
+			return static_cast<bool>((*static_cast<typename std::remove_reference<Callable>::type*>(pCallable))(pActor));
+		})
+	{
+	}
+
+	/** Visit an actor.
+		@return False to stop visiting.
+	*/
+	bool operator()(Actor* pActor) const { return m_pInvoke(m_pCallable, pActor); }
+
+	// Member Variables
+private:
+	void* m_pCallable;
+	bool (*m_pInvoke)(void*, Actor*);
+};
+
+/** Interface of the structures the scene graph uses to find actors by their position.
+@remarks
+	Actors are indexed by their position. Every actor must be relocated after it moves before the index is
+	queried again.
+*/
+class SpatialIndex {
+	// Member Functions
+public:
+	/** Destructor. */
+	virtual ~SpatialIndex() = default;
+
+	/** Add an actor to the index.
+		@return True if the actor was inside the index bounds and added.
+	*/
+	virtual bool InsertActor(Actor* pActor) = 0;
+
+	/** Remove an actor from the index.
+		@return True if the actor was found and removed.
+	*/
+	virtual bool RemoveActor(Actor* pActor) = 0;
+
+	/** Move an actor to wherever its current position belongs in the index. */
+	virtual void RelocateActor(Actor* pActor) = 0;
+
+	/** Find the first actor hit by a line segment.
+		@param origin The start of the segment. A segment with no length tests the actors under the origin.
+		@param end The end of the segment.
+		@param actorsToIgnore Actors that can't be hit.
+		@return The actor hit closest to the origin, or null if none were hit.
+	*/
+	virtual Actor* RaycastFirstHit(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore) = 0;
+
+	/** Find every actor hit by a line segment.
+		@param actorsHit Cleared, then filled with the actors hit ordered by distance from the origin.
+	*/
+	virtual void Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, std::vector<Actor*>& actorsHit) = 0;
+
+	/** Visit every actor hit by a line segment, e.g. to write the hits into a container of the caller's choosing.
+		@param visitor Called with each actor hit in order of distance from the origin, returning false to stop. 
+			Mustn't add, remove or relocate actors, or cast rays of its own.
+	*/
+	virtual void Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, const ActorVisitor& visitor) = 0;
+
+	/** Find the first actor hit by each of a batch of line segments.
+		@remarks The default implementation casts each segment in turn on the calling thread.
+		@param pOrigins The start of each segment.
+		@param pEnds The end of each segment.
+		@param pCasters An actor that can't be hit by each segment, e.g. the actor looking, or null for none.
+		@param count The number of segments.
+		@param actorsToIgnore Actors that can't be hit by any segment.
+		@param pHits Receives the actor hit closest to the origin of each segment, or null if none were hit.
+		@param pJobPool Job pool the batch may be split across, or null to only use the calling thread.
+	*/
+	virtual void RaycastFirstHits(
+		const Point<float>* pOrigins, const Point<float>* pEnds, Actor* const* pCasters, size_t count,
+		const ActorIgnoreList& actorsToIgnore,
+		Actor** pHits,
+		JobPool* pJobPool);
+
+	/** Visit every actor whose position is within a world space box, edges included.
+		@param visitor Called with each actor, returning false to stop. Mustn't add, remove or relocate actors.
+	*/
+	virtual void QueryAABB(const Rect<float>& wBox, const ActorVisitor& visitor) = 0;
+
+	/** Get whether QueryAABB() only visits the actors around the box, rather than testing every actor. */
+	virtual bool IsQueryAABBLocal() const { return true; }
+
+	/** Render the indexed actors back to front through SceneGraph::RenderActor(). */
+	virtual void Render(SceneGraph& sceneGraph) = 0;
+
+	/** Resolve collisions between the indexed actors.
+		@param collisionWorld The collision world, for indices that only provide a broadphase.
+		@param actors The store owning the indexed actors.
+		@param sortedMovedActors The actors that have moved since the previous call, sorted by address.
+		@param onActorMoved Called for every actor moved when resolving a collision.
+	*/
+	virtual void ResolveCollisions(
+		CollisionWorld& collisionWorld,
+		const ActorStore& actors,
+		const std::vector<const Actor*>& sortedMovedActors,
+		const std::function<void(Actor*)>& onActorMoved) = 0;
+
+	/** Get the world space bounds of the index. */
+	virtual const Rect<float>& GetBoundingBox() const = 0;
+
+	/** Set the maximum number of actors allowed in a cell, for indices whose cells subdivide. */
+	virtual void SetMaxNumActorsPerCell(size_t maxNumActors) = 0;
+
+	/** Get the maximum number of actors allowed in a cell. */
+	virtual size_t GetMaxNumActorsPerCell() const = 0;
+
+	/** Get how the index is divided up, for profiling.
+		@remarks May visit every actor in the index.
+		@param depth Receives the depth of the deepest cell holding an actor, 1 for an index that doesn't subdivide.
+		@param numOccupiedCells Receives the number of cells holding an actor.
+	*/
+	virtual void GetCellStats(size_t& depth, size_t& numOccupiedCells) = 0;
+protected:
+	/** Find the first actor hit by a line segment, also skipping a single actor, for RaycastFirstHits().
+		@param pCaster An actor to ignore along with actorsToIgnore, or null.
+	*/
+	virtual Actor* RaycastFirstHitSkipping(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, const Actor* pCaster) = 0;
+};
+
+#endif	// __SPATIALINDEX_H__
@@ -0,0 +1,33 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// This Include
+#include "SpriteHitMask.h"
+
+SpriteHitMask::SpriteHitMask(const uint8_t* pAlpha, size_t width, size_t height, size_t pixelStride, uint8_t alphaThreshold)
+	:m_Width(width),
+	m_Height(height),
+	m_WordsPerRow((width + 63) / 64),
+	m_Bits(m_WordsPerRow * height, 0)
+{
+	for (size_t y = 0; y < height; ++y) {
+		auto pRow = &m_Bits[y * m_WordsPerRow];
+
+		for (size_t x = 0; x < width; ++x) {
+			if (pAlpha[(y * width + x) * pixelStride] >= alphaThreshold) {
+				pRow[x / 64] |= uint64_t(1) << (x % 64);
+			}
+		}
+	}
+}
+
+bool SpriteHitMask::IsOpaque(int x, int y) const
+{
+	if (x < 0 || y < 0 || static_cast<size_t>(x) >= m_Width || static_cast<size_t>(y) >= m_Height) {
+		return false;
+	}
+
+	const auto word = m_Bits[y * m_WordsPerRow + x / 64];
+	return ((word >> (x % 64)) & 1) != 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef __SPRITEHITMASK_H__
+#define __SPRITEHITMASK_H__
+
+// Library Includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Which pixels of a sprite's image are opaque enough to be picked, one bit per pixel.
+@remarks
+	Built once from the alpha channel of the image when it's loaded, so picking never has to read back texels.
+*/
+class SpriteHitMask {
+	// Member Functions
+public:
+	/** Default constructor, for a mask without any opaque pixels. */
+	SpriteHitMask() = default;
+
+	/** Construct from the alpha values of an image.
+		@param pAlpha The alpha value of the top left pixel. Rows are stored one after another.
+		@param width The width of the image in pixels.
+		@param height The height of the image in pixels.
+		@param pixelStride The distance in bytes between the alpha values of neighbouring pixels, e.g. 4 for RGBA.
+		@param alphaThreshold The lowest alpha value of a pixel that can be picked.
+	*/
+	SpriteHitMask(const uint8_t* pAlpha, size_t width, size_t height, size_t pixelStride = 1, uint8_t alphaThreshold = 128);
+
+	/** Get whether a pixel can be picked, or false for pixels outside the image. */
+	bool IsOpaque(int x, int y) const;
+
+	/** Get the width of the image in pixels. */
+	size_t GetWidth() const { return m_Width; }
+	/** Get the height of the image in pixels. */
+	size_t GetHeight() const { return m_Height; }
+
+	// Member Variables
+private:
+	size_t m_Width = { 0 };
+	size_t m_Height = { 0 };
+	size_t m_WordsPerRow = { 0 };
+
+	// A bit per pixel, row by row, with each row padded to a whole word.
+	std::vector<uint64_t> m_Bits;
+};
+
+#endif	// __SPRITEHITMASK_H__
@@ -0,0 +1,440 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <algorithm>
+#include <cmath>
+
+// This Include
+#include "UniformGrid.h"
+
+// Local Includes
+#include "SceneGraph.h"
+#include "JobPool.h"
+#include "GridTraversal.h"
+#include "CollisionWorld.h"
+#include "Actor/Actor.h"
+#include "Actor/CollisionComponent.h"
+
+UniformGrid::UniformGrid(const Rect<float>& boundingBox, float cellSize, size_t maxActorsPerCell)
+	:m_BoundingBox(boundingBox),
+	m_CellSize(cellSize),
+	m_InverseCellSize(1.0f / cellSize),
+	m_NumCellsX(std::max<size_t>(1, static_cast<size_t>(std::ceil(boundingBox.GetWidth() / cellSize)))),
+	m_NumCellsY(std::max<size_t>(1, static_cast<size_t>(std::ceil(boundingBox.GetHeight() / cellSize)))),
+	m_Cells(m_NumCellsX * m_NumCellsY),
+	m_MaxActorsPerCell(maxActorsPerCell)
+{
+	assert(cellSize > 0.0f);
+}
+
+bool UniformGrid::InsertActor(Actor* pActor)
+{
+	const auto cellIndex = GetCellIndex(pActor->GetPosition());
+	if (!m_ActorCells.emplace(pActor, cellIndex).second) {
+		// Already in the grid.
+		return false;
+	}
+
+	m_Cells[cellIndex].push_back(pActor);
+	UpdateMaxActorExtent(pActor);
+
+	return true;
+}
+
+bool UniformGrid::RemoveActor(Actor* pActor)
+{
+	auto iter = m_ActorCells.find(pActor);
+	if (iter == m_ActorCells.end()) {
+		return false;
+	}
+
+	// Swap and pop, as the order of actors within a cell doesn't matter.
+	auto& cell = m_Cells[iter->second];
+	auto actorIter = std::find(cell.begin(), cell.end(), pActor);
+	*actorIter = cell.back();
+	cell.pop_back();
+
+	m_ActorCells.erase(iter);
+	return true;
+}
+
+void UniformGrid::RelocateActor(Actor* pActor)
+{
+	auto iter = m_ActorCells.find(pActor);
+	if (iter == m_ActorCells.end()) {
+		return;
+	}
+
+	// The colliders may have changed along with the position.
+	UpdateMaxActorExtent(pActor);
+
+	const auto cellIndex = GetCellIndex(pActor->GetPosition());
+	if (cellIndex == iter->second) {
+		// Still within its cell.
+		return;
+	}
+
+	auto& previousCell = m_Cells[iter->second];
+	auto actorIter = std::find(previousCell.begin(), previousCell.end(), pActor);
+	*actorIter = previousCell.back();
+	previousCell.pop_back();
+
+	m_Cells[cellIndex].push_back(pActor);
+	iter->second = cellIndex;
+}
+
+Actor* UniformGrid::RaycastFirstHit(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore)
+{
+	return RaycastFirstHitSkipping(origin, end, actorsToIgnore, nullptr);
+}
+
+Actor* UniformGrid::RaycastFirstHitSkipping(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, const Actor* pCaster)
+{
+	auto& scratch = GetRaycastScratch();
+	FindHits(origin, end, actorsToIgnore, pCaster, true, scratch);
+
+	return !scratch.hits.empty() ? scratch.hits.front().second : nullptr;
+}
+
+void UniformGrid::Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, std::vector<Actor*>& actorsHit)
+{
+	actorsHit.clear();
+
+	Raycast(origin, end, actorsToIgnore, [&actorsHit](Actor* pActor) {
+		actorsHit.push_back(pActor);
+		return true;
+	});
+}
+
+void UniformGrid::Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, const ActorVisitor& visitor)
+{
+	auto& scratch = GetRaycastScratch();
+	FindHits(origin, end, actorsToIgnore, nullptr, false, scratch);
+
+	std::sort(scratch.hits.begin(), scratch.hits.end(), [](const std::pair<float, Actor*>& lhs, const std::pair<float, Actor*>& rhs) {
+		return lhs.first < rhs.first;
+	});
+
+	for (const auto& hit : scratch.hits) {
+		if (!visitor(hit.second)) {
+			break;
+		}
+	}
+}
+
+void UniformGrid::RaycastFirstHits(
+	const Point<float>* pOrigins, const Point<float>* pEnds, Actor* const* pCasters, size_t count,
+	const ActorIgnoreList& actorsToIgnore,
+	Actor** pHits,
+	JobPool* pJobPool)
+{
+	// Interleave the bits of the column and row of each origin's cell, so sorting by the result orders the segments
+	// along a Z-order curve.
+	auto spreadBits = [](uint64_t value) {
+		value &= 0xFFFFFFFF;
+		value = (value | (value << 16)) & 0x0000FFFF0000FFFF;
+		value = (value | (value << 8)) & 0x00FF00FF00FF00FF;
+		value = (value | (value << 4)) & 0x0F0F0F0F0F0F0F0F;
+		value = (value | (value << 2)) & 0x3333333333333333;
+		value = (value | (value << 1)) & 0x5555555555555555;
+		return value;
+	};
+
+	std::vector<std::pair<uint64_t, size_t>> rayOrder(count);
+	for (size_t i = 0; i < count; ++i) {
+		const auto cellX = ToCellX(pOrigins[i].X());
+		const auto cellY = ToCellY(pOrigins[i].Y());
+		rayOrder[i] = { spreadBits(cellX) | (spreadBits(cellY) << 1), i };
+	}
+
+	std::sort(rayOrder.begin(), rayOrder.end());
+
+	auto castRays = [&](size_t begin, size_t end) {
+		auto& scratch = GetRaycastScratch();
+
+		for (auto i = begin; i < end; ++i) {
+			const auto ray = rayOrder[i].second;
+			const Actor* pCaster = pCasters ? pCasters[ray] : nullptr;
+
+			FindHits(pOrigins[ray], pEnds[ray], actorsToIgnore, pCaster, true, scratch);
+			pHits[ray] = !scratch.hits.empty() ? scratch.hits.front().second : nullptr;
+		}
+	};
+
+	if (pJobPool) {
+		// Each job casts a contiguous run of the sorted segments, so the coherence is kept within a job.
+		pJobPool->ParallelFor(count, s_RaysPerJob, castRays);
+	}
+	else {
+		castRays(0, count);
+	}
+}
+
+void UniformGrid::QueryAABB(const Rect<float>& wBox, const ActorVisitor& visitor)
+{
+	const auto left = ToCellX(wBox.GetLeft());
+	const auto right = ToCellX(wBox.GetRight());
+	const auto top = ToCellY(wBox.GetTop());
+	const auto bottom = ToCellY(wBox.GetBottom());
+
+	for (auto y = top; y <= bottom; ++y) {
+		for (auto x = left; x <= right; ++x) {
+			for (auto pActor : m_Cells[y * m_NumCellsX + x]) {
+				const auto& position = pActor->GetPosition();
+				if (position.X() < wBox.GetLeft() || position.X() > wBox.GetRight() ||
+					position.Y() < wBox.GetTop() || position.Y() > wBox.GetBottom()) {
+					continue;
+				}
+
+				if (!visitor(pActor)) {
+					return;
+				}
+			}
+		}
+	}
+}
+
+void UniformGrid::Render(SceneGraph& sceneGraph)
+{
+	m_RenderOrder.clear();
+
+	for (const auto& cell : m_Cells) {
+		for (auto pActor : cell) {
+			const auto sPosition = sceneGraph.ToScreenPosition(pActor->GetPosition(), pActor->GetElevation());
+			m_RenderOrder.emplace_back(sPosition.Y(), pActor);
+		}
+	}
+
+	// Stable so that actors at the same height keep a consistent order between frames.
+	std::stable_sort(m_RenderOrder.begin(), m_RenderOrder.end(), [](const std::pair<float, Actor*>& lhs, const std::pair<float, Actor*>& rhs) {
+		return lhs.first < rhs.first;
+	});
+
+	for (const auto& entry : m_RenderOrder) {
+		sceneGraph.RenderActor(entry.second);
+	}
+}
+
+void UniformGrid::ResolveCollisions(
+	CollisionWorld& collisionWorld,
+	const ActorStore& actors,
+	const std::vector<const Actor*>& sortedMovedActors,
+	const std::function<void(Actor*)>& onActorMoved)
+{
+	m_CandidatePairs.clear();
+
+	// Actors further apart than twice the largest extent can't touch, so only cells within that many cells need
+	// to be compared.
+	const auto reach = std::max<ptrdiff_t>(1, static_cast<ptrdiff_t>(std::ceil(2.0f * m_MaxActorExtent * m_InverseCellSize)));
+	const auto numCellsX = static_cast<ptrdiff_t>(m_NumCellsX);
+	const auto numCellsY = static_cast<ptrdiff_t>(m_NumCellsY);
+
+	for (ptrdiff_t y = 0; y < numCellsY; ++y) {
+		for (ptrdiff_t x = 0; x < numCellsX; ++x) {
+			const auto& cell = m_Cells[y * numCellsX + x];
+			if (cell.empty()) {
+				continue;
+			}
+
+			// Pairs within the cell.
+			for (size_t i = 0; i < cell.size(); ++i) {
+				for (auto j = i + 1; j < cell.size(); ++j) {
+					m_CandidatePairs.emplace_back(cell[i], cell[j]);
+				}
+			}
+
+			// Pairs with the cells after this one, so each pair of cells is only compared once.
+			for (auto neighbourY = y; neighbourY <= std::min(y + reach, numCellsY - 1); ++neighbourY) {
+				const auto firstX = neighbourY == y ? x + 1 : std::max<ptrdiff_t>(0, x - reach);
+
+				for (auto neighbourX = firstX; neighbourX <= std::min(x + reach, numCellsX - 1); ++neighbourX) {
+					for (auto pNeighbour : m_Cells[neighbourY * numCellsX + neighbourX]) {
+						for (auto pActor : cell) {
+							m_CandidatePairs.emplace_back(pActor, pNeighbour);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	collisionWorld.ResolveCollisions(actors, m_CandidatePairs, sortedMovedActors, onActorMoved);
+}
+
+size_t UniformGrid::ToCellX(float x) const
+{
+	const auto cellX = std::floor((x - m_BoundingBox.GetLeft()) * m_InverseCellSize);
+	return static_cast<size_t>(std::min(std::max(cellX, 0.0f), static_cast<float>(m_NumCellsX - 1)));
+}
+
+size_t UniformGrid::ToCellY(float y) const
+{
+	const auto cellY = std::floor((y - m_BoundingBox.GetTop()) * m_InverseCellSize);
+	return static_cast<size_t>(std::min(std::max(cellY, 0.0f), static_cast<float>(m_NumCellsY - 1)));
+}
+
+void UniformGrid::UpdateMaxActorExtent(const Actor* pActor)
+{
+	auto pCollisionComponent = pActor->GetComponent<CollisionComponent>();
+	if (!pCollisionComponent) {
+		return;
+	}
+
+	for (const auto& lBoundingBox : pCollisionComponent->GetBoundingBoxes()) {
+		const auto& lCentre = lBoundingBox.GetPosition();
+		const auto extentX = std::abs(lCentre.X()) + lBoundingBox.GetWidth() * 0.5f;
+		const auto extentY = std::abs(lCentre.Y()) + lBoundingBox.GetHeight() * 0.5f;
+
+		m_MaxActorExtent = std::max(m_MaxActorExtent, std::max(extentX, extentY));
+	}
+}
+
+UniformGrid::RaycastScratch& UniformGrid::GetRaycastScratch() const
+{
+	// Stamps only ever increase on a thread, so stamps left by a query of another grid can't match a later query.
+	thread_local RaycastScratch s_Scratch;
+
+	if (s_Scratch.cellQueryStamps.size() < m_Cells.size()) {
+		s_Scratch.cellQueryStamps.resize(m_Cells.size(), 0);
+	}
+
+	return s_Scratch;
+}
+
+void UniformGrid::FindHits(
+	const Point<float>& origin, const Point<float>& end,
+	const ActorIgnoreList& actorsToIgnore, const Actor* pCaster,
+	bool isFirstHitOnly,
+	RaycastScratch& scratch) const
+{
+	auto& hits = scratch.hits;
+	hits.clear();
+
+	// Only the part of the segment within reach of the grid can hit anything.
+	const Rect<float> reachableBox = {
+		m_BoundingBox.GetLeft() - m_MaxActorExtent,
+		m_BoundingBox.GetTop() - m_MaxActorExtent,
+		m_BoundingBox.GetWidth() + m_MaxActorExtent * 2.0f,
+		m_BoundingBox.GetHeight() + m_MaxActorExtent * 2.0f
+	};
+
+	const auto delta = end - origin;
+	auto start = 0.0f;
+	auto finish = 1.0f;
+	if (!ClipSegment(origin, delta, reachableBox, start, finish)) {
+		return;
+	}
+
+	if (++scratch.queryStamp == 0) {
+		// Wrapped around, so forget every stamp.
+		std::fill(scratch.cellQueryStamps.begin(), scratch.cellQueryStamps.end(), 0);
+		scratch.queryStamp = 1;
+	}
+
+	// An actor hit at some point of the segment is stored within this many cells of the cell containing that point.
+	const auto reach = static_cast<ptrdiff_t>(std::ceil(m_MaxActorExtent * m_InverseCellSize));
+	const auto numCellsX = static_cast<ptrdiff_t>(m_NumCellsX);
+	const auto numCellsY = static_cast<ptrdiff_t>(m_NumCellsY);
+
+	auto testCell = [&](ptrdiff_t cellX, ptrdiff_t cellY) {
+		const auto cellIndex = cellY * numCellsX + cellX;
+		if (scratch.cellQueryStamps[cellIndex] == scratch.queryStamp) {
+			return;
+		}
+		scratch.cellQueryStamps[cellIndex] = scratch.queryStamp;
+
+		for (auto pActor : m_Cells[cellIndex]) {
+			if (pActor == pCaster || actorsToIgnore.Contains(pActor)) {
+				continue;
+			}
+
+			const auto fraction = IntersectSegment(pActor, origin, end);
+			if (fraction < 0.0f) {
+				continue;
+			}
+
+			if (!isFirstHitOnly || hits.empty()) {
+				hits.emplace_back(fraction, pActor);
+			}
+			else if (fraction < hits.front().first) {
+				hits.front() = { fraction, pActor };
+			}
+		}
+	};
+
+	const Point<float> gridOrigin = { m_BoundingBox.GetLeft(), m_BoundingBox.GetTop() };
+
+	TraverseGrid(origin, delta, start, finish, gridOrigin, m_CellSize, numCellsX, numCellsY, [&](ptrdiff_t cellX, ptrdiff_t cellY, float entry, float exit) {
+		// Test every cell an actor overlapping the current cell could be stored in.
+		for (auto y = std::max<ptrdiff_t>(0, cellY - reach); y <= std::min(cellY + reach, numCellsY - 1); ++y) {
+			for (auto x = std::max<ptrdiff_t>(0, cellX - reach); x <= std::min(cellX + reach, numCellsX - 1); ++x) {
+				testCell(x, y);
+			}
+		}
+
+		// Any actor not yet tested can only be hit after the segment leaves the current cell.
+		return !isFirstHitOnly || hits.empty() || hits.front().first > exit;
+	});
+}
+
+float UniformGrid::IntersectSegment(const Actor* pActor, const Point<float>& origin, const Point<float>& end)
+{
+	auto pCollisionComponent = pActor->GetComponent<CollisionComponent>();
+	if (!pCollisionComponent) {
+		return -1.0f;
+	}
+
+	const auto& actorPosition = pActor->GetPosition();
+	const auto delta = end - origin;
+	auto firstHit = -1.0f;
+
+	for (const auto& lBoundingBox : pCollisionComponent->GetBoundingBoxes()) {
+		// Get the world space bounding box.
+		auto wBoundingBox = lBoundingBox;
+		wBoundingBox.SetCentrePosition(actorPosition + lBoundingBox.GetPosition());
+
+		auto entry = 0.0f;
+		auto exit = 1.0f;
+		if (ClipSegment(origin, delta, wBoundingBox, entry, exit)) {
+			if (firstHit < 0.0f || entry < firstHit) {
+				firstHit = entry;
+			}
+		}
+	}
+
+	return firstHit;
+}
+
+bool UniformGrid::ClipSegment(const Point<float>& origin, const Point<float>& delta, const Rect<float>& box, float& entry, float& exit)
+{
+	// Clip the segment against the slab of each axis.
+	auto clipAxis = [&entry, &exit](float start, float step, float min, float max) {
+		if (step == 0.0f) {
+			// Parallel to the slab, so the segment is either always or never inside it.
+			return start >= min && start <= max;
+		}
+
+		auto slabEntry = (min - start) / step;
+		auto slabExit = (max - start) / step;
+		if (slabEntry > slabExit) {
+			std::swap(slabEntry, slabExit);
+		}
+
+		entry = std::max(entry, slabEntry);
+		exit = std::min(exit, slabExit);
+		return entry <= exit;
+	};
+
+	return clipAxis(origin.X(), delta.X(), box.GetLeft(), box.GetRight()) &&
+		clipAxis(origin.Y(), delta.Y(), box.GetTop(), box.GetBottom());
+}
+
+void UniformGrid::GetCellStats(size_t& depth, size_t& numOccupiedCells)
+{
+	depth = 1;
+	numOccupiedCells = static_cast<size_t>(std::count_if(m_Cells.begin(), m_Cells.end(), [](const std::vector<Actor*>& cell) {
+		return !cell.empty();
+	}));
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#ifndef __UNIFORMGRID_H__
+#define __UNIFORMGRID_H__
+
+// Library Includes
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Local Includes
+#include "SpatialIndex.h"
+
+/** Spatial index of a flat grid of equally sized cells covering the scene bounds.
+@remarks
+	Each actor is stored in the single cell containing its position, so inserting, removing and relocating an
+	actor is constant time. Queries are widened by the largest distance any collider has been seen to extend
+	from its actor's position, so actors overlapping the edge of their cell are still found.
+@par
+	Raycasts walk the cells along the segment front to back (Amanatides & Woo). RaycastFirstHit() stops as soon 
+	as the nearest hit so far is closer than any actor in the cells not yet visited could be.
+@par
+	Raycasts only read the grid, using scratch buffers local to the calling thread, so they may be cast from
+	several threads at once as long as no actors are inserted, removed or relocated meanwhile.
+@par
+	Collisions only use the grid as a broadphase. The candidate pairs of actors in the same or neighbouring
+	cells are handed to the collision world, which resolves them.
+*/
+class UniformGrid : public SpatialIndex {
+	// Member Functions
+public:
+	/** Default constructor.
+		@param boundingBox The world space bounds covered by the grid.
+		@param cellSize The world space width and length of a cell, e.g. a multiple of a tile.
+		@param maxActorsPerCell Only kept for serialization, as grid cells don't subdivide.
+	*/
+	UniformGrid(const Rect<float>& boundingBox, float cellSize, size_t maxActorsPerCell);
+
+	/** @copydoc SpatialIndex::InsertActor()
+		@remarks Actors outside the bounds are stored in the nearest edge cell.
+	*/
+	bool InsertActor(Actor* pActor) override;
+	bool RemoveActor(Actor* pActor) override;
+	void RelocateActor(Actor* pActor) override;
+
+	Actor* RaycastFirstHit(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore) override;
+	void Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, std::vector<Actor*>& actorsHit) override;
+	void Raycast(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, const ActorVisitor& visitor) override;
+
+	/** @copydoc SpatialIndex::RaycastFirstHits()
+		@remarks
+			The segments are cast in the order of the cells containing their origins along a Z-order curve, so 
+			segments starting close together walk the same cells one after another.
+	*/
+	void RaycastFirstHits(
+		const Point<float>* pOrigins, const Point<float>* pEnds, Actor* const* pCasters, size_t count,
+		const ActorIgnoreList& actorsToIgnore,
+		Actor** pHits,
+		JobPool* pJobPool) override;
+
+	/** @copydoc SpatialIndex::QueryAABB()
+		@remarks Only the cells overlapping the box are visited.
+	*/
+	void QueryAABB(const Rect<float>& wBox, const ActorVisitor& visitor) override;
+
+	/** @copydoc SpatialIndex::Render()
+		@remarks Actors are ordered by the screen space height of their position.
+	*/
+	void Render(SceneGraph& sceneGraph) override;
+
+	void ResolveCollisions(
+		CollisionWorld& collisionWorld,
+		const ActorStore& actors,
+		const std::vector<const Actor*>& sortedMovedActors,
+		const std::function<void(Actor*)>& onActorMoved) override;
+
+	const Rect<float>& GetBoundingBox() const override { return m_BoundingBox; }
+
+	void SetMaxNumActorsPerCell(size_t maxNumActors) override { m_MaxActorsPerCell = maxNumActors; }
+	size_t GetMaxNumActorsPerCell() const override { return m_MaxActorsPerCell; }
+
+	void GetCellStats(size_t& depth, size_t& numOccupiedCells) override;
+
+	/** Get the world space width and length of a cell. */
+	float GetCellSize() const { return m_CellSize; }
+protected:
+	Actor* RaycastFirstHitSkipping(const Point<float>& origin, const Point<float>& end, const ActorIgnoreList& actorsToIgnore, const Actor* pCaster) override;
+private:
+	/** Buffers reused between raycasts on the same thread. */
+	struct RaycastScratch {
+		// The actors hit along with the fraction of the segment each was first hit at.
+		std::vector<std::pair<float, Actor*>> hits;
+		// The query each cell was last tested by, so overlapping neighbourhoods only test a cell once per query.
+		std::vector<uint32_t> cellQueryStamps;
+		uint32_t queryStamp = { 0 };
+	};
+
+	/** Get the raycast scratch buffers of the calling thread, with a stamp for each cell of the grid. */
+	RaycastScratch& GetRaycastScratch() const;
+
+	/** Get the column of the cell containing a world space x coordinate, clamped to the grid. */
+	size_t ToCellX(float x) const;
+	/** Get the row of the cell containing a world space y coordinate, clamped to the grid. */
+	size_t ToCellY(float y) const;
+
+	/** Get the index of the cell containing a world space position, clamped to the grid. */
+	size_t GetCellIndex(const Point<float>& wPosition) const { return ToCellY(wPosition.Y()) * m_NumCellsX + ToCellX(wPosition.X()); }
+
+	/** Widen the query margin to cover the colliders of an actor. */
+	void UpdateMaxActorExtent(const Actor* pActor);
+
+	/** Find the actors hit by a segment along with the fraction of the segment each was first hit at.
+		@param pCaster An actor to ignore along with actorsToIgnore, or null.
+		@param isFirstHitOnly Whether to stop at, and only keep, the hit closest to the origin.
+		@param scratch Receives the hits.
+	*/
+	void FindHits(
+		const Point<float>& origin, const Point<float>& end,
+		const ActorIgnoreList& actorsToIgnore, const Actor* pCaster,
+		bool isFirstHitOnly,
+		RaycastScratch& scratch) const;
+
+	/** Intersect a segment with the colliders of an actor.
+		@return The fraction along the segment of the first hit, or a negative value if the actor wasn't hit.
+	*/
+	static float IntersectSegment(const Actor* pActor, const Point<float>& origin, const Point<float>& end);
+
+	/** Clip the fractions along a segment to the part of the segment inside a box.
+		@return False if the segment misses the box.
+	*/
+	static bool ClipSegment(const Point<float>& origin, const Point<float>& delta, const Rect<float>& box, float& entry, float& exit);
+
+	// Member Variables
+private:
+	Rect<float> m_BoundingBox;
+	float m_CellSize;
+	float m_InverseCellSize;
+	size_t m_NumCellsX;
+	size_t m_NumCellsY;
+
+	// The actors of each cell, row by row.
+	std::vector<std::vector<Actor*>> m_Cells;
+	// The cell each actor is stored in.
+	std::unordered_map<const Actor*, size_t> m_ActorCells;
+
+	// The furthest any collider has extended from its actor's position, in world space.
+	float m_MaxActorExtent = { 0.0f };
+
+	size_t m_MaxActorsPerCell;
+
+	// The number of segments cast by a single job of a batched raycast.
+	static constexpr size_t s_RaysPerJob = 64;
+
+	// Scratch buffers, kept as members so their capacity is reused between calls.
+	std::vector<std::pair<float, Actor*>> m_RenderOrder;
+	std::vector<std::pair<Actor*, Actor*>> m_CandidatePairs;
+};
+
+#endif	// __UNIFORMGRID_H__
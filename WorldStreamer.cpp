@@ -0,0 +1,283 @@
+
+// PCH
+#include "BananaFighterStd.h"
+
+// Library Includes
+#include <algorithm>
+#include <fstream>
+
+// This Include
+#include "WorldStreamer.h"
+
+WorldStreamer::WorldStreamer(const Rect<float>& wWorldBounds, float chunkSize, float loadRadius, ChunkFilenameFunction getChunkFilename, TileMapParser parseTileMap)
+	:m_WorldBounds(wWorldBounds),
+	m_ChunkSize(std::max(chunkSize, 1.0f)),
+	m_LoadRadius(loadRadius),
+	m_NumChunksX(std::max(1, static_cast<int>(std::ceil(wWorldBounds.GetWidth() / m_ChunkSize)))),
+	m_NumChunksY(std::max(1, static_cast<int>(std::ceil(wWorldBounds.GetHeight() / m_ChunkSize)))),
+	m_GetChunkFilename(std::move(getChunkFilename)),
+	m_ParseTileMap(std::move(parseTileMap)),
+	m_LoadThread(&WorldStreamer::LoadThreadMain, this)
+{
+}
+
+WorldStreamer::~WorldStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_IsShuttingDown = true;
+	}
+	m_LoadsQueued.notify_one();
+
+	m_LoadThread.join();
+}
+
+void WorldStreamer::Update(
+	const Point<float>& wPosition,
+	const std::function<void(int, int, const SceneSnapshot*, std::vector<TileMap>&)>& onChunkLoaded,
+	const std::function<void(int, int)>& onChunkEvicted)
+{
+	// Chunks are kept until a whole chunk past the load radius, so they aren't reloaded when moving along a boundary.
+	const auto evictRadius = m_LoadRadius + m_ChunkSize;
+
+	std::vector<LoadedChunk> loadedChunks;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		loadedChunks.swap(m_LoadedChunks);
+
+		// Cancel loads that haven't started and are no longer wanted.
+		m_QueuedLoads.erase(std::remove_if(m_QueuedLoads.begin(), m_QueuedLoads.end(), [this, &wPosition, evictRadius](const QueuedLoad& queuedLoad) {
+			if (GetDistanceToChunk(wPosition, ToChunkX(queuedLoad.key), ToChunkY(queuedLoad.key)) <= evictRadius) {
+				return false;
+			}
+
+			m_Chunks.erase(queuedLoad.key);
+			return true;
+		}), m_QueuedLoads.end());
+	}
+
+	// Evict loaded chunks that are too far away.
+	for (auto iter = m_Chunks.begin(); iter != m_Chunks.end();) {
+		const auto chunkX = ToChunkX(iter->first);
+		const auto chunkY = ToChunkY(iter->first);
+
+		if (iter->second.state == ChunkState::LOADED && GetDistanceToChunk(wPosition, chunkX, chunkY) > evictRadius) {
+			onChunkEvicted(chunkX, chunkY);
+			iter = m_Chunks.erase(iter);
+		}
+		else {
+			++iter;
+		}
+	}
+
+	// Mark every chunk being handed over as loaded before handing over the first, so the loaded bounds are final.
+	loadedChunks.erase(std::remove_if(loadedChunks.begin(), loadedChunks.end(), [this, &wPosition, evictRadius](const LoadedChunk& loadedChunk) {
+		auto iter = m_Chunks.find(loadedChunk.key);
+		if (iter == m_Chunks.end()) {
+			// Cancelled after loading started.
+			return true;
+		}
+
+		if (iter->second.state != ChunkState::LOADING || iter->second.loadGeneration != loadedChunk.loadGeneration) {
+			// An earlier load of a chunk that has since been cancelled and queued again, so only the latest is used.
+			return true;
+		}
+
+		if (GetDistanceToChunk(wPosition, ToChunkX(loadedChunk.key), ToChunkY(loadedChunk.key)) > evictRadius) {
+			// Moved away while it was loading.
+			m_Chunks.erase(iter);
+			return true;
+		}
+
+		iter->second.state = ChunkState::LOADED;
+		return false;
+	}), loadedChunks.end());
+
+	for (auto& loadedChunk : loadedChunks) {
+		onChunkLoaded(ToChunkX(loadedChunk.key), ToChunkY(loadedChunk.key), loadedChunk.pSnapshot.get(), loadedChunk.tileMaps);
+	}
+
+	// Queue the chunks within the load radius, nearest first.
+	const auto firstX = std::max(0, static_cast<int>(std::floor((wPosition.X() - m_LoadRadius - m_WorldBounds.GetX()) / m_ChunkSize)));
+	const auto firstY = std::max(0, static_cast<int>(std::floor((wPosition.Y() - m_LoadRadius - m_WorldBounds.GetY()) / m_ChunkSize)));
+	const auto lastX = std::min(m_NumChunksX - 1, static_cast<int>(std::floor((wPosition.X() + m_LoadRadius - m_WorldBounds.GetX()) / m_ChunkSize)));
+	const auto lastY = std::min(m_NumChunksY - 1, static_cast<int>(std::floor((wPosition.Y() + m_LoadRadius - m_WorldBounds.GetY()) / m_ChunkSize)));
+
+	std::vector<std::pair<float, uint64_t>> newLoads;
+
+	for (auto chunkY = firstY; chunkY <= lastY; ++chunkY) {
+		for (auto chunkX = firstX; chunkX <= lastX; ++chunkX) {
+			const auto distance = GetDistanceToChunk(wPosition, chunkX, chunkY);
+			const auto key = ToKey(chunkX, chunkY);
+
+			if (distance <= m_LoadRadius && m_Chunks.find(key) == m_Chunks.end()) {
+				newLoads.emplace_back(distance, key);
+			}
+		}
+	}
+
+	if (newLoads.empty()) {
+		return;
+	}
+
+	std::sort(newLoads.begin(), newLoads.end());
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		for (const auto& newLoad : newLoads) {
+			const auto loadGeneration = ++m_LoadGeneration;
+
+			m_Chunks.emplace(newLoad.second, Chunk{ ChunkState::LOADING, loadGeneration });
+			m_QueuedLoads.push_back({ newLoad.second, loadGeneration });
+		}
+	}
+
+	m_LoadsQueued.notify_one();
+}
+
+void WorldStreamer::EvictAll(const std::function<void(int, int)>& onChunkEvicted)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_QueuedLoads.clear();
+		m_LoadedChunks.clear();
+	}
+
+	for (const auto& chunk : m_Chunks) {
+		if (chunk.second.state == ChunkState::LOADED) {
+			onChunkEvicted(ToChunkX(chunk.first), ToChunkY(chunk.first));
+		}
+	}
+
+	// A chunk still being loaded is dropped once it's handed over, as it's either no longer tracked or queued 
+	// again under a later load generation.
+	m_Chunks.clear();
+}
+
+Rect<float> WorldStreamer::GetChunkBounds(int chunkX, int chunkY) const
+{
+	return {
+		m_WorldBounds.GetX() + chunkX * m_ChunkSize,
+		m_WorldBounds.GetY() + chunkY * m_ChunkSize,
+		m_ChunkSize,
+		m_ChunkSize
+	};
+}
+
+bool WorldStreamer::GetChunk(const Point<float>& wPosition, int& chunkX, int& chunkY) const
+{
+	const auto x = static_cast<int>(std::floor((wPosition.X() - m_WorldBounds.GetX()) / m_ChunkSize));
+	const auto y = static_cast<int>(std::floor((wPosition.Y() - m_WorldBounds.GetY()) / m_ChunkSize));
+
+	if (x < 0 || y < 0 || x >= m_NumChunksX || y >= m_NumChunksY) {
+		return false;
+	}
+
+	chunkX = x;
+	chunkY = y;
+
+	return true;
+}
+
+bool WorldStreamer::IsChunkLoaded(int chunkX, int chunkY) const
+{
+	const auto iter = m_Chunks.find(ToKey(chunkX, chunkY));
+	return iter != m_Chunks.end() && iter->second.state == ChunkState::LOADED;
+}
+
+bool WorldStreamer::GetLoadedBounds(Rect<float>& wBounds) const
+{
+	auto isEmpty = true;
+	int minX = 0;
+	int minY = 0;
+	int maxX = 0;
+	int maxY = 0;
+
+	for (const auto& chunk : m_Chunks) {
+		if (chunk.second.state != ChunkState::LOADED) {
+			continue;
+		}
+
+		const auto chunkX = ToChunkX(chunk.first);
+		const auto chunkY = ToChunkY(chunk.first);
+
+		if (isEmpty) {
+			minX = maxX = chunkX;
+			minY = maxY = chunkY;
+			isEmpty = false;
+		}
+		else {
+			minX = std::min(minX, chunkX);
+			minY = std::min(minY, chunkY);
+			maxX = std::max(maxX, chunkX);
+			maxY = std::max(maxY, chunkY);
+		}
+	}
+
+	if (isEmpty) {
+		return false;
+	}
+
+	const auto minBounds = GetChunkBounds(minX, minY);
+	wBounds = {
+		minBounds.GetX(),
+		minBounds.GetY(),
+		(maxX - minX + 1) * m_ChunkSize,
+		(maxY - minY + 1) * m_ChunkSize
+	};
+
+	return true;
+}
+
+float WorldStreamer::GetDistanceToChunk(const Point<float>& wPosition, int chunkX, int chunkY) const
+{
+	const auto chunkBounds = GetChunkBounds(chunkX, chunkY);
+
+	const auto dx = std::max(std::max(chunkBounds.GetLeft() - wPosition.X(), wPosition.X() - chunkBounds.GetRight()), 0.0f);
+	const auto dy = std::max(std::max(chunkBounds.GetTop() - wPosition.Y(), wPosition.Y() - chunkBounds.GetBottom()), 0.0f);
+
+	return std::sqrt(dx * dx + dy * dy);
+}
+
+void WorldStreamer::LoadThreadMain()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	while (true) {
+		m_LoadsQueued.wait(lock, [this]() { return m_IsShuttingDown || !m_QueuedLoads.empty(); });
+
+		if (m_IsShuttingDown) {
+			return;
+		}
+
+		const auto queuedLoad = m_QueuedLoads.front();
+		m_QueuedLoads.pop_front();
+
+		const auto key = queuedLoad.key;
+
+		lock.unlock();
+
+		const auto filename = m_GetChunkFilename(ToChunkX(key), ToChunkY(key));
+
+		// A chunk without a file is empty, rather than a failure worth reporting. Opening checks every record,
+		// which also pages the tables in on this thread rather than when the chunk is spawned.
+		std::unique_ptr<SceneSnapshot> pSnapshot;
+		if (std::ifstream(filename).good()) {
+			pSnapshot = std::make_unique<SceneSnapshot>();
+			if (!pSnapshot->Open(filename)) {
+				pSnapshot.reset();
+			}
+		}
+
+		// A chunk whose tiles fail to parse keeps its actors, though it shows as a hole in the world.
+		std::vector<TileMap> tileMaps;
+		if (pSnapshot && m_ParseTileMap && !pSnapshot->ParseTileMaps(m_ParseTileMap, tileMaps)) {
+			tileMaps.clear();
+		}
+
+		lock.lock();
+
+		m_LoadedChunks.push_back({ key, queuedLoad.loadGeneration, std::move(pSnapshot), std::move(tileMaps) });
+	}
+}
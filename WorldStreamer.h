@@ -0,0 +1,163 @@
+#pragma once
+
+#ifndef __WORLDSTREAMER_H__
+#define __WORLDSTREAMER_H__
+
+// Library Includes
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Local Includes
+#include "Isometric/TileMap.h"
+#include "SceneSnapshot.h"
+
+/** Pages the chunks of a world in and out around a moving position.
+@remarks
+	The world is split into square chunks, each stored on disk as a binary scene snapshot. Chunks within the load
+	radius of the position passed to Update() are opened on a background thread, and handed back through Update()
+	once they're ready. Chunks are only evicted once they're a whole chunk further away than the load radius, so
+	moving back and forth over a boundary doesn't reload the same chunk every frame.
+@par
+	Chunks without a file on disk are treated as empty, so a world only needs files for its populated chunks.
+@par
+	Given a tile map parser, each chunk's tile maps are also parsed on the background thread and handed over 
+	with its snapshot, so a world's tiles can be paged along with its actors.
+*/
+class WorldStreamer {
+	// Member Functions
+public:
+	/** Get the filename of a chunk from its column and row. */
+	using ChunkFilenameFunction = std::function<std::string(int chunkX, int chunkY)>;
+
+	/** Constructor.
+		@param wWorldBounds The world space bounds of the whole world, with chunk (0, 0) at its top left corner.
+		@param chunkSize The world space width and length of a chunk.
+		@param loadRadius The world space distance around the position within which chunks are loaded.
+		@param getChunkFilename Gets the filename of a chunk. Called from the background thread.
+		@param parseTileMap Parses the tile maps of each chunk, or empty to leave them unparsed. Called from the 
+			background thread.
+	*/
+	WorldStreamer(const Rect<float>& wWorldBounds, float chunkSize, float loadRadius, ChunkFilenameFunction getChunkFilename, TileMapParser parseTileMap = {});
+
+	/** Destructor. Waits for the chunk being loaded, if any. */
+	~WorldStreamer();
+
+	WorldStreamer(const WorldStreamer&) = delete;
+	WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+	/** Queue the chunks around a position for loading, and hand over the chunks that have loaded or been evicted.
+		@param wPosition The world space position to stream around, e.g. the camera position.
+		@remarks
+			Chunks are evicted before any are handed over, and every chunk handed over is loaded before the first 
+			onChunkLoaded(), so GetLoadedBounds() already covers all of them from within it.
+		@param onChunkLoaded Called as onChunkLoaded(chunkX, chunkY, snapshot, tileMaps) for each chunk finished 
+			loading. The snapshot is null for a chunk without a file, and is unmapped once the callback returns. 
+			The tile maps are empty without a tile map parser, and may be moved from.
+		@param onChunkEvicted Called as onChunkEvicted(chunkX, chunkY) for each loaded chunk that is now too far away.
+	*/
+	void Update(
+		const Point<float>& wPosition,
+		const std::function<void(int, int, const SceneSnapshot*, std::vector<TileMap>&)>& onChunkLoaded,
+		const std::function<void(int, int)>& onChunkEvicted);
+
+	/** Evict every loaded chunk and cancel every queued load.
+		@param onChunkEvicted Called as onChunkEvicted(chunkX, chunkY) for each loaded chunk.
+	*/
+	void EvictAll(const std::function<void(int, int)>& onChunkEvicted);
+
+	/** Get the world space bounds of a chunk. */
+	Rect<float> GetChunkBounds(int chunkX, int chunkY) const;
+
+	/** Get the chunk containing a world space position.
+		@return False if the position is outside the world.
+	*/
+	bool GetChunk(const Point<float>& wPosition, int& chunkX, int& chunkY) const;
+
+	/** Get whether a chunk has been loaded and handed over, and not yet evicted. */
+	bool IsChunkLoaded(int chunkX, int chunkY) const;
+
+	/** Get the world space bounds of every loaded chunk.
+		@return False if no chunk is loaded.
+	*/
+	bool GetLoadedBounds(Rect<float>& wBounds) const;
+
+	/** Get the world space width and length of a chunk. */
+	float GetChunkSize() const { return m_ChunkSize; }
+private:
+	/** Whether a chunk is waiting to be loaded, or has been loaded and handed over. */
+	enum class ChunkState {
+		LOADING,
+		LOADED
+	};
+
+	/** A chunk that is loading or loaded. */
+	struct Chunk {
+		ChunkState state;
+		// The load the chunk is waiting for, so the result of an earlier load of the same chunk is dropped.
+		uint32_t loadGeneration;
+	};
+
+	/** A chunk waiting for the background thread to open it. */
+	struct QueuedLoad {
+		uint64_t key;
+		uint32_t loadGeneration;
+	};
+
+	/** A chunk opened by the background thread, waiting to be handed over. */
+	struct LoadedChunk {
+		uint64_t key;
+		uint32_t loadGeneration;
+		// Null if the chunk has no file.
+		std::unique_ptr<SceneSnapshot> pSnapshot;
+		// Empty without a tile map parser.
+		std::vector<TileMap> tileMaps;
+	};
+
+	/** Pack the column and row of a chunk into a single key. */
+	static uint64_t ToKey(int chunkX, int chunkY) { return (static_cast<uint64_t>(static_cast<uint32_t>(chunkX)) << 32) | static_cast<uint32_t>(chunkY); }
+	/** Get the column of a chunk from its key. */
+	static int ToChunkX(uint64_t key) { return static_cast<int>(static_cast<uint32_t>(key >> 32)); }
+	/** Get the row of a chunk from its key. */
+	static int ToChunkY(uint64_t key) { return static_cast<int>(static_cast<uint32_t>(key)); }
+
+	/** Get the world space distance from a position to the nearest point of a chunk. */
+	float GetDistanceToChunk(const Point<float>& wPosition, int chunkX, int chunkY) const;
+
+	/** Entry point of the thread opening the queued chunks. */
+	void LoadThreadMain();
+
+	// Member Variables
+private:
+	Rect<float> m_WorldBounds;
+	float m_ChunkSize;
+	float m_LoadRadius;
+	int m_NumChunksX;
+	int m_NumChunksY;
+	ChunkFilenameFunction m_GetChunkFilename;
+	TileMapParser m_ParseTileMap;
+
+	// The state of every chunk that is loading or loaded. Only used by the thread calling Update().
+	std::unordered_map<uint64_t, Chunk> m_Chunks;
+	// Incremented for every load queued. Only used by the thread calling Update().
+	uint32_t m_LoadGeneration = { 0 };
+
+	// Guards the queues below, which are shared with the load thread.
+	std::mutex m_Mutex;
+	std::condition_variable m_LoadsQueued;
+	std::deque<QueuedLoad> m_QueuedLoads;
+	std::vector<LoadedChunk> m_LoadedChunks;
+	bool m_IsShuttingDown = { false };
+
+	std::thread m_LoadThread;
+};
+
+#endif	// __WORLDSTREAMER_H__